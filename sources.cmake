@@ -48,6 +48,7 @@ src/graphics/show_curve.cpp
 src/graphics/skid_marks.cpp
 src/graphics/slip_stream.cpp
 src/graphics/stars.cpp
+src/graphics/texture_cache.cpp
 src/guiengine/abstract_state_manager.cpp
 src/guiengine/abstract_top_level_container.cpp
 src/guiengine/CGUISpriteBank.cpp
@@ -80,7 +81,10 @@ src/input/input_device.cpp
 src/input/input_manager.cpp
 src/input/wiimote.cpp
 src/input/wiimote_manager.cpp
+src/io/cache_file.cpp
 src/io/file_manager.cpp
+src/io/file_prefetcher.cpp
+src/io/metadata_index.cpp
 src/io/xml_node.cpp
 src/io/xml_writer.cpp
 src/items/attachment.cpp
@@ -113,6 +117,7 @@ src/karts/kart_gfx.cpp
 src/karts/kart_model.cpp
 src/karts/kart_properties.cpp
 src/karts/kart_properties_manager.cpp
+src/karts/kart_spatial_index.cpp
 src/karts/kart_with_stats.cpp
 src/karts/max_speed.cpp
 src/karts/moveable.cpp
@@ -127,6 +132,7 @@ src/modes/easter_egg_hunt.cpp
 src/modes/follow_the_leader.cpp
 src/modes/linear_world.cpp
 src/modes/overworld.cpp
+src/modes/profile_batch.cpp
 src/modes/profile_world.cpp
 src/modes/soccer_world.cpp
 src/modes/standard_race.cpp
@@ -223,6 +229,7 @@ src/tracks/graph_node.cpp
 src/tracks/lod_node_loader.cpp
 src/tracks/quad.cpp
 src/tracks/quad_graph.cpp
+src/tracks/quad_grid.cpp
 src/tracks/quad_set.cpp
 src/tracks/terrain_info.cpp
 src/tracks/track.cpp
@@ -239,6 +246,7 @@ src/utils/random_generator.cpp
 src/utils/string_utils.cpp
 src/utils/translation.cpp
 src/utils/vec3.cpp
+src/utils/worker_pool.cpp
 )
 set(STK_HEADERS
 src/addons/addon.hpp
@@ -295,6 +303,7 @@ src/graphics/show_curve.hpp
 src/graphics/skid_marks.hpp
 src/graphics/slip_stream.hpp
 src/graphics/stars.hpp
+src/graphics/texture_cache.hpp
 src/guiengine/abstract_state_manager.hpp
 src/guiengine/abstract_top_level_container.hpp
 src/guiengine/engine.hpp
@@ -326,7 +335,10 @@ src/input/input.hpp
 src/input/input_manager.hpp
 src/input/wiimote.hpp
 src/input/wiimote_manager.hpp
+src/io/cache_file.hpp
 src/io/file_manager.hpp
+src/io/file_prefetcher.hpp
+src/io/metadata_index.hpp
 src/io/xml_node.hpp
 src/io/xml_writer.hpp
 src/items/attachment.hpp
@@ -361,6 +373,7 @@ src/karts/kart.hpp
 src/karts/kart_model.hpp
 src/karts/kart_properties.hpp
 src/karts/kart_properties_manager.hpp
+src/karts/kart_spatial_index.hpp
 src/karts/kart_with_stats.hpp
 src/karts/max_speed.hpp
 src/karts/moveable.hpp
@@ -374,6 +387,7 @@ src/modes/easter_egg_hunt.hpp
 src/modes/follow_the_leader.hpp
 src/modes/linear_world.hpp
 src/modes/overworld.hpp
+src/modes/profile_batch.hpp
 src/modes/profile_world.hpp
 src/modes/soccer_world.hpp
 src/modes/standard_race.hpp
@@ -485,6 +499,7 @@ src/tracks/graph_node.hpp
 src/tracks/lod_node_loader.hpp
 src/tracks/quad_graph.hpp
 src/tracks/quad.hpp
+src/tracks/quad_grid.hpp
 src/tracks/quad_set.hpp
 src/tracks/terrain_info.hpp
 src/tracks/track.hpp
@@ -507,4 +522,5 @@ src/utils/synchronised.hpp
 src/utils/time.hpp
 src/utils/translation.hpp
 src/utils/vec3.hpp
+src/utils/worker_pool.hpp
 )
@@ -234,7 +234,8 @@ void AddonsManager::checkInstalledAddons()
     // -----------
     for(unsigned int i=0; i<kart_properties_manager->getNumberOfKarts(); i++)
     {
-        const KartProperties *kp = kart_properties_manager->getKartById(i);
+        const KartProperties *kp =
+            kart_properties_manager->getKartMetadataById(i);
         const std::string &dir=kp->getKartDir();
         if(dir.find(file_manager->getAddonsDir())==std::string::npos)
             continue;
@@ -413,7 +414,7 @@ bool AddonsManager::install(const Addon &addon)
         // reload all karts (this function is easily available) and existing
         // karts will not reload their meshes.
         const KartProperties *prop =
-            kart_properties_manager->getKart(addon.getId());
+            kart_properties_manager->getKartMetadata(addon.getId());
         // If the model already exist, first remove the old kart
         if(prop)
             kart_properties_manager->removeKart(addon.getId());
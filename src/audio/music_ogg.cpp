@@ -30,14 +30,22 @@
 #include "audio/music_manager.hpp"
 #include "audio/sfx_manager.hpp"
 #include "utils/constants.hpp"
+#include "utils/log.hpp"
+#include "utils/time.hpp"
 
 MusicOggStream::MusicOggStream()
 {
     //m_oggStream= NULL;
-    m_soundBuffers[0] = m_soundBuffers[1]= 0;
+    for(unsigned int i=0; i<NUM_BUFFERS; i++)
+        m_soundBuffers[i] = 0;
     m_soundSource     = -1;
     m_pausedMusic     = true;
     m_playing         = false;
+    m_error           = true;
+    m_num_used_buffers= 0;
+    m_thread_running  = false;
+    m_stop_thread     = false;
+    pthread_mutex_init(&m_mutex, NULL);
 }   // MusicOggStream
 
 //-----------------------------------------------------------------------------
@@ -45,12 +53,15 @@ MusicOggStream::~MusicOggStream()
 {
     if(stopMusic() == false)
         Log::warn("MusicOgg", "problems while stopping music.\n");
+    pthread_mutex_destroy(&m_mutex);
 }   // ~MusicOggStream
 
 //-----------------------------------------------------------------------------
 bool MusicOggStream::load(const std::string& filename)
 {
-    if (isPlaying()) stopMusic();
+    // Release a previously loaded file (which also stops its streaming
+    // thread)
+    stopMusic();
 
     m_error = true;
     m_fileName = filename;
@@ -107,8 +118,9 @@ bool MusicOggStream::load(const std::string& filename)
     if (m_vorbisInfo->channels == 1) nb_channels = AL_FORMAT_MONO16;
     else                             nb_channels = AL_FORMAT_STEREO16;
 
-    alGenBuffers(2, m_soundBuffers);
+    alGenBuffers(NUM_BUFFERS, m_soundBuffers);
     if (check("alGenBuffers") == false) return false;
+    m_num_used_buffers = 0;
 
     alGenSources(1, &m_soundSource);
     if (check("alGenSources") == false) return false;
@@ -124,6 +136,90 @@ bool MusicOggStream::load(const std::string& filename)
     return true;
 }   // load
 
+//-----------------------------------------------------------------------------
+/** Starts the thread which keeps the buffers of the source filled. */
+void MusicOggStream::startStreamingThread()
+{
+    m_stop_thread = false;
+    int error = pthread_create(&m_thread, NULL,
+                               &MusicOggStream::streamingThread, this);
+    if(error)
+    {
+        Log::error("MusicOgg", "Could not create streaming thread, "
+                   "error=%d.", error);
+        return;
+    }
+    m_thread_running = true;
+}   // startStreamingThread
+
+//-----------------------------------------------------------------------------
+/** Terminates the streaming thread and waits till it is finished. */
+void MusicOggStream::stopStreamingThread()
+{
+    if(!m_thread_running) return;
+
+    pthread_mutex_lock(&m_mutex);
+    m_stop_thread = true;
+    pthread_mutex_unlock(&m_mutex);
+    pthread_join(m_thread, NULL);
+    m_thread_running = false;
+}   // stopStreamingThread
+
+//-----------------------------------------------------------------------------
+/** The main loop of the streaming thread: decodes the music block by block
+ *  and queues the blocks on the source whenever a buffer was played. The
+ *  music is decoded without holding the mutex, so the main thread is never
+ *  blocked by decoding, the mutex is only locked to queue a block.
+ *  \param obj Pointer to the music object.
+ */
+void *MusicOggStream::streamingThread(void *obj)
+{
+    MusicOggStream *music = (MusicOggStream*)obj;
+
+    // The next decoded block, which is queued as soon as a buffer is free
+    char pcm[m_buffer_size];
+    int  pcm_size     = 0;
+    bool decode_error = false;
+
+    while(true)
+    {
+        if(pcm_size==0 && !decode_error)
+        {
+            pcm_size = music->decodeBlock(pcm);
+            if(pcm_size==0)
+            {
+                Log::warn("MusicOgg", "Could not decode more music from "
+                          "'%s'.", music->m_fileName.c_str());
+                decode_error = true;
+            }
+        }
+
+        pthread_mutex_lock(&music->m_mutex);
+        if(music->m_stop_thread)
+        {
+            pthread_mutex_unlock(&music->m_mutex);
+            break;
+        }
+        bool queued = false;
+        if(pcm_size>0)
+            queued = music->queueBlock(pcm, pcm_size);
+        pthread_mutex_unlock(&music->m_mutex);
+
+        if(queued)
+        {
+            // Decode the next block immediately
+            pcm_size = 0;
+            continue;
+        }
+        // All buffers are filled (or the music is paused). Each buffer
+        // contains a quarter of a second of music, so this is often enough
+        // to never run out of data. The device of irr_driver can't be used
+        // to sleep, since it is replaced when the resolution is changed.
+        StkTime::sleep(10);
+    }
+    return NULL;
+}   // streamingThread
+
 //-----------------------------------------------------------------------------
 bool MusicOggStream::empty()
 {
@@ -151,12 +247,13 @@ bool MusicOggStream::release()
     }
 
     pauseMusic();
+    stopStreamingThread();
     m_fileName= "";
 
     empty();
     alDeleteSources(1, &m_soundSource);
     check("alDeleteSources");
-    alDeleteBuffers(2, m_soundBuffers);
+    alDeleteBuffers(NUM_BUFFERS, m_soundBuffers);
     check("alDeleteBuffers");
 
     // Handle error correctly
@@ -169,23 +266,30 @@ bool MusicOggStream::release()
 }   // release
 
 //-----------------------------------------------------------------------------
+/** Starts playing the music. The buffers are filled (and the source is
+ *  started once data is available) by the streaming thread, which is
+ *  started when the music is played for the first time (and stopped when
+ *  the music is stopped).
+ */
 bool MusicOggStream::playMusic()
 {
     if(isPlaying())
         return true;
 
-    if(!streamIntoBuffer(m_soundBuffers[0]))
-        return false;
-
-    if(!streamIntoBuffer(m_soundBuffers[1]))
+    if(m_fileName=="" || m_error)
         return false;
 
-    alSourceQueueBuffers(m_soundSource, 2, m_soundBuffers);
-
-    alSourcePlay(m_soundSource);
+    pthread_mutex_lock(&m_mutex);
+    int queued = 0;
+    alGetSourcei(m_soundSource, AL_BUFFERS_QUEUED, &queued);
+    if(queued>0)
+        alSourcePlay(m_soundSource);
     m_pausedMusic = false;
     m_playing = true;
+    pthread_mutex_unlock(&m_mutex);
 
+    if(!m_thread_running)
+        startStreamingThread();
     return true;
 }   // playMusic
 
@@ -221,8 +325,10 @@ bool MusicOggStream::pauseMusic()
         return true;
     }
 
+    pthread_mutex_lock(&m_mutex);
     alSourceStop(m_soundSource);
     m_pausedMusic= true;
+    pthread_mutex_unlock(&m_mutex);
     return true;
 }   // pauseMusic
 
@@ -237,8 +343,13 @@ bool MusicOggStream::resumeMusic()
         return true;
     }
 
+    pthread_mutex_lock(&m_mutex);
     alSourcePlay(m_soundSource);
     m_pausedMusic= false;
+    pthread_mutex_unlock(&m_mutex);
+
+    if(!m_thread_running && !m_error)
+        startStreamingThread();
     return true;
 }   // resumeMusic
 
@@ -255,102 +366,106 @@ void MusicOggStream::volumeMusic(float gain)
 void MusicOggStream::updateFading(float percent)
 {
     alSourcef(m_soundSource,AL_GAIN,percent);
-    update();
 }   // updateFading
 
 //-----------------------------------------------------------------------------
 void MusicOggStream::updateFaster(float percent, float max_pitch)
 {
     alSourcef(m_soundSource,AL_PITCH,1+max_pitch*percent);
-    update();
 }   // updateFaster
 
 //-----------------------------------------------------------------------------
+/** Nothing to do, the buffers are filled by the streaming thread. */
 void MusicOggStream::update()
 {
+}   // update
 
+//-----------------------------------------------------------------------------
+/** Queues a decoded block of music on the source, if a buffer is free (i.e.
+ *  was not used yet or was already played). Also starts the source if it
+ *  is not playing (when starting the music or after a buffer under-run).
+ *  This is called from the streaming thread, with the mutex locked.
+ *  \param pcm The decoded data.
+ *  \param size Size of the decoded data in bytes.
+ *  \return True if the block was queued.
+ */
+bool MusicOggStream::queueBlock(const char *pcm, int size)
+{
     if (m_pausedMusic || m_soundSource == ALuint(-1))
     {
-        // nothing todo
-        return;
+        // Keep the data till the music is played again
+        return false;
     }
 
-    int processed= 0;
-    bool active= true;
-
-    alGetSourcei(m_soundSource, AL_BUFFERS_PROCESSED, &processed);
-
-    while(processed--)
+    ALuint buffer;
+    if (m_num_used_buffers < NUM_BUFFERS)
     {
-        ALuint buffer;
+        buffer = m_soundBuffers[m_num_used_buffers++];
+    }
+    else
+    {
+        int processed = 0;
+        alGetSourcei(m_soundSource, AL_BUFFERS_PROCESSED, &processed);
+        if (processed == 0) return false;
 
         alSourceUnqueueBuffers(m_soundSource, 1, &buffer);
-        if(!check("alSourceUnqueueBuffers")) return;
+        if (!check("alSourceUnqueueBuffers")) return false;
+    }
 
-        active = streamIntoBuffer(buffer);
-        if(!active)
-        {
-            // no more data. Seek to beginning (causes the sound to loop)
-            ov_time_seek(&m_oggStream, 0);
-            active = streamIntoBuffer(buffer);//now there really should be data
-            //fprintf(stdout,"Music buffer under-run.\n");
-        }
+    alBufferData(buffer, nb_channels, pcm, size, m_vorbisInfo->rate);
+    check("alBufferData");
+    alSourceQueueBuffers(m_soundSource, 1, &buffer);
+    if (!check("alSourceQueueBuffers")) return false;
 
-        alSourceQueueBuffers(m_soundSource, 1, &buffer);
-        if (!check("alSourceQueueBuffers")) return;
-    }
+    ALenum state;
+    alGetSourcei(m_soundSource, AL_SOURCE_STATE, &state);
+    if (state != AL_PLAYING)
+        alSourcePlay(m_soundSource);
 
-    if (active)
-    {
-        // we have data, so we should be playing...
-        ALenum state;
-        alGetSourcei(m_soundSource, AL_SOURCE_STATE, &state);
-        if (state != AL_PLAYING)
-        {
-            Log::warn("MusicOgg", "Music not playing when it should be. "
-                      "Source state: %d\n", state);
-            alGetSourcei(m_soundSource, AL_BUFFERS_PROCESSED, &processed);
-            alSourcePlay(m_soundSource);
-        }
-    }
-    else
-    {
-        Log::warn("MusicOgg", "Attempt to stream music into buffer failed "
-                              "twice in a row.\n");
-    }
-}   // update
+    return true;
+}   // queueBlock
 
 //-----------------------------------------------------------------------------
-bool MusicOggStream::streamIntoBuffer(ALuint buffer)
+/** Decodes the next block of music. At the end of the file decoding starts
+ *  again at the beginning, which makes the music loop. This is called from
+ *  the streaming thread without the mutex locked (the ogg stream is only
+ *  used by the streaming thread while it is running).
+ *  \param pcm Buffer of m_buffer_size bytes for the decoded data.
+ *  \return Number of bytes decoded, 0 in case of an error.
+ */
+int MusicOggStream::decodeBlock(char *pcm)
 {
-    char pcm[m_buffer_size];
     const int isBigEndian = (IS_LITTLE_ENDIAN ? 0 : 1);
 
-    int  size = 0;
+    int  size   = 0;
+    bool seeked = false;
     int  portion;
-    int  result;
 
     while(size < m_buffer_size)
     {
-        result = ov_read(&m_oggStream, pcm + size, m_buffer_size - size,
-                         isBigEndian, 2, 1, &portion);
-
+        const int result = ov_read(&m_oggStream, pcm + size,
+                                   m_buffer_size - size, isBigEndian, 2, 1,
+                                   &portion);
         if(result > 0)
+        {
             size += result;
-        else
-            if(result < 0)
-                throw errorString(result);
-            else
-                break;
+            continue;
+        }
+        if(result < 0)
+        {
+            Log::error("MusicOgg", "Error decoding '%s': %s",
+                       m_fileName.c_str(), errorString(result).c_str());
+            break;
+        }
+        // End of file: queue what was decoded, the next block starts again
+        // at the beginning of the file.
+        if(size > 0 || seeked || ov_time_seek(&m_oggStream, 0) != 0)
+            break;
+        seeked = true;
     }
 
-    if(size == 0) return false;
-
-    alBufferData(buffer, nb_channels, pcm, size, m_vorbisInfo->rate);
-    check("alBufferData");
-
-    return true;
-}   // streamIntoBuffer
+    return size;
+}   // decodeBlock
 
 //-----------------------------------------------------------------------------
 bool MusicOggStream::check(const char* what)
@@ -21,6 +21,7 @@
 
 #if HAVE_OGGVORBIS
 
+#include <pthread.h>
 #include <string>
 
 #include <ogg/ogg.h>
@@ -42,6 +43,12 @@
 
 /**
   * \brief ogg files based implementation of the Music interface
+  * The music is decoded by a separate thread (started when the music is
+  * played for the first time), which keeps the buffers of
+  * the OpenAL source filled. This way decoding does not take time in the
+  * main thread, and the music keeps on playing if the main thread is busy
+  * (e.g. while loading a track). The main thread only starts, pauses and
+  * stops the music, and changes volume and pitch.
   * \ingroup audio
   */
 class MusicOggStream : public Music
@@ -69,8 +76,15 @@ protected:
     std::string errorString(int code);
 
 private:
+    /** Number of buffers queued on the source. */
+    enum { NUM_BUFFERS = 4 };
+
     bool release();
-    bool streamIntoBuffer(ALuint buffer);
+    int  decodeBlock(char *pcm);
+    bool queueBlock(const char *pcm, int size);
+    void startStreamingThread();
+    void stopStreamingThread();
+    static void *streamingThread(void *obj);
 
     std::string     m_fileName;
     FILE*           m_oggFile;
@@ -80,12 +94,30 @@ private:
 
     bool            m_playing;
 
-    ALuint m_soundBuffers[2];
+    ALuint m_soundBuffers[NUM_BUFFERS];
+    /** Number of buffers that were queued at least once (the other buffers
+     *  are used first, afterwards processed buffers are reused). */
+    unsigned int m_num_used_buffers;
     ALuint m_soundSource;
     ALenum nb_channels;
 
     bool m_pausedMusic;
-    static const int m_buffer_size = 11025*4;//one full second of audio at 44100 samples per second
+
+    /** The thread which decodes the music into the buffers. */
+    pthread_t       m_thread;
+
+    /** True while the streaming thread is running. */
+    bool            m_thread_running;
+
+    /** Set to true to terminate the streaming thread. */
+    bool            m_stop_thread;
+
+    /** Protects the buffers and the source (and the flags used by the
+     *  streaming thread) while the streaming thread is running. The ogg
+     *  stream is only used by the streaming thread (while it is running),
+     *  so decoding is done without holding this lock. */
+    pthread_mutex_t m_mutex;
+    static const int m_buffer_size = 11025*4;//a quarter second of 16 bit stereo audio at 44100 samples per second
 };
 
 #endif
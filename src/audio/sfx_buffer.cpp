@@ -18,9 +18,12 @@
 
 #include "audio/sfx_buffer.hpp"
 #include "audio/sfx_manager.hpp"
+#include "io/cache_file.hpp"
 #include "io/file_manager.hpp"
 #include "utils/constants.hpp"
 
+#include <stdio.h>
+
 #if HAVE_OGGVORBIS
 #  include <vorbis/codec.h>
 #  include <vorbis/vorbisfile.h>
@@ -33,6 +36,25 @@
 #  endif
 #endif
 
+/** Identifies a pcm cache file. */
+static const char         PCM_CACHE_MAGIC[4]   = {'S', 'T', 'K', 'P'};
+
+/** Version of the pcm cache files, must be increased whenever the file
+ *  format changes. */
+static const unsigned int PCM_CACHE_VERSION    = 2;
+
+/** Larger sound files are not cached (which also limits the memory
+ *  allocated when reading a corrupt file). */
+static const unsigned int PCM_CACHE_MAX_SIZE   = 64*1024*1024;
+
+/** Format of the data stored in a pcm cache file. The data is the decoded
+ *  16 bit pcm data, see CacheFile for the file format. */
+struct PcmCacheInfo
+{
+    unsigned int m_channels;
+    unsigned int m_rate;
+};   // PcmCacheInfo
+
 //----------------------------------------------------------------------------
 
 SFXBuffer::SFXBuffer(const std::string& file,
@@ -47,6 +69,9 @@ SFXBuffer::SFXBuffer(const std::string& file,
     m_loaded      = false;
     m_max_dist    = max_width;
     m_file        = file;
+    m_size        = 0;
+    m_num_sources = 0;
+    m_last_used   = 0;
 
     m_rolloff     = rolloff;
     m_positional  = positional;
@@ -65,6 +90,9 @@ SFXBuffer::SFXBuffer(const std::string& file,
     m_positional  = false;
     m_loaded      = false;
     m_file        = file;
+    m_size        = 0;
+    m_num_sources = 0;
+    m_last_used   = 0;
 
     node->get("rolloff",     &m_rolloff    );
     node->get("positional",  &m_positional );
@@ -115,14 +143,113 @@ void SFXBuffer::unload()
     m_loaded = false;
 }
 
+//----------------------------------------------------------------------------
+/** Returns the name of the cache file with the decoded pcm data of a sound
+ *  file.
+ *  \param name Full path of the sound file.
+ */
+std::string SFXBuffer::getPcmCacheFile(const std::string &name)
+{
+    return CacheFile::getName("sfx-", name, ".pcm");
+}   // getPcmCacheFile
+
+//----------------------------------------------------------------------------
+/** Loads the decoded pcm data of a sound file from its cache file. The cache
+ *  file is only used if it was created for this sound file, the sound file
+ *  was not modified since then, and the checksum of the data is correct
+ *  (see CacheFile::read).
+ *  \param name Full path of the sound file.
+ *  \param channels, rate On return the number of channels and the sample
+ *         rate.
+ *  \param data On return the (new[]'ed) 16 bit pcm data.
+ *  \param len On return the size of the data in bytes.
+ *  \return True if a valid cache file was found.
+ */
+bool SFXBuffer::loadPcmCache(const std::string &name, int *channels,
+                             long *rate, char **data, long *len)
+{
+    PcmCacheInfo info;
+    unsigned int data_size;
+    char *buffer = CacheFile::read(getPcmCacheFile(name), PCM_CACHE_MAGIC,
+                                   PCM_CACHE_VERSION, name,
+                                   &info, sizeof(info), PCM_CACHE_MAX_SIZE,
+                                   &data_size);
+    if(!buffer) return false;
+    if((info.m_channels!=1 && info.m_channels!=2) || data_size==0 ||
+       data_size % (info.m_channels*2) != 0                            )
+    {
+        delete [] buffer;
+        return false;
+    }
+
+    *channels = info.m_channels;
+    *rate     = info.m_rate;
+    *data     = buffer;
+    *len      = data_size;
+    return true;
+}   // loadPcmCache
+
+//----------------------------------------------------------------------------
+/** Saves the decoded pcm data of a sound file in its cache file.
+ *  \param name Full path of the sound file.
+ *  \param channels Number of channels.
+ *  \param rate Sample rate.
+ *  \param data The 16 bit pcm data.
+ *  \param len Size of the data in bytes.
+ */
+void SFXBuffer::savePcmCache(const std::string &name, int channels,
+                             long rate, const char *data, long len)
+{
+    if(len<=0 || len>(long)PCM_CACHE_MAX_SIZE) return;
+
+    PcmCacheInfo info;
+    info.m_channels = channels;
+    info.m_rate     = (unsigned int)rate;
+    CacheFile::write(getPcmCacheFile(name), PCM_CACHE_MAGIC,
+                     PCM_CACHE_VERSION, name, &info, sizeof(info),
+                     data, (unsigned int)len);
+}   // savePcmCache
+
+//----------------------------------------------------------------------------
+/** Removes all pcm cache files which can not be used anymore, see
+ *  CacheFile::removeStaleFiles.
+ */
+void SFXBuffer::removeStaleCacheFiles()
+{
+    CacheFile::removeStaleFiles("sfx-", ".pcm", PCM_CACHE_MAGIC,
+                                PCM_CACHE_VERSION);
+}   // removeStaleCacheFiles
+
 //----------------------------------------------------------------------------
 /** Load a vorbis file into an OpenAL buffer
  *  based on a routine by Peter Mulholland, used with permission (quote :
  *  "Feel free to use")
+ *  The decoded data is stored in a cache file, which is used instead of
+ *  decoding the file again the next time it is loaded.
  */
 bool SFXBuffer::loadVorbisBuffer(const std::string &name, ALuint buffer)
 {
 #if HAVE_OGGVORBIS
+    if (alIsBuffer(buffer) == AL_FALSE)
+    {
+        Log::error("SFXBuffer", "Error, bad OpenAL buffer");
+        return false;
+    }
+
+    int   channels;
+    long  rate;
+    char *data;
+    long  len;
+    if (loadPcmCache(name, &channels, &rate, &data, &len))
+    {
+        alBufferData(buffer, (channels == 1) ? AL_FORMAT_MONO16
+                                             : AL_FORMAT_STEREO16,
+                     data, len, rate);
+        delete [] data;
+        m_size = len;
+        return true;
+    }
+
     const int ogg_endianness = (IS_LITTLE_ENDIAN ? 0 : 1);
 
 
@@ -131,12 +258,6 @@ bool SFXBuffer::loadVorbisBuffer(const std::string &name, ALuint buffer)
     vorbis_info *info;
     OggVorbis_File oggFile;
 
-    if (alIsBuffer(buffer) == AL_FALSE)
-    {
-        Log::error("SFXBuffer", "Error, bad OpenAL buffer");
-        return false;
-    }
-
     file = fopen(name.c_str(), "rb");
 
     if(!file)
@@ -154,9 +275,9 @@ bool SFXBuffer::loadVorbisBuffer(const std::string &name, ALuint buffer)
 
     info = ov_info(&oggFile, -1);
 
-    long len = (long)ov_pcm_total(&oggFile, -1) * info->channels * 2;    // always 16 bit data
+    len = (long)ov_pcm_total(&oggFile, -1) * info->channels * 2;    // always 16 bit data
 
-    char *data = (char *) malloc(len);
+    data = (char *) malloc(len);
     if(!data)
     {
         ov_clear(&oggFile);
@@ -171,14 +292,28 @@ bool SFXBuffer::loadVorbisBuffer(const std::string &name, ALuint buffer)
     while (todo)
     {
         int read = ov_read(&oggFile, bufpt, todo, ogg_endianness, 2, 1, &bs);
+        // Stop on errors or a truncated file (instead of looping forever)
+        if (read <= 0) break;
         todo -= read;
         bufpt += read;
     }
 
+    // Only use the data that was actually decoded (a truncated or corrupt
+    // file stops early), rounded down to complete samples.
+    const long decoded = (len - todo) - (len - todo) % (info->channels * 2);
+    if (todo != 0)
+        Log::warn("SFXBuffer", "Could only decode %ld of %ld bytes of '%s'.",
+                  decoded, len, name.c_str());
+
     alBufferData(buffer, (info->channels == 1) ? AL_FORMAT_MONO16
                  : AL_FORMAT_STEREO16,
-                 data, len, info->rate);
+                 data, decoded, info->rate);
     success = true;
+    m_size  = decoded;
+
+    // Don't cache incompletely decoded files
+    if (todo == 0)
+        savePcmCache(name, info->channels, info->rate, data, len);
 
     free(data);
 
@@ -189,4 +324,3 @@ bool SFXBuffer::loadVorbisBuffer(const std::string &name, ALuint buffer)
     return false;
 #endif
 }
-
@@ -33,6 +33,7 @@ typedef unsigned int ALuint;
 #include "utils/vec3.hpp"
 #include "utils/leak_check.hpp"
 
+#include <assert.h>
 #include <string>
 
 class SFXBase;
@@ -58,7 +59,23 @@ private:
     float    m_gain;
     float    m_max_dist;
 
+    /** Size of the decoded data in bytes (only valid if loaded). */
+    unsigned int m_size;
+
+    /** Number of sound sources using this buffer. A buffer can only be
+     *  unloaded if it is not used by any source. */
+    unsigned int m_num_sources;
+
+    /** Value of the use counter of the SFXManager when this buffer was
+     *  last used, to unload the least recently used buffers first. */
+    unsigned int m_last_used;
+
     bool loadVorbisBuffer(const std::string &name, ALuint buffer);
+    static std::string getPcmCacheFile(const std::string &name);
+    static bool loadPcmCache(const std::string &name, int *channels,
+                             long *rate, char **data, long *len);
+    static void savePcmCache(const std::string &name, int channels,
+                             long rate, const char *data, long len);
 
 public:
 
@@ -75,6 +92,8 @@ public:
     {
     }
 
+    static void removeStaleCacheFiles();
+
     /**
       * \brief load the buffer from file into OpenAL.
       * \note If this buffer is already loaded, this call does nothing and returns false
@@ -92,6 +111,24 @@ public:
     /** \return whether this buffer was loaded from disk */
     bool     isLoaded()       const { return m_loaded; }
 
+    /** Returns the size of the loaded data in bytes. */
+    unsigned int getSize()    const { return m_size; }
+
+    /** Called when a sound source starts using this buffer. */
+    void     addSource()            { m_num_sources++; }
+
+    /** Called when a sound source using this buffer is deleted. */
+    void     removeSource()         { assert(m_num_sources>0); m_num_sources--; }
+
+    /** Returns the number of sound sources using this buffer. */
+    unsigned int getNumSources() const { return m_num_sources; }
+
+    /** Sets when this buffer was last used. */
+    void     setLastUsed(unsigned int counter) { m_last_used = counter; }
+
+    /** Returns when this buffer was last used. */
+    unsigned int getLastUsed() const { return m_last_used; }
+
     /** Only returns a valid buffer if isLoaded() returned true */
     ALuint   getBufferID()    const { return m_buffer; }
 
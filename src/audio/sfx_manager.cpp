@@ -23,6 +23,7 @@
 #include <sstream>
 #include <stdexcept>
 #include <algorithm>
+#include <functional>
 #include <map>
 
 #include <stdio.h>
@@ -50,6 +51,15 @@
 SFXManager* sfx_manager= NULL;
 std::map<std::string, SFXBase*> SFXManager::m_quick_sounds;
 
+/** Number of OpenAL sources that are left for the music if the sources for
+ *  sound effects are limited by the hardware. */
+static const unsigned int NUM_MUSIC_SOURCES = 4;
+
+/** A virtual looped sound only takes the source of a sound that is
+ *  currently heard if it is this much more important, to avoid that
+ *  sounds with a similar priority keep on swapping their sources. */
+static const float SOURCE_SWAP_RATIO = 1.2f;
+
 /** Initialises the SFX manager and loads the sfx from a config file.
  */
 SFXManager::SFXManager()
@@ -57,10 +67,14 @@ SFXManager::SFXManager()
     // The sound manager initialises OpenAL
     m_initialized = music_manager->initialized();
     m_master_gain = UserConfigParams::m_sfx_volume;
+    m_use_counter = 0;
+    m_num_sources = 0;
     // Init position, since it can be used before positionListener is called.
     m_position    = Vec3(0,0,0);
 
     loadSfx();
+    if (m_initialized)
+        createSourcePool();
     if (!sfxAllowed()) return;
     setMasterSFXVolume( UserConfigParams::m_sfx_volume );
 
@@ -88,6 +102,9 @@ SFXManager::~SFXManager()
     }
     m_quick_sounds.clear();
 
+    // The sources must be deleted before the buffers they might use
+    deleteSourcePool();
+
     // ---- clear m_all_sfx_types
     {
         std::map<std::string, SFXBuffer*>::iterator i = m_all_sfx_types.begin();
@@ -108,14 +125,16 @@ SFXManager::~SFXManager()
 
 void SFXManager::soundToggled(const bool on)
 {
-    // When activating SFX, load all buffers
+    // When activating SFX, load all buffers used by sound sources (all
+    // other buffers are loaded when they are used)
     if (on)
     {
         std::map<std::string, SFXBuffer*>::iterator i = m_all_sfx_types.begin();
         for (; i != m_all_sfx_types.end(); i++)
         {
             SFXBuffer* buffer = (*i).second;
-            buffer->load();
+            if (buffer->getNumSources() > 0)
+                loadBuffer(buffer);
         }
 
         resumeAll();
@@ -143,7 +162,182 @@ bool SFXManager::sfxAllowed()
 }   // sfxAllowed
 
 //----------------------------------------------------------------------------
-/** Loads all sounds specified in the sound config file.
+/** Creates the OpenAL sources that are shared by all sound effects. At most
+ *  as many sources as specified in the user config are created. If the
+ *  hardware supports less sources, some sources are left for the music.
+ */
+void SFXManager::createSourcePool()
+{
+#if HAVE_OGGVORBIS
+    const unsigned int max_sources =
+        std::max((int)UserConfigParams::m_sfx_max_sources, 1);
+    while (m_free_sources.size() < max_sources)
+    {
+        ALuint source;
+        alGenSources(1, &source);
+        if (alGetError() != AL_NO_ERROR) break;
+        m_free_sources.push_back(source);
+    }
+
+    if (m_free_sources.size() < max_sources)
+    {
+        for (unsigned int i=0; i<NUM_MUSIC_SOURCES && m_free_sources.size()>1;
+             i++)
+        {
+            alDeleteSources(1, &m_free_sources.back());
+            m_free_sources.pop_back();
+        }
+    }
+    m_num_sources = m_free_sources.size();
+    Log::info("SFXManager", "Using %d sources for sound effects.",
+              m_num_sources);
+#endif
+}   // createSourcePool
+
+//----------------------------------------------------------------------------
+/** Takes the sources away from all sounds and deletes them.
+ */
+void SFXManager::deleteSourcePool()
+{
+#if HAVE_OGGVORBIS
+    for (unsigned int i=0; i<m_all_voices.size(); i++)
+    {
+        if (m_all_voices[i]->hasSource())
+            releaseSource(m_all_voices[i]);
+    }
+    for (unsigned int i=0; i<m_free_sources.size(); i++)
+        alDeleteSources(1, &m_free_sources[i]);
+    m_free_sources.clear();
+    m_num_sources = 0;
+#endif
+}   // deleteSourcePool
+
+#if HAVE_OGGVORBIS
+//----------------------------------------------------------------------------
+/** Adds a sound to the list of sounds that compete for the OpenAL sources.
+ *  This is called from the constructor of the sound.
+ *  \param sfx The sound to add.
+ */
+void SFXManager::addVoice(SFXOpenAL *sfx)
+{
+    m_all_voices.push_back(sfx);
+}   // addVoice
+
+//----------------------------------------------------------------------------
+/** Removes a sound from the list of sounds that compete for the OpenAL
+ *  sources. This is called from the destructor of the sound.
+ *  \param sfx The sound to remove.
+ */
+void SFXManager::removeVoice(SFXOpenAL *sfx)
+{
+    std::vector<SFXOpenAL*>::iterator i =
+        std::find(m_all_voices.begin(), m_all_voices.end(), sfx);
+    if (i != m_all_voices.end())
+        m_all_voices.erase(i);
+}   // removeVoice
+
+//----------------------------------------------------------------------------
+/** Returns the sound with the lowest priority of all sounds that currently
+ *  have a source, or NULL if no sound has a source.
+ *  \param priority On return the priority of the sound found.
+ */
+SFXOpenAL* SFXManager::findLeastImportantVoice(float *priority)
+{
+    SFXOpenAL *lowest = NULL;
+    for (unsigned int i=0; i<m_all_voices.size(); i++)
+    {
+        SFXOpenAL *sfx = m_all_voices[i];
+        if (!sfx->hasSource()) continue;
+        const float p = sfx->getPriority();
+        if (!lowest || p < *priority)
+        {
+            lowest    = sfx;
+            *priority = p;
+        }
+    }
+    return lowest;
+}   // findLeastImportantVoice
+
+//----------------------------------------------------------------------------
+/** Gives an OpenAL source to a sound. If all sources are used, the source
+ *  of the least important sound is taken away from it - but only if the
+ *  requesting sound is more important.
+ *  \param sfx The sound that needs a source.
+ *  \param min_ratio How much more important the requesting sound must be
+ *         than the sound whose source would be taken away.
+ *  \return True if the sound got a source.
+ */
+bool SFXManager::requestSource(SFXOpenAL *sfx, float min_ratio)
+{
+    assert(!sfx->hasSource());
+    if (!sfx->getBuffer()->isLoaded()) return false;
+
+    if (m_free_sources.empty())
+    {
+        float lowest_priority = 0;
+        SFXOpenAL *lowest = findLeastImportantVoice(&lowest_priority);
+        if (!lowest || sfx->getPriority() <= lowest_priority*min_ratio)
+            return false;
+        releaseSource(lowest);
+    }
+
+    ALuint source = m_free_sources.back();
+    m_free_sources.pop_back();
+    sfx->attachSource(source);
+    return true;
+}   // requestSource
+
+//----------------------------------------------------------------------------
+/** Takes the OpenAL source away from a sound and makes it available for
+ *  other sounds.
+ *  \param sfx The sound which has a source.
+ */
+void SFXManager::releaseSource(SFXOpenAL *sfx)
+{
+    m_free_sources.push_back(sfx->detachSource());
+}   // releaseSource
+#endif
+
+//----------------------------------------------------------------------------
+/** Distributes the OpenAL sources to the most important sounds. The sources
+ *  of sounds that have finished are released, and looped sounds that are
+ *  played without a source get one if they are more important than a sound
+ *  that currently has one. Called once per frame.
+ *  \param dt Time step size.
+ */
+void SFXManager::update(float dt)
+{
+#if HAVE_OGGVORBIS
+    if (!sfxAllowed()) return;
+
+    std::vector<std::pair<float, SFXOpenAL*> > waiting;
+    for (unsigned int i=0; i<m_all_voices.size(); i++)
+    {
+        SFXOpenAL *sfx = m_all_voices[i];
+        // getStatus releases the source of a sound that has finished
+        if (sfx->hasSource())
+            sfx->getStatus();
+        else if (sfx->getLogicalStatus() == SFX_PLAYING)
+            waiting.push_back(std::make_pair(sfx->getPriority(), sfx));
+    }
+    if (waiting.empty()) return;
+
+    // Most important sounds first, once a sound does not get a source,
+    // the less important ones won't get one either.
+    std::sort(waiting.begin(), waiting.end(),
+              std::greater<std::pair<float, SFXOpenAL*> >());
+    for (unsigned int i=0; i<waiting.size(); i++)
+    {
+        if (!requestSource(waiting[i].second, SOURCE_SWAP_RATIO))
+            break;
+    }
+#endif
+}   // update
+
+//----------------------------------------------------------------------------
+/** Registers all sounds specified in the sound config file. The sounds are
+ *  only loaded when they are used for the first time (or preloaded with
+ *  preloadRaceSfx()).
  */
 void SFXManager::loadSfx()
 {
@@ -163,7 +357,11 @@ void SFXManager::loadSfx()
 
         if (node->getName() == "sfx")
         {
-            loadSingleSfx(node, "", false);
+            SFXBuffer *buffer = loadSingleSfx(node, "", false);
+            bool preload = false;
+            node->get("preload", &preload);
+            if (buffer && preload)
+                m_preload_sfx.push_back(buffer);
         }
         else
         {
@@ -173,27 +371,79 @@ void SFXManager::loadSfx()
     }// nend for
 
     delete root;
+}   // loadSfx
+
+// -----------------------------------------------------------------------------
+/** Loads a buffer if it is not loaded yet, and marks it as used. If the
+ *  loaded buffers then use more memory than allowed, the least recently
+ *  used buffers are unloaded.
+ *  \param buffer The buffer to load.
+ */
+void SFXManager::loadBuffer(SFXBuffer *buffer)
+{
+    buffer->setLastUsed(++m_use_counter);
+    if (buffer->isLoaded()) return;
 
-    // Now load them in parallel
-    const int max = m_all_sfx_types.size();
-    SFXBuffer **array = new SFXBuffer *[max];
-    i = 0;
+    buffer->load();
+    unloadUnusedBuffers(buffer);
+}   // loadBuffer
 
-    for (std::map<std::string, SFXBuffer*>::iterator it = m_all_sfx_types.begin();
-         it != m_all_sfx_types.end(); it++)
+// -----------------------------------------------------------------------------
+/** Unloads the least recently used buffers until the memory used by all
+ *  loaded buffers is within the limit set in the user config. Buffers
+ *  used by a sound source are never unloaded.
+ *  \param keep A buffer which must not be unloaded (the one just loaded).
+ */
+void SFXManager::unloadUnusedBuffers(const SFXBuffer *keep)
+{
+    // Clamp the config value, so that the computation can not overflow
+    int max_mb = UserConfigParams::m_sfx_buffer_memory;
+    if (max_mb < 1)    max_mb = 1;
+    if (max_mb > 4095) max_mb = 4095;
+    const size_t max_size = (size_t)max_mb * 1024 * 1024;
+
+    size_t total_size = 0;
+    std::map<std::string, SFXBuffer*>::iterator i;
+    for (i = m_all_sfx_types.begin(); i != m_all_sfx_types.end(); i++)
     {
-        SFXBuffer* const buffer = (*it).second;
-        array[i++] = buffer;
+        if (i->second->isLoaded())
+            total_size += i->second->getSize();
     }
 
-    #pragma omp parallel for private(i)
-    for (i = 0; i < max; i++)
+    while (total_size > max_size)
     {
-        array[i]->load();
+        SFXBuffer *oldest = NULL;
+        for (i = m_all_sfx_types.begin(); i != m_all_sfx_types.end(); i++)
+        {
+            SFXBuffer *buffer = i->second;
+            if (buffer == keep || !buffer->isLoaded() ||
+                buffer->getNumSources() > 0)
+                continue;
+            if (!oldest || buffer->getLastUsed() < oldest->getLastUsed())
+                oldest = buffer;
+        }
+        // All remaining buffers are in use
+        if (!oldest) break;
+
+        Log::verbose("SFXManager", "Unloading sfx '%s'.",
+                     oldest->getFileName().c_str());
+        total_size -= oldest->getSize();
+        oldest->unload();
     }
+}   // unloadUnusedBuffers
 
-    delete [] array;
-}   // loadSfx
+// -----------------------------------------------------------------------------
+/** Loads all sound effects that are marked with preload="true" in the sfx
+ *  config file (e.g. the sounds of items), so that the first use of them in
+ *  a race does not have to wait for the sound to be loaded.
+ */
+void SFXManager::preloadRaceSfx()
+{
+    if (!m_initialized) return;
+
+    for (unsigned int i=0; i<m_preload_sfx.size(); i++)
+        loadBuffer(m_preload_sfx[i]);
+}   // preloadRaceSfx
 
 // -----------------------------------------------------------------------------
 /** Introduces a mechanism by which one can load sound effects beyond the basic
@@ -228,7 +478,11 @@ SFXBuffer* SFXManager::addSingleSfx(const std::string &sfx_name,
     if (UserConfigParams::logMisc())
         Log::debug("SFXManager", "Loading SFX %s\n", sfx_file.c_str());
 
-    if (load && buffer->load()) return buffer;
+    if (load)
+    {
+        loadBuffer(buffer);
+        if (buffer->isLoaded()) return buffer;
+    }
 
     return NULL;
 } // addSingleSFX
@@ -306,6 +560,10 @@ SFXBase* SFXManager::createSoundSource(SFXBuffer* buffer,
     //       positional,
     //       race_manager->getNumLocalPlayers(), buffer->isPositional());
 
+    // Sound effects are loaded when they are used for the first time
+    if (m_initialized)
+        loadBuffer(buffer);
+
 #if HAVE_OGGVORBIS
     assert( alIsBuffer(buffer->getBufferID()) );
     SFXBase* sfx = new SFXOpenAL(buffer, positional, buffer->getGain(), owns_buffer);
@@ -39,6 +39,7 @@ typedef unsigned int ALuint;
 
 class SFXBase;
 class SFXBuffer;
+class SFXOpenAL;
 class XMLNode;
 
 /**
@@ -99,7 +100,30 @@ private:
     bool                      m_initialized;
     float                     m_master_gain;
 
+    /** The buffers that are marked to be preloaded in the sfx config file. */
+    std::vector<SFXBuffer*>   m_preload_sfx;
+
+    /** Incremented each time a buffer is used, to find the least recently
+     *  used buffers. */
+    unsigned int              m_use_counter;
+
+    /** All OpenAL sound objects, used to decide which sounds get one of
+     *  the (limited number of) OpenAL sources. This includes sounds that
+     *  are not in m_all_sfx (e.g. quick sounds). */
+    std::vector<SFXOpenAL*>   m_all_voices;
+
+    /** The OpenAL sources that are not used by any sound. */
+    std::vector<ALuint>       m_free_sources;
+
+    /** Total number of OpenAL sources for sound effects. */
+    unsigned int              m_num_sources;
+
     void                      loadSfx();
+    void                      createSourcePool();
+    void                      deleteSourcePool();
+    SFXOpenAL*                findLeastImportantVoice(float *priority);
+    void                      loadBuffer(SFXBuffer *buffer);
+    void                      unloadUnusedBuffers(const SFXBuffer *keep);
 
 public:
                              SFXManager();
@@ -127,7 +151,14 @@ public:
     void                     pauseAll();
     void                     resumeAll();
     bool                     soundExist(const std::string &name);
+    void                     preloadRaceSfx();
     void                     setMasterSFXVolume(float gain);
+    void                     update(float dt);
+    void                     addVoice(SFXOpenAL *sfx);
+    void                     removeVoice(SFXOpenAL *sfx);
+    bool                     requestSource(SFXOpenAL *sfx,
+                                           float min_ratio=1.0f);
+    void                     releaseSource(SFXOpenAL *sfx);
     float                    getMasterSFXVolume() const { return m_master_gain; }
 
     static bool              checkError(const std::string &context);
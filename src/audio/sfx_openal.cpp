@@ -52,24 +52,31 @@ SFXOpenAL::SFXOpenAL(SFXBuffer* buffer, bool positional, float gain, bool ownsBu
     m_defaultGain = gain;
     m_loop        = false;
     m_gain        = -1.0f;
+    m_status      = SFXManager::SFX_INITIAL;
+    m_pitch       = 1.0f;
+    m_position    = Vec3(0, 0, 0);
+    m_rolloff     = m_soundBuffer->getRolloff();
     m_owns_buffer = ownsBuffer;
+    m_soundBuffer->addSource();
 
-    // Don't initialise anything else if the sfx manager was not correctly
-    // initialised. First of all the initialisation will not work, and it
-    // will not be used anyway.
-    if (sfx_manager->sfxAllowed())
-    {
-        init();
-    }
+    // The OpenAL source is only taken from the source pool of the sfx
+    // manager when this sound is actually played.
+    sfx_manager->addVoice(this);
 }   // SFXOpenAL
 
 //-----------------------------------------------------------------------------
 
 SFXOpenAL::~SFXOpenAL()
 {
-    if (m_ok)
+    // The sfx manager might have been deleted before this sound (in which
+    // case it has deleted all sources and its buffers already).
+    if (sfx_manager)
     {
-        alDeleteSources(1, &m_soundSource);
+        if (m_ok)
+            sfx_manager->releaseSource(this);
+        sfx_manager->removeVoice(this);
+        if (m_soundBuffer != NULL)
+            m_soundBuffer->removeSource();
     }
 
     if (m_owns_buffer && m_soundBuffer != NULL)
@@ -80,48 +87,110 @@ SFXOpenAL::~SFXOpenAL()
 }   // ~SFXOpenAL
 
 //-----------------------------------------------------------------------------
-
+/** Tries to get a source for this sound from the sfx manager.
+ *  \return True if this sound has a source.
+ */
 bool SFXOpenAL::init()
 {
-    alGenSources(1, &m_soundSource );
-    if (!SFXManager::checkError("generating a source")) return false;
+    if (!m_ok && sfx_manager->sfxAllowed())
+        sfx_manager->requestSource(this);
+    return m_ok;
+}   // init
 
+//-----------------------------------------------------------------------------
+/** Called by the sfx manager when this sound gets an OpenAL source. The
+ *  current state of this sound is applied to the source, and it is started
+ *  if this sound is playing.
+ *  \param source The OpenAL source to use.
+ */
+void SFXOpenAL::attachSource(ALuint source)
+{
+    assert(!m_ok);
     assert( alIsBuffer(m_soundBuffer->getBufferID()) );
-    assert( alIsSource(m_soundSource) );
+    assert( alIsSource(source) );
 
-    //std::cout << "Setting a source with buffer " << m_soundBuffer << ", rolloff " << rolloff
-    //          << ", gain=" << m_defaultGain << ", positional=" << (positional ? "true" : "false") << std::endl;
+    m_soundSource = source;
+    m_ok          = true;
 
     alSourcei (m_soundSource, AL_BUFFER,          m_soundBuffer->getBufferID());
 
-    if (!SFXManager::checkError("attaching the buffer to the source")) return false;
+    if (!SFXManager::checkError("attaching the buffer to the source")) return;
 
-    alSource3f(m_soundSource, AL_POSITION,        0.0, 0.0, 0.0);
+    if (m_positional)
+        alSource3f(m_soundSource, AL_POSITION, m_position.getX(),
+                   m_position.getY(), m_position.getZ());
+    else
+        alSource3f(m_soundSource, AL_POSITION, 0.0, 0.0, 0.0);
     alSource3f(m_soundSource, AL_VELOCITY,        0.0, 0.0, 0.0);
     alSource3f(m_soundSource, AL_DIRECTION,       0.0, 0.0, 0.0);
 
-    alSourcef (m_soundSource, AL_ROLLOFF_FACTOR,  m_soundBuffer->getRolloff());
-
+    alSourcef (m_soundSource, AL_ROLLOFF_FACTOR,  m_rolloff);
     alSourcef (m_soundSource, AL_MAX_DISTANCE,    m_soundBuffer->getMaxDist());
-
-    if (m_gain < 0.0f)
-    {
-        alSourcef (m_soundSource, AL_GAIN,        m_defaultGain);
-    }
-    else
-    {
-        alSourcef (m_soundSource, AL_GAIN,        m_gain);
-    }
+    alSourcef (m_soundSource, AL_GAIN,            getAudibleGain());
+    alSourcef (m_soundSource, AL_PITCH,           m_pitch);
 
     if (m_positional) alSourcei (m_soundSource, AL_SOURCE_RELATIVE, AL_FALSE);
     else              alSourcei (m_soundSource, AL_SOURCE_RELATIVE, AL_TRUE);
 
     alSourcei(m_soundSource, AL_LOOPING, m_loop ? AL_TRUE : AL_FALSE);
 
-    m_ok = SFXManager::checkError("setting up the source");
+    if (m_status == SFXManager::SFX_PLAYING)
+        alSourcePlay(m_soundSource);
 
-    return m_ok;
-}
+    SFXManager::checkError("setting up the source");
+}   // attachSource
+
+//-----------------------------------------------------------------------------
+/** Called by the sfx manager to take the OpenAL source away from this
+ *  sound. A looped sound keeps on 'playing' virtually and will be restarted
+ *  when it gets a source again, any other sound is stopped.
+ *  \return The source that was used by this sound.
+ */
+ALuint SFXOpenAL::detachSource()
+{
+    assert(m_ok);
+    alSourceStop(m_soundSource);
+    alSourcei(m_soundSource, AL_BUFFER, 0);
+    SFXManager::checkError("detaching the buffer from the source");
+
+    if (!m_loop)
+        m_status = SFXManager::SFX_STOPPED;
+
+    ALuint source = m_soundSource;
+    m_soundSource = 0;
+    m_ok          = false;
+    return source;
+}   // detachSource
+
+//-----------------------------------------------------------------------------
+/** Returns the gain of this sound, which is 0 if this is a positional sound
+ *  that is too far away from the listener to be heard.
+ */
+float SFXOpenAL::getAudibleGain() const
+{
+    if (m_positional &&
+        sfx_manager->getListenerPos().distance(m_position) > m_soundBuffer->getMaxDist())
+        return 0;
+    return m_gain < 0.0f ? m_defaultGain : m_gain;
+}   // getAudibleGain
+
+//-----------------------------------------------------------------------------
+/** Returns how important it is that this sound is actually heard, which is
+ *  used by the sfx manager to decide which sounds get an OpenAL source.
+ *  Non-positional sounds (e.g. of the GUI or of the local player) are more
+ *  important than all positional sounds, which are weighted by their
+ *  distance to the listener.
+ */
+float SFXOpenAL::getPriority() const
+{
+    const float gain = m_gain < 0.0f ? m_defaultGain : m_gain;
+    if (!m_positional) return 1.0f + gain;
+
+    const float max_dist = m_soundBuffer->getMaxDist();
+    const float distance = sfx_manager->getListenerPos().distance(m_position);
+    if (distance >= max_dist) return 0.0f;
+    return gain * (1.0f - distance/max_dist);
+}   // getPriority
 
 //-----------------------------------------------------------------------------
 /** Changes the pitch of a sound effect.
@@ -129,7 +198,7 @@ bool SFXOpenAL::init()
  */
 void SFXOpenAL::speed(float factor)
 {
-    if(!m_ok || isnan(factor)) return;
+    if(isnan(factor)) return;
 
     //OpenAL only accepts pitches in the range of 0.5 to 2.0
     if(factor > 2.0f)
@@ -140,6 +209,10 @@ void SFXOpenAL::speed(float factor)
     {
         factor = 0.5f;
     }
+    m_pitch = factor;
+
+    if(!m_ok) return;
+
     alSourcef(m_soundSource,AL_PITCH,factor);
     SFXManager::checkError("changing the speed");
 }   // speed
@@ -172,16 +245,17 @@ void SFXOpenAL::setLoop(bool status)
 }   // loop
 
 //-----------------------------------------------------------------------------
-/** Stops playing this sound effect.
+/** Stops playing this sound effect, and gives its source back to the sfx
+ *  manager.
  */
 void SFXOpenAL::stop()
 {
+    m_loop   = false;
+    m_status = SFXManager::SFX_STOPPED;
+
     if(!m_ok) return;
 
-    m_loop = false;
-    alSourcei(m_soundSource, AL_LOOPING, AL_FALSE);
-    alSourceStop(m_soundSource);
-    SFXManager::checkError("stoping");
+    sfx_manager->releaseSource(this);
 }   // stop
 
 //-----------------------------------------------------------------------------
@@ -190,6 +264,9 @@ void SFXOpenAL::stop()
  */
 void SFXOpenAL::pause()
 {
+    if(m_status != SFXManager::SFX_PLAYING) return;
+    m_status = SFXManager::SFX_PAUSED;
+
     if(!m_ok) return;
     alSourcePause(m_soundSource);
     SFXManager::checkError("pausing");
@@ -200,17 +277,7 @@ void SFXOpenAL::pause()
  */
 void SFXOpenAL::resume()
 {
-    if (!m_ok)
-    {
-        // lazily create OpenAL source when needed
-        init();
-
-        // creation of OpenAL source failed, giving up
-        if (!m_ok) return;
-    }
-
-    alSourcePlay(m_soundSource);
-    SFXManager::checkError("resuming");
+    start();
 }   // resume
 
 //-----------------------------------------------------------------------------
@@ -219,18 +286,28 @@ void SFXOpenAL::resume()
 void SFXOpenAL::play()
 {
     if (!sfx_manager->sfxAllowed()) return;
-    if (!m_ok)
-    {
-        // lazily create OpenAL source when needed
-        init();
+    start();
+}   // play
 
-        // creation of OpenAL source failed, giving up
-        if (!m_ok) return;
+//-----------------------------------------------------------------------------
+/** Starts (or continues) playing this sound. If it has no source yet, one
+ *  is requested from the sfx manager. If no source is available (since
+ *  more important sounds are playing), a looped sound is played virtually
+ *  (and will get a source later), any other sound is just not played.
+ */
+void SFXOpenAL::start()
+{
+    m_status = SFXManager::SFX_PLAYING;
+    if (m_ok)
+    {
+        alSourcePlay(m_soundSource);
+        SFXManager::checkError("playing");
+        return;
     }
 
-    alSourcePlay(m_soundSource);
-    SFXManager::checkError("playing");
-}   // play
+    if (!sfx_manager->requestSource(this) && !m_loop)
+        m_status = SFXManager::SFX_STOPPED;
+}   // start
 
 //-----------------------------------------------------------------------------
 /** Sets the position where this sound effects is played.
@@ -240,11 +317,6 @@ void SFXOpenAL::position(const Vec3 &position)
 {
     if(!UserConfigParams::m_sfx)
         return;
-    if (!m_ok)
-    {
-        fprintf(stderr, "WARNING, position called on non-ok SFX <%s>\n", m_soundBuffer->getFileName().c_str());
-        return;
-    }
     if (!m_positional)
     {
         // in multiplayer, all sounds are positional, so in this case don't bug users with
@@ -257,62 +329,56 @@ void SFXOpenAL::position(const Vec3 &position)
         return;
     }
 
+    m_position = position;
+
+    // A virtual sound only needs to store the position
+    if (!m_ok) return;
+
     alSource3f(m_soundSource, AL_POSITION,
                (float)position.getX(), (float)position.getY(), (float)position.getZ());
-
-    if (sfx_manager->getListenerPos().distance(position) > m_soundBuffer->getMaxDist())
-    {
-        alSourcef(m_soundSource, AL_GAIN, 0);
-    }
-    else
-    {
-        alSourcef(m_soundSource, AL_GAIN, (m_gain < 0.0f ? m_defaultGain : m_gain));
-    }
+    alSourcef(m_soundSource, AL_GAIN, getAudibleGain());
 
     SFXManager::checkError("positioning");
 }   // position
 
 //-----------------------------------------------------------------------------
-/** Returns the status of this sound effect.
+/** Returns the status of this sound effect. If a sound that has a source
+ *  has finished playing, its source is given back to the sfx manager.
  */
 SFXManager::SFXStatus SFXOpenAL::getStatus()
 {
-    if(!m_ok) return SFXManager::SFX_UNKNOWN;
-
-    int state = 0;
-    alGetSourcei(m_soundSource, AL_SOURCE_STATE, &state);
-    switch(state)
+    if(m_ok && m_status == SFXManager::SFX_PLAYING)
     {
-    case AL_STOPPED: return SFXManager::SFX_STOPPED;
-    case AL_PLAYING: return SFXManager::SFX_PLAYING;
-    case AL_PAUSED:  return SFXManager::SFX_PAUSED;
-    case AL_INITIAL: return SFXManager::SFX_INITIAL;
-    default:         return SFXManager::SFX_UNKNOWN;
+        int state = 0;
+        alGetSourcei(m_soundSource, AL_SOURCE_STATE, &state);
+        if (state == AL_STOPPED)
+        {
+            m_status = SFXManager::SFX_STOPPED;
+            sfx_manager->releaseSource(this);
+        }
     }
+    return m_status;
 }   // getStatus
 
 //-----------------------------------------------------------------------------
-
+/** Called when sound is enabled again: a looped sound that was not played
+ *  (since sound was disabled) is marked as paused, so that it can be
+ *  resumed.
+ */
 void SFXOpenAL::onSoundEnabledBack()
 {
-    if (m_loop)
-    {
-        if (!m_ok) init();
-        if (m_ok)
-        {
-            alSourcef(m_soundSource, AL_GAIN, 0);
-            play();
-            pause();
-            alSourcef(m_soundSource, AL_GAIN, (m_gain < 0.0f ? m_defaultGain : m_gain));
-        }
-    }
-}
+    if (m_loop && m_status != SFXManager::SFX_PLAYING)
+        m_status = SFXManager::SFX_PAUSED;
+}   // onSoundEnabledBack
 
 //-----------------------------------------------------------------------------
 
 void SFXOpenAL::setRolloff(float rolloff)
 {
+    m_rolloff = rolloff;
+
+    if (!m_ok) return;
     alSourcef (m_soundSource, AL_ROLLOFF_FACTOR,  rolloff);
-}
+}   // setRolloff
 
 #endif //if HAVE_OGGVORBIS
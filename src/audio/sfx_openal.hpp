@@ -40,6 +40,9 @@ class SFXOpenAL : public SFXBase
 private:
     SFXBuffer*   m_soundBuffer;   //!< Buffers hold sound data.
     ALuint       m_soundSource;   //!< Sources are points emitting sound.
+    /** True if this sound currently has an OpenAL source from the source
+     *  pool of the sfx manager. Otherwise it is a 'virtual' sound which
+     *  only keeps its state. */
     bool         m_ok;
     bool         m_positional;
     float        m_defaultGain;
@@ -56,8 +59,20 @@ private:
      sounds later. */
     float m_gain;
 
+    /** The status of this sound, independent of having a source or not. */
+    SFXManager::SFXStatus m_status;
+
+    /** The pitch, position and rolloff factor of this sound, which are
+     *  applied when the sound gets a source. */
+    float m_pitch;
+    Vec3  m_position;
+    float m_rolloff;
+
     bool m_owns_buffer;
 
+    void                          start();
+    float                         getAudibleGain() const;
+
 public:
                                   SFXOpenAL(SFXBuffer* buffer, bool positional, float gain,
                                             bool owns_buffer = false);
@@ -80,6 +95,17 @@ public:
 
     virtual const SFXBuffer* getBuffer() const { return m_soundBuffer; }
 
+    void                          attachSource(ALuint source);
+    ALuint                        detachSource();
+    float                         getPriority() const;
+    // ------------------------------------------------------------------------
+    /** Returns true if this sound currently has an OpenAL source. */
+    bool                          hasSource() const { return m_ok; }
+    // ------------------------------------------------------------------------
+    /** Returns the status without querying OpenAL, i.e. a sound that has
+     *  just finished might still be reported as playing. */
+    SFXManager::SFXStatus         getLogicalStatus() const { return m_status; }
+
     LEAK_CHECK()
 
 };   // SFXOpenAL
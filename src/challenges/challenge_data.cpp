@@ -336,7 +336,7 @@ void ChallengeData::setUnlocks(const std::string &id, RewardType reward)
                             }
     case UNLOCK_KART:       {
                             const KartProperties* prop =
-                                kart_properties_manager->getKart(id);
+                                kart_properties_manager->getKartMetadata(id);
                             if (prop == NULL)
                             {
                                 fprintf(stderr, "Challenge refers to kart %s, "
@@ -515,7 +515,7 @@ const irr::core::stringw
         case UNLOCK_KART:
         {
             const KartProperties* kp =
-            kart_properties_manager->getKart(m_name);
+            kart_properties_manager->getKartMetadata(m_name);
 
             // shouldn't happen but let's avoid crashes as much as possible...
             if (kp == NULL) return irr::core::stringw( L"????" );
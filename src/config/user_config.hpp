@@ -315,6 +315,17 @@ namespace UserConfigParams
     PARAM_PREFIX FloatUserConfigParam       m_music_volume
             PARAM_DEFAULT(  FloatUserConfigParam(0.7f, "music_volume",
             &m_audio_group, "Music volume from 0.0 to 1.0") );
+    PARAM_PREFIX IntUserConfigParam         m_sfx_buffer_memory
+            PARAM_DEFAULT(  IntUserConfigParam(32, "sfx_buffer_memory",
+            &m_audio_group, "Memory (in MB) for loaded sound effects. If "
+                            "more is needed, the least recently used sound "
+                            "effects which are not playing are unloaded.") );
+    PARAM_PREFIX IntUserConfigParam         m_sfx_max_sources
+            PARAM_DEFAULT(  IntUserConfigParam(32, "sfx_max_sources",
+            &m_audio_group, "Maximum number of sound effects that are played "
+                            "at the same time. If more sounds are used, only "
+                            "the most important ones (e.g. the closest) are "
+                            "heard.") );
 
     // ---- Race setup
     PARAM_PREFIX GroupUserConfigParam        m_race_setup_group
@@ -558,6 +569,12 @@ namespace UserConfigParams
     PARAM_PREFIX BoolUserConfigParam        m_cache_overworld
             PARAM_DEFAULT(  BoolUserConfigParam(true, "cache-overworld") );
 
+    PARAM_PREFIX BoolUserConfigParam        m_texture_cache
+            PARAM_DEFAULT(  BoolUserConfigParam(false, "texture-cache",
+                            "Store decoded textures and their mipmaps in "
+                            "the cache directory (faster loading, but "
+                            "needs a lot of disk space)") );
+
     PARAM_PREFIX BoolUserConfigParam        m_minimal_race_gui
             PARAM_DEFAULT(  BoolUserConfigParam(false, "minimal-race-gui") );
     // TODO : is this used with new code? does it still work?
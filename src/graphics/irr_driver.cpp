@@ -26,6 +26,7 @@
 #include "graphics/per_camera_node.hpp"
 #include "graphics/post_processing.hpp"
 #include "graphics/referee.hpp"
+#include "graphics/texture_cache.hpp"
 #include "guiengine/engine.hpp"
 #include "guiengine/modaldialog.hpp"
 #include "guiengine/scalable_font.hpp"
@@ -47,9 +48,13 @@
 #include "utils/constants.hpp"
 #include "utils/log.hpp"
 #include "utils/profiler.hpp"
+#include "utils/string_utils.hpp"
+#include "utils/worker_pool.hpp"
 
 #include <irrlicht.h>
 
+#include <set>
+
 /* Build-time check that the Irrlicht we're building against works for us.
  * Should help prevent distros building against an incompatible library.
  */
@@ -1084,7 +1089,10 @@ video::ITexture *IrrDriver::getTexture(const std::string &filename,
     if(!is_premul && !is_prediv)
     {
         if (!complain_if_not_found) m_device->getLogger()->setLogLevel(ELL_NONE);
-        out = m_video_driver->getTexture(filename.c_str());
+        out = UserConfigParams::m_texture_cache ? getCachedTexture(filename)
+                                                : NULL;
+        if (!out)
+            out = m_video_driver->getTexture(filename.c_str());
         if (!complain_if_not_found) m_device->getLogger()->setLogLevel(ELL_WARNING);
     }
     else
@@ -1156,6 +1164,225 @@ video::ITexture *IrrDriver::getTexture(const std::string &filename,
     return out;
 }   // getTexture
 
+// ----------------------------------------------------------------------------
+/** Returns if a file is a png or jpg image, i.e. can be handled by the
+ *  texture cache and preloadTextures().
+ *  \param filename Name of the file.
+ *  \param is_jpg On return true if the file is a jpg image.
+ */
+static bool isPngOrJpg(const std::string &filename, bool *is_jpg)
+{
+    const std::string name = StringUtils::toLowerCase(filename);
+    *is_jpg = StringUtils::hasSuffix(name, ".jpg") ||
+              StringUtils::hasSuffix(name, ".jpeg");
+    return *is_jpg || StringUtils::hasSuffix(name, ".png");
+}   // isPngOrJpg
+
+// ----------------------------------------------------------------------------
+/** Loads a png or jpg texture using the texture cache, which stores the
+ *  decoded image and its mipmaps (see TextureCache). If the cache file
+ *  does not exist, the image is decoded and the cache file is written.
+ *  \param filename Name of the image file.
+ *  \return The texture, or NULL if the file is not a png or jpg image
+ *          or could not be loaded (e.g. because it is in an archive), in
+ *          which case irrlicht should load the texture.
+ */
+video::ITexture *IrrDriver::getCachedTexture(const std::string &filename)
+{
+    bool is_jpg;
+    if(!isPngOrJpg(filename, &is_jpg))
+        return NULL;
+
+    // Textures are identified by their absolute file name, see
+    // CNullDriver::getTexture
+    const io::path path =
+        m_device->getFileSystem()->getAbsolutePath(filename.c_str());
+    video::ITexture *texture = m_video_driver->findTexture(path);
+    if(texture)
+        return texture;
+
+    const std::string name(path.c_str());
+    const std::string cache_file = TextureCache::getCacheFile(name);
+    u8 *mipmaps = NULL;
+    video::IImage *image = TextureCache::load(m_video_driver, name,
+                                              cache_file, &mipmaps);
+    if(!image)
+    {
+        image = m_video_driver->createImageFromFile(path);
+        if(!image)
+            return NULL;
+        video::IImage *cached = TextureCache::save(m_video_driver, image,
+                                                   name, cache_file,
+                                                   &mipmaps);
+        if(cached)
+        {
+            image->drop();
+            image = cached;
+        }
+    }
+    if(!mipmaps ||
+       !TextureCache::canUseMipmaps(m_video_driver, image->getDimension()))
+        mipmaps = NULL;
+    texture = m_video_driver->addTexture(path, image, mipmaps);
+    image->drop();
+    return texture;
+}   // getCachedTexture
+
+// ----------------------------------------------------------------------------
+/** Loads the textures of several image files. The files are read and decoded
+ *  in parallel by the worker pool, only the creation of the textures (i.e.
+ *  the upload to the graphics card) is done in this (the main) thread.
+ *  The textures are stored in irrlicht's texture cache under the same name
+ *  getTexture() would use, so later calls of getTexture() (including the
+ *  ones done by irrlicht's mesh loaders) for these files will just return
+ *  the preloaded texture.
+ *  \param filenames Full paths of the files to load. Files which are not
+ *         png or jpg images, or are already loaded, are ignored.
+ *  \param textures The new textures are appended to this vector. They are
+ *         grabbed, see releasePreloadedTextures().
+ */
+void IrrDriver::preloadTextures(const std::vector<std::string> &filenames,
+                                std::vector<video::ITexture*> *textures)
+{
+    /** Reads and decodes one image file (or loads it from the texture
+     *  cache). */
+    class DecodeJob : public WorkerPool::Job
+    {
+    public:
+        video::IVideoDriver         *m_driver;
+        io::IFileSystem             *m_file_system;
+        std::vector<io::path>        m_names;
+        std::vector<bool>            m_is_jpg;
+        /** Name of the texture cache file, empty if the cache is not
+         *  used. */
+        std::vector<std::string>     m_cache_files;
+        std::vector<video::IImage*>  m_images;
+        /** The mipmaps from the texture cache (or NULL). */
+        std::vector<u8*>             m_mipmaps;
+        /** Irrlicht's jpg loader stores the name of the file being
+         *  decoded in a static variable, so jpgs must not be decoded
+         *  at the same time. */
+        pthread_mutex_t              m_jpg_mutex;
+        // --------------------------------------------------------------------
+        virtual void run(unsigned int i)
+        {
+            const std::string name(m_names[i].c_str());
+            if(m_cache_files[i]!="")
+            {
+                m_images[i] = TextureCache::load(m_driver, name,
+                                                 m_cache_files[i],
+                                                 &m_mipmaps[i]);
+                if(m_images[i]) return;
+            }
+            m_images[i] = decode(i);
+            if(m_images[i] && m_cache_files[i]!="")
+            {
+                video::IImage *cached =
+                    TextureCache::save(m_driver, m_images[i], name,
+                                       m_cache_files[i], &m_mipmaps[i]);
+                if(cached)
+                {
+                    m_images[i]->drop();
+                    m_images[i] = cached;
+                }
+            }
+        }   // run
+        // --------------------------------------------------------------------
+        /** Reads and decodes the image file with the given index. */
+        video::IImage *decode(unsigned int i)
+        {
+            FILE *f = fopen(m_names[i].c_str(), "rb");
+            if(!f) return NULL;
+            fseek(f, 0, SEEK_END);
+            const long size = ftell(f);
+            fseek(f, 0, SEEK_SET);
+            u8 *data = size>0 ? new u8[size] : NULL;
+            const bool ok = data && fread(data, 1, size, f)==(size_t)size;
+            fclose(f);
+            if(!ok)
+            {
+                delete [] data;
+                return NULL;
+            }
+            io::IReadFile *file =
+                m_file_system->createMemoryReadFile(data, size, m_names[i],
+                                        /*deleteMemoryWhenDropped*/true);
+            if(m_is_jpg[i]) pthread_mutex_lock(&m_jpg_mutex);
+            video::IImage *image = m_driver->createImageFromFile(file);
+            if(m_is_jpg[i]) pthread_mutex_unlock(&m_jpg_mutex);
+            file->drop();
+            return image;
+        }   // decode
+    };   // DecodeJob
+
+    DecodeJob job;
+    std::set<std::string> names;
+    job.m_driver      = m_video_driver;
+    job.m_file_system = m_device->getFileSystem();
+    for(unsigned int i=0; i<filenames.size(); i++)
+    {
+        bool is_jpg;
+        if(!isPngOrJpg(filenames[i], &is_jpg))
+            continue;
+        // Textures are identified by their absolute file name, see
+        // CNullDriver::getTexture
+        const io::path path =
+            job.m_file_system->getAbsolutePath(filenames[i].c_str());
+        // Each file is only decoded once, which also makes sure that no
+        // two jobs write the same texture cache file
+        if(m_video_driver->findTexture(path) ||
+           !names.insert(path.c_str()).second)
+            continue;
+        job.m_names.push_back(path);
+        job.m_is_jpg.push_back(is_jpg);
+        job.m_cache_files.push_back(UserConfigParams::m_texture_cache
+                                ? TextureCache::getCacheFile(path.c_str())
+                                : "");
+    }
+    job.m_images.resize(job.m_names.size(), NULL);
+    job.m_mipmaps.resize(job.m_names.size(), NULL);
+
+    pthread_mutex_init(&job.m_jpg_mutex, NULL);
+    WorkerPool::execute(&job, job.m_names.size());
+    pthread_mutex_destroy(&job.m_jpg_mutex);
+
+    for(unsigned int i=0; i<job.m_names.size(); i++)
+    {
+        if(!job.m_images[i]) continue;
+        u8 *mipmaps = job.m_mipmaps[i];
+        if(mipmaps &&
+           !TextureCache::canUseMipmaps(m_video_driver,
+                                        job.m_images[i]->getDimension()))
+            mipmaps = NULL;
+        video::ITexture *t = m_video_driver->addTexture(job.m_names[i],
+                                                        job.m_images[i],
+                                                        mipmaps);
+        job.m_images[i]->drop();
+        if(!t) continue;
+        t->grab();
+        textures->push_back(t);
+    }
+}   // preloadTextures
+
+// ----------------------------------------------------------------------------
+/** Drops the textures loaded by preloadTextures(). Textures which are not
+ *  used anymore (i.e. are only referenced by irrlicht's texture cache) are
+ *  removed.
+ *  \param textures The textures, the vector will be cleared.
+ */
+void IrrDriver::releasePreloadedTextures(std::vector<video::ITexture*> *textures)
+{
+    for(unsigned int i=0; i<textures->size(); i++)
+    {
+        video::ITexture *t = (*textures)[i];
+        // Only referenced by the texture cache and the preload
+        if(t->getReferenceCount()==2)
+            removeTexture(t);
+        t->drop();
+    }
+    textures->clear();
+}   // releasePreloadedTextures
+
 // ----------------------------------------------------------------------------
 /** Appends a pointer to each texture used in this mesh to the vector.
  *  \param mesh The mesh from which the textures are being determined.
@@ -109,6 +109,7 @@ private:
     /** Internal method that applies the resolution in user settings. */
     void                 applyResolutionSettings();
     void                 createListOfVideoModes();
+    video::ITexture     *getCachedTexture(const std::string &filename);
 
     bool                 m_request_screenshot;
 
@@ -141,6 +142,10 @@ public:
                                      bool is_premul=false,
                                      bool is_prediv=false,
                                      bool complain_if_not_found=true);
+    void                  preloadTextures(const std::vector<std::string> &filenames,
+                                          std::vector<video::ITexture*> *textures);
+    void                  releasePreloadedTextures(
+                                     std::vector<video::ITexture*> *textures);
     void                  grabAllTextures(const scene::IMesh *mesh);
     void                  dropAllTextures(const scene::IMesh *mesh);
     scene::IMesh         *createQuadMesh(const video::SMaterial *material=NULL,
@@ -25,6 +25,7 @@
 #include "io/file_manager.hpp"
 #include "tracks/track.hpp"
 #include "utils/constants.hpp"
+#include "utils/log.hpp"
 
 #include <SParticle.h>
 #include <IParticleAffector.h>
@@ -33,6 +34,16 @@
 #include <IParticleBoxEmitter.h>
 #include <ISceneManager.h>
 
+#include <vector>
+
+// The affectors below handle four particles at a time if SSE2 is
+// available (always the case on x86-64).
+#if defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#  define PARTICLE_AFFECTOR_SSE2
+#  include <emmintrin.h>
+#endif
+
 class FadeAwayAffector : public scene::IParticleAffector
 {
     /** (Squared) distance from camera at which a particle started being faded out */
@@ -55,11 +66,69 @@ public:
     {
         scene::ICameraSceneNode* curr_cam =
             irr_driver->getSceneManager()->getActiveCamera();
-        const core::vector3df& cam_pos = curr_cam->getPosition();
 
         // printf("Affect called with now=%u, camera=%s\n", now, curr_cam->getName());
 
-        for (unsigned int n=0; n<count; n++)
+        fade(curr_cam->getPosition(), particlearray, count);
+    }   // affect
+
+    // ------------------------------------------------------------------------
+    /** Sets the alpha value of the particles depending on their distance to
+     *  the camera.
+     *  \param cam_pos Position of the camera.
+     *  \param particlearray, count The particles.
+     *  \param vectorized If false, the SSE2 code is not used (which is only
+     *         done by ParticleEmitter::profileAffectors).
+     */
+    void fade(const core::vector3df &cam_pos, scene::SParticle* particlearray,
+              u32 count, bool vectorized=true)
+    {
+        unsigned int n = 0;
+#ifdef PARTICLE_AFFECTOR_SSE2
+        // Four particles at a time. The operations are the same (and in the
+        // same order) as in the scalar loop below, so the results are
+        // identical to handling each particle on its own.
+        const __m128  cam_x  = _mm_set1_ps(cam_pos.X);
+        const __m128  cam_y  = _mm_set1_ps(cam_pos.Y);
+        const __m128  cam_z  = _mm_set1_ps(cam_pos.Z);
+        const __m128  start  = _mm_set1_ps(m_start_fading);
+        const __m128  end    = _mm_set1_ps(m_end_fading);
+        const __m128  range  = _mm_set1_ps(m_end_fading - m_start_fading);
+        const __m128i opaque = _mm_set1_epi32(255);
+        for (; vectorized && n+4<=count; n+=4)
+        {
+            scene::SParticle* p = particlearray+n;
+            const __m128 x = _mm_sub_ps(_mm_setr_ps(p[0].pos.X, p[1].pos.X,
+                                                    p[2].pos.X, p[3].pos.X),
+                                        cam_x);
+            const __m128 y = _mm_sub_ps(_mm_setr_ps(p[0].pos.Y, p[1].pos.Y,
+                                                    p[2].pos.Y, p[3].pos.Y),
+                                        cam_y);
+            const __m128 z = _mm_sub_ps(_mm_setr_ps(p[0].pos.Z, p[1].pos.Z,
+                                                    p[2].pos.Z, p[3].pos.Z),
+                                        cam_z);
+            const __m128 distance_squared =
+                _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)),
+                           _mm_mul_ps(z, z));
+
+            __m128i alpha = _mm_cvttps_epi32(
+                _mm_div_ps(_mm_sub_ps(distance_squared, start), range));
+            const __m128i far_away =
+                _mm_castps_si128(_mm_cmpgt_ps(distance_squared, end));
+            const __m128i close =
+                _mm_castps_si128(_mm_cmplt_ps(distance_squared, start));
+            alpha = _mm_andnot_si128(far_away, alpha);
+            alpha = _mm_or_si128(_mm_andnot_si128(close, alpha),
+                                 _mm_and_si128(close, opaque));
+
+            int a[4];
+            _mm_storeu_si128((__m128i*)a, alpha);
+            for (unsigned int k=0; k<4; k++)
+                p[k].color.setAlpha(a[k]);
+        }   // for n+4<=count
+#endif
+
+        for (; n<count; n++)
         {
             scene::SParticle& curr = particlearray[n];
             core::vector3df diff = curr.pos - cam_pos;
@@ -82,7 +151,7 @@ public:
                                         / (m_end_fading - m_start_fading)));
             }
         }   // for n<count
-    }   // affect
+    }   // fade
 
     // ------------------------------------------------------------------------
 
@@ -99,42 +168,139 @@ public:
 
 class HeightMapCollisionAffector : public scene::IParticleAffector
 {
-    std::vector< std::vector<float> > m_height_map;
-    Track* m_track;
+    /** The height map of the track (see Track::getHeightMap), which is
+     *  kept by the track for its whole lifetime. */
+    const float *m_height_map;
+    /** Minimum X and Z coordinate of the track. */
+    float m_track_x, m_track_z;
+    /** Factors to convert a coordinate into a height map index. */
+    float m_x_scale, m_z_scale;
     bool m_first_time;
 
 public:
-    HeightMapCollisionAffector(Track* t) : m_height_map(t->buildHeightMap())
+    HeightMapCollisionAffector(Track* t)
+    {
+        const Vec3* aabb_min;
+        const Vec3* aabb_max;
+        t->getAABB(&aabb_min, &aabb_max);
+        init(&(t->getHeightMap()[0]), *aabb_min, *aabb_max);
+    }
+
+    /** Creates the affector for a height map which covers the given area
+     *  (used by ParticleEmitter::profileAffectors). */
+    HeightMapCollisionAffector(const float *height_map, const Vec3 &aabb_min,
+                               const Vec3 &aabb_max)
+    {
+        init(height_map, aabb_min, aabb_max);
+    }
+
+    void init(const float *height_map, const Vec3 &aabb_min,
+              const Vec3 &aabb_max)
     {
-        m_track = t;
+        m_height_map = height_map;
+        m_track_x = aabb_min.getX();
+        m_track_z = aabb_min.getZ();
+        m_x_scale = HEIGHT_MAP_RESOLUTION/(aabb_max.getX() - m_track_x);
+        m_z_scale = HEIGHT_MAP_RESOLUTION/(aabb_max.getZ() - m_track_z);
         m_first_time = true;
     }
 
+    /** Returns the index in the height map for a position, or -1 if the
+     *  position is outside of the height map. */
+    int getIndex(const core::vector3df &pos) const
+    {
+        const int i = (int)( (pos.X - m_track_x)*m_x_scale );
+        const int j = (int)( (pos.Z - m_track_z)*m_z_scale );
+        if (i >= HEIGHT_MAP_RESOLUTION || j >= HEIGHT_MAP_RESOLUTION) return -1;
+        if (i < 0 || j < 0) return -1;
+        return i*HEIGHT_MAP_RESOLUTION+j;
+    }
+
     virtual void affect(u32 now, scene::SParticle* particlearray, u32 count)
     {
-        const Vec3* aabb_min;
-        const Vec3* aabb_max;
-        m_track->getAABB(&aabb_min, &aabb_max);
-        float track_x = aabb_min->getX();
-        float track_z = aabb_min->getZ();
-        const float track_x_len = aabb_max->getX() - aabb_min->getX();
-        const float track_z_len = aabb_max->getZ() - aabb_min->getZ();
+        if (m_first_time)
+        {
+            // Distribute the particles between their position and the
+            // ground, so that they don't all arrive at the same time.
+            for (unsigned int n=0; n<count; n++)
+            {
+                scene::SParticle& curr = particlearray[n];
+                const int index = getIndex(curr.pos);
+                if (index < 0) continue;
+                const float height = m_height_map[index];
+                curr.pos.Y = height
+                           + (curr.pos.Y - height)
+                                *((rand()%500)/500.0f);
+            }
+            m_first_time = false;
+            return;
+        }
 
-        for (unsigned int n=0; n<count; n++)
+        collide(particlearray, count);
+    }
+
+    /** Destroys all particles which are below the height map.
+     *  \param particlearray, count The particles.
+     *  \param vectorized If false, the SSE2 code is not used (which is only
+     *         done by ParticleEmitter::profileAffectors).
+     */
+    void collide(scene::SParticle* particlearray, u32 count,
+                 bool vectorized=true)
+    {
+        unsigned int n = 0;
+#ifdef PARTICLE_AFFECTOR_SSE2
+        // Compute the height map indices of four particles at a time, using
+        // the same operations as getIndex.
+        const __m128  track_x   = _mm_set1_ps(m_track_x);
+        const __m128  track_z   = _mm_set1_ps(m_track_z);
+        const __m128  x_scale   = _mm_set1_ps(m_x_scale);
+        const __m128  z_scale   = _mm_set1_ps(m_z_scale);
+        const __m128i zero      = _mm_setzero_si128();
+        const __m128i max_index = _mm_set1_epi32(HEIGHT_MAP_RESOLUTION-1);
+        for (; vectorized && n+4<=count; n+=4)
+        {
+            scene::SParticle* p = particlearray+n;
+            const __m128 x = _mm_setr_ps(p[0].pos.X, p[1].pos.X,
+                                         p[2].pos.X, p[3].pos.X);
+            const __m128 z = _mm_setr_ps(p[0].pos.Z, p[1].pos.Z,
+                                         p[2].pos.Z, p[3].pos.Z);
+            const __m128i i =
+                _mm_cvttps_epi32(_mm_mul_ps(_mm_sub_ps(x, track_x), x_scale));
+            const __m128i j =
+                _mm_cvttps_epi32(_mm_mul_ps(_mm_sub_ps(z, track_z), z_scale));
+            const __m128i outside =
+                _mm_or_si128(_mm_or_si128(_mm_cmplt_epi32(i, zero),
+                                          _mm_cmplt_epi32(j, zero)),
+                             _mm_or_si128(_mm_cmpgt_epi32(i, max_index),
+                                          _mm_cmpgt_epi32(j, max_index)));
+            const int outside_mask =
+                _mm_movemask_ps(_mm_castsi128_ps(outside));
+            if (outside_mask == 0xf) continue;
+
+            int ii[4], jj[4];
+            _mm_storeu_si128((__m128i*)ii, i);
+            _mm_storeu_si128((__m128i*)jj, j);
+            for (unsigned int k=0; k<4; k++)
+            {
+                if (outside_mask & (1<<k)) continue;
+                if (p[k].pos.Y < m_height_map[ii[k]*HEIGHT_MAP_RESOLUTION
+                                              + jj[k]])
+                    p[k].endTime = p[k].startTime; // destroy particle
+            }
+        }   // for n+4<=count
+#endif
+
+        for (; n<count; n++)
         {
             scene::SParticle& curr = particlearray[n];
-            const int i = (int)( (curr.pos.X - track_x)
-                                 /track_x_len*(HEIGHT_MAP_RESOLUTION) );
-            const int j = (int)( (curr.pos.Z - track_z)
-                                 /track_z_len*(HEIGHT_MAP_RESOLUTION) );
-            if (i >= HEIGHT_MAP_RESOLUTION || j >= HEIGHT_MAP_RESOLUTION) continue;
-            if (i < 0 || j < 0) continue;
+            const int index = getIndex(curr.pos);
+            if (index < 0) continue;
 
             /*
             // debug draw
             core::vector3df lp = curr.pos;
             core::vector3df lp2 = curr.pos;
-            lp2.Y = m_height_map[i][j] + 0.02f;
+            lp2.Y = m_height_map[index] + 0.02f;
 
             irr_driver->getVideoDriver()->draw3DLine(lp, lp2, video::SColor(255,255,0,0));
             core::vector3df lp3 = lp2;
@@ -147,23 +313,12 @@ public:
             irr_driver->getVideoDriver()->draw3DBox(core::aabbox3d< f32 >(lp2, lp3), video::SColor(255,255,0,0));
             */
 
-            if (m_first_time)
+            if (curr.pos.Y < m_height_map[index])
             {
-                curr.pos.Y = m_height_map[i][j]
-                           + (curr.pos.Y - m_height_map[i][j])
-                                *((rand()%500)/500.0f);
-            }
-            else
-            {
-                if (curr.pos.Y < m_height_map[i][j])
-                {
-                    //curr.color = video::SColor(255,255,0,0);
-                    curr.endTime = curr.startTime; // destroy particle
-                }
+                //curr.color = video::SColor(255,255,0,0);
+                curr.endTime = curr.startTime; // destroy particle
             }
         }
-
-        if (m_first_time) m_first_time = false;
     }
 
     virtual scene::E_PARTICLE_AFFECTOR_TYPE getType() const
@@ -545,3 +700,72 @@ void ParticleEmitter::resizeBox(float size)
     }
 #endif
 }
+
+//-----------------------------------------------------------------------------
+/** Measures the time the FadeAwayAffector and HeightMapCollisionAffector
+ *  need for 10000 to 100000 particles, both with and without the SSE2
+ *  code, and prints the results (--profile-particles). The particles are
+ *  randomly placed over a synthetic height map, so neither a camera nor a
+ *  track is needed.
+ */
+void ParticleEmitter::profileAffectors()
+{
+    const Vec3 aabb_min(-100.0f, -10.0f, -100.0f);
+    const Vec3 aabb_max( 100.0f,  10.0f,  100.0f);
+    std::vector<float> height_map(HEIGHT_MAP_RESOLUTION*HEIGHT_MAP_RESOLUTION);
+    for (unsigned int i=0; i<height_map.size(); i++)
+        height_map[i] = (rand()%2000)/100.0f - 10.0f;
+
+    FadeAwayAffector fade(10.0f*10.0f, 150.0f*150.0f);
+    HeightMapCollisionAffector collision(&height_map[0], aabb_min, aabb_max);
+    const core::vector3df cam_pos(0, 5.0f, 0);
+
+    static const u32 counts[] = { 10000, 30000, 100000 };
+    for (unsigned int c=0; c<sizeof(counts)/sizeof(u32); c++)
+    {
+        const u32 count = counts[c];
+        std::vector<scene::SParticle> particles(count);
+        for (u32 i=0; i<count; i++)
+        {
+            // Some particles are outside of the height map
+            scene::SParticle &p = particles[i];
+            p.pos.set((rand()%2400)/10.0f - 120.0f,
+                      (rand()%2000)/100.0f - 10.0f,
+                      (rand()%2400)/10.0f - 120.0f);
+            p.startTime = 0;
+            p.endTime   = 1000;
+        }
+        std::vector<scene::SParticle> scalar = particles;
+
+        // The same total number of particles for each count
+        const unsigned int updates = 100000000/count;
+        float time[2][2];
+        for (unsigned int vectorized=0; vectorized<2; vectorized++)
+        {
+            std::vector<scene::SParticle> &p = vectorized ? particles
+                                                          : scalar;
+            unsigned int start = irr_driver->getRealTime();
+            for (unsigned int i=0; i<updates; i++)
+                fade.fade(cam_pos, &p[0], count, vectorized!=0);
+            time[vectorized][0] = (irr_driver->getRealTime()-start)
+                                / (float)updates;
+            start = irr_driver->getRealTime();
+            for (unsigned int i=0; i<updates; i++)
+                collision.collide(&p[0], count, vectorized!=0);
+            time[vectorized][1] = (irr_driver->getRealTime()-start)
+                                / (float)updates;
+        }
+
+        bool same = true;
+        for (u32 i=0; i<count; i++)
+        {
+            same = same &&
+                particles[i].color.getAlpha()==scalar[i].color.getAlpha() &&
+                particles[i].endTime==scalar[i].endTime;
+        }
+        Log::info("ParticleEmitter", "%6u particles: fade %.4f ms "
+                  "(scalar %.4f ms), collision %.4f ms (scalar %.4f ms)%s",
+                  count, time[1][0], time[0][0], time[1][1], time[0][1],
+                  same ? "" : ", RESULTS DIFFER");
+    }   // for c
+}   // profileAffectors
@@ -102,6 +102,8 @@ public:
     void         unsetNode() { m_node = NULL; }
 
     void         addHeightMapAffector(Track* t);
+
+    static void  profileAffectors();
 };
 #endif
 
@@ -25,6 +25,7 @@
 #include "karts/controller/controller.hpp"
 #include "karts/abstract_kart.hpp"
 #include "karts/kart_properties.hpp"
+#include "karts/kart_spatial_index.hpp"
 #include "karts/max_speed.hpp"
 #include "modes/world.hpp"
 #include "tracks/quad.hpp"
@@ -384,16 +385,20 @@ void SlipStream::update(float dt)
     // Then test if this kart is in the slipstream range of another kart:
     // ------------------------------------------------------------------
     World *world           = World::getWorld();
-    unsigned int num_karts = world->getNumKarts();
     bool is_sstreaming     = false;
     m_target_kart          = NULL;
 
-    // Note that this loop can not be simply replaced with a shorter loop
-    // using only the karts with a better position - since a kart might
-    // be a lap behind
-    for(unsigned int i=0; i<num_karts; i++)
+    // Only karts that are close enough can be slipstreamed. Note that this
+    // loop can not be simply replaced with a shorter loop using only the
+    // karts with a better position - since a kart might be a lap behind
+    const KartSpatialIndex *index = world->getKartIndex();
+    std::vector<AbstractKart*> karts;
+    index->getKartsInRadius(m_kart->getXYZ(),
+                            index->getMaxSlipstreamReach()
+                            + 0.5f*m_kart->getKartLength(), &karts);
+    for(unsigned int i=0; i<karts.size(); i++)
     {
-        m_target_kart= world->getKart(i);
+        m_target_kart= karts[i];
         // Don't test for slipstream with itself, a kart that is being
         // rescued or exploding, or an eliminated kart
         if(m_target_kart==m_kart               ||
@@ -449,11 +454,11 @@ void SlipStream::update(float dt)
             m_kart->getController()->isPlayerController())
             m_target_kart->getSlipstream()
                          ->setDebugColor(video::SColor(255, 0, 0, 255));
-    }   // for i < num_karts
+    }   // for i < karts.size()
 
     if(!is_sstreaming)
     {
-        if(UserConfigParams::m_slipstream_debug &&
+        if(UserConfigParams::m_slipstream_debug && m_target_kart &&
             m_kart->getController()->isPlayerController())
             m_target_kart->getSlipstream()
                          ->setDebugColor(video::SColor(255, 255, 0, 0));
@@ -0,0 +1,230 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2013 Joerg Henrichs
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#include "graphics/texture_cache.hpp"
+
+#include "io/cache_file.hpp"
+
+#include <IImage.h>
+#include <IVideoDriver.h>
+
+/** Identifies a texture cache file. */
+static const char         TEXTURE_CACHE_MAGIC[4]   = {'S', 'T', 'K', 'T'};
+
+/** Version of the texture cache files. This must be increased whenever
+ *  the file format or the way the mipmaps are computed changes. */
+static const unsigned int TEXTURE_CACHE_VERSION    = 3;
+
+/** Larger images are not cached (which also avoids overflows when
+ *  computing the data size of corrupt files). */
+static const unsigned int TEXTURE_CACHE_MAX_SIZE   = 8192;
+
+/** Size of the image stored in a texture cache file. The data is the image
+ *  followed by all its mipmap levels, see CacheFile for the file format. */
+struct TextureCacheInfo
+{
+    unsigned int m_width;
+    unsigned int m_height;
+};   // TextureCacheInfo
+
+namespace TextureCache
+{
+// ----------------------------------------------------------------------------
+/** Returns the number of bytes of an A8R8G8B8 image followed by all its
+ *  mipmap levels. The mipmap sizes are the ones used by irrlicht, see
+ *  COpenGLTexture::regenerateMipMapLevels.
+ *  \param width, height Size of the image.
+ */
+static unsigned int getDataSize(unsigned int width, unsigned int height)
+{
+    unsigned int size = width*height*4;
+    while(width>1 || height>1)
+    {
+        if(width>1)  width  >>= 1;
+        if(height>1) height >>= 1;
+        size += width*height*4;
+    }
+    return size;
+}   // getDataSize
+
+// ----------------------------------------------------------------------------
+/** Computes the next mipmap level of an A8R8G8B8 image with a 2x2 box filter
+ *  (a dimension that is already 1 is not reduced, and for odd sizes the
+ *  last row/column is ignored, as with the mipmap sizes used by irrlicht).
+ *  \param src The previous level.
+ *  \param width, height Size of the previous level.
+ *  \param dst The next level (of size max(width/2,1) x max(height/2,1)).
+ */
+static void downsample(const u8 *src, unsigned int width, unsigned int height,
+                       u8 *dst)
+{
+    const unsigned int new_width  = width >1 ? width >>1 : 1;
+    const unsigned int new_height = height>1 ? height>>1 : 1;
+    const unsigned int dx = width >1 ? 4       : 0;
+    const unsigned int dy = height>1 ? width*4 : 0;
+    for(unsigned int y=0; y<new_height; y++)
+    {
+        const u8 *row = src + (height>1 ? 2*y : y)*width*4;
+        for(unsigned int x=0; x<new_width; x++)
+        {
+            const u8 *p = row + (width>1 ? 2*x : x)*4;
+            for(unsigned int c=0; c<4; c++)
+            {
+                *dst++ = (u8)((p[c] + p[c+dx] + p[c+dy] + p[c+dx+dy] + 2)
+                              / 4);
+            }
+        }   // for x
+    }   // for y
+}   // downsample
+
+// ----------------------------------------------------------------------------
+/** Returns the name of the cache file for an image.
+ *  \param filename Full path of the image.
+ */
+std::string getCacheFile(const std::string &filename)
+{
+    return CacheFile::getName("texture-", filename, ".cache");
+}   // getCacheFile
+
+// ----------------------------------------------------------------------------
+/** Loads an image from its cache file. The cache file is only used if it
+ *  was created for this image, the image was not modified since then, and
+ *  the checksum of the data is correct (see CacheFile::read).
+ *  \param driver The video driver used to create the image.
+ *  \param filename Full path of the image.
+ *  \param cache_file Name of the cache file, see getCacheFile().
+ *  \param mipmaps On return points to the mipmap data, which is stored in
+ *         the same memory block as the image (so it must not be freed, and
+ *         is only valid as long as the image exists).
+ *  \return The image (A8R8G8B8), or NULL if no valid cache file exists.
+ */
+video::IImage *load(video::IVideoDriver *driver, const std::string &filename,
+                    const std::string &cache_file, u8 **mipmaps)
+{
+    TextureCacheInfo info;
+    unsigned int data_size;
+    u8 *data = (u8*)CacheFile::read(cache_file, TEXTURE_CACHE_MAGIC,
+                                    TEXTURE_CACHE_VERSION, filename,
+                                    &info, sizeof(info),
+                                    getDataSize(TEXTURE_CACHE_MAX_SIZE,
+                                                TEXTURE_CACHE_MAX_SIZE),
+                                    &data_size);
+    if(!data) return NULL;
+    if(info.m_width ==0 || info.m_width >TEXTURE_CACHE_MAX_SIZE ||
+       info.m_height==0 || info.m_height>TEXTURE_CACHE_MAX_SIZE ||
+       data_size!=getDataSize(info.m_width, info.m_height)        )
+    {
+        delete [] data;
+        return NULL;
+    }
+
+    const core::dimension2du size(info.m_width, info.m_height);
+    *mipmaps = data + size.Width*size.Height*4;
+    return driver->createImageFromData(video::ECF_A8R8G8B8, size, data,
+                                       /*ownForeignMemory*/true,
+                                       /*deleteMemory*/true);
+}   // load
+
+// ----------------------------------------------------------------------------
+/** Converts a decoded image into the format of the cache (A8R8G8B8 followed
+ *  by all mipmap levels), and saves it in its cache file.
+ *  \param driver The video driver used to create the image.
+ *  \param image The decoded image, which is not modified.
+ *  \param filename Full path of the image.
+ *  \param cache_file Name of the cache file, see getCacheFile().
+ *  \param mipmaps On return points to the mipmap data, which is stored in
+ *         the same memory block as the returned image.
+ *  \return The converted image, or NULL if the image can not be cached.
+ */
+video::IImage *save(video::IVideoDriver *driver, video::IImage *image,
+                    const std::string &filename,
+                    const std::string &cache_file, u8 **mipmaps)
+{
+    const core::dimension2du &size = image->getDimension();
+    if(size.Width ==0 || size.Width >TEXTURE_CACHE_MAX_SIZE ||
+       size.Height==0 || size.Height>TEXTURE_CACHE_MAX_SIZE    )
+        return NULL;
+
+    const unsigned int data_size = getDataSize(size.Width, size.Height);
+    u8 *data = new u8[data_size];
+    video::IImage *result =
+        driver->createImageFromData(video::ECF_A8R8G8B8, size, data,
+                                    /*ownForeignMemory*/true,
+                                    /*deleteMemory*/true);
+    image->copyTo(result);
+
+    // Compute each mipmap level from the previous level with a box filter
+    // (scaling the full image down, e.g. with copyToScaling, would only
+    // use point sampling and cause aliasing).
+    *mipmaps = data + size.Width*size.Height*4;
+    const u8 *source = data;
+    u8 *target = *mipmaps;
+    unsigned int width = size.Width, height = size.Height;
+    while(width>1 || height>1)
+    {
+        downsample(source, width, height, target);
+        if(width>1)  width  >>= 1;
+        if(height>1) height >>= 1;
+        source  = target;
+        target += width*height*4;
+    }
+
+    TextureCacheInfo info;
+    info.m_width  = size.Width;
+    info.m_height = size.Height;
+    CacheFile::write(cache_file, TEXTURE_CACHE_MAGIC, TEXTURE_CACHE_VERSION,
+                     filename, &info, sizeof(info), data, data_size);
+    return result;
+}   // save
+
+// ----------------------------------------------------------------------------
+/** Returns if the mipmaps of the cache can be used when creating a texture
+ *  of the given size. This is only the case if the driver creates the
+ *  texture in A8R8G8B8 format with mipmaps, and without rescaling it. The
+ *  cached mipmaps are then uploaded instead of letting the driver compute
+ *  them again.
+ *  \param driver The video driver.
+ *  \param size Size of the image.
+ */
+bool canUseMipmaps(video::IVideoDriver *driver,
+                   const core::dimension2du &size)
+{
+    if(!driver->getTextureCreationFlag(video::ETCF_CREATE_MIP_MAPS)     ||
+        driver->getTextureCreationFlag(video::ETCF_ALWAYS_16_BIT)       ||
+        driver->getTextureCreationFlag(video::ETCF_OPTIMIZED_FOR_SPEED) ||
+        driver->getTextureCreationFlag(video::ETCF_NO_ALPHA_CHANNEL)       )
+        return false;
+
+    const core::dimension2du max_size = driver->getMaxTextureSize();
+    if(size.Width>max_size.Width || size.Height>max_size.Height)
+        return false;
+    return driver->queryFeature(video::EVDF_TEXTURE_NPOT) ||
+           size.getOptimalSize()==size;
+}   // canUseMipmaps
+
+// ----------------------------------------------------------------------------
+/** Removes all texture cache files which can not be used anymore, see
+ *  CacheFile::removeStaleFiles.
+ */
+void removeStaleFiles()
+{
+    CacheFile::removeStaleFiles("texture-", ".cache", TEXTURE_CACHE_MAGIC,
+                                TEXTURE_CACHE_VERSION);
+}   // removeStaleFiles
+
+}   // namespace TextureCache
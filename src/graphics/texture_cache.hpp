@@ -0,0 +1,60 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2013 Joerg Henrichs
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#ifndef HEADER_TEXTURE_CACHE_HPP
+#define HEADER_TEXTURE_CACHE_HPP
+
+#include <dimension2d.h>
+#include <irrTypes.h>
+
+#include <string>
+
+namespace irr
+{
+    namespace video { class IImage; class IVideoDriver; }
+}
+using namespace irr;
+
+/**
+  * \brief A disk cache of decoded textures.
+  * Decoding png and jpg files takes a large part of the loading time of a
+  * track, and the mipmaps of each texture are then computed when the
+  * texture is created. This cache stores the decoded image (as A8R8G8B8)
+  * together with all its mipmap levels in the cache directory, so that
+  * later loads only have to read one file. A cache file is only used if
+  * the size and modification time of the image did not change, other
+  * cache files are removed when STK exits (see removeStaleFiles). The
+  * files are read and written with CacheFile, so the functions can be
+  * called from any thread, see IrrDriver::preloadTextures.
+  * \ingroup graphics
+  */
+namespace TextureCache
+{
+    std::string    getCacheFile(const std::string &filename);
+    video::IImage *load(video::IVideoDriver *driver,
+                        const std::string &filename,
+                        const std::string &cache_file, u8 **mipmaps);
+    video::IImage *save(video::IVideoDriver *driver, video::IImage *image,
+                        const std::string &filename,
+                        const std::string &cache_file, u8 **mipmaps);
+    bool           canUseMipmaps(video::IVideoDriver *driver,
+                                 const core::dimension2du &size);
+    void           removeStaleFiles();
+}   // TextureCache
+
+#endif
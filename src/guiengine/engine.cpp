@@ -1238,9 +1238,17 @@ namespace GUIEngine
 
     std::vector<irr::video::ITexture*> g_loading_icons;
 
+    /** Progress shown on the loading screen (0 to 1), or negative if no
+     *  progress bar is shown. */
+    float g_loading_progress = -1.0f;
+
     void renderLoading(bool clearIcons)
     {
-        if (clearIcons) g_loading_icons.clear();
+        if (clearIcons)
+        {
+            g_loading_icons.clear();
+            g_loading_progress = -1.0f;
+        }
 
         g_skin->drawBgImage();
         ITexture* loading =
@@ -1276,6 +1284,22 @@ namespace GUIEngine
                            SColor(255,255,255,255),
                            true/* center h */, false /* center v */ );
 
+        if (g_loading_progress >= 0)
+        {
+            const int bar_w = screen_w/2;
+            const int bar_h = std::max(screen_h/40, 4);
+            const int bar_x = screen_w/4;
+            const int bar_y = screen_h*3/4;
+            g_driver->draw2DRectangle(SColor(255, 40, 40, 40),
+                                      core::rect<s32>(bar_x, bar_y,
+                                                      bar_x+bar_w,
+                                                      bar_y+bar_h));
+            g_driver->draw2DRectangle(SColor(255,255,255,255),
+                        core::rect<s32>(bar_x, bar_y,
+                                        bar_x+(int)(bar_w*g_loading_progress),
+                                        bar_y+bar_h));
+        }
+
         const int icon_count = g_loading_icons.size();
         const int icon_size = (int)(screen_w / 16.0f);
         const int ICON_MARGIN = 6;
@@ -1322,6 +1346,24 @@ namespace GUIEngine
 
     // -----------------------------------------------------------------------
 
+    void setLoadingProgress(float progress)
+    {
+        if (progress > 1.0f) progress = 1.0f;
+        // Each update of the screen costs a frame (which might have to
+        // wait for vsync), so only update it in 10% steps.
+        const bool redraw = g_loading_progress < 0 ||
+                            (int)(progress*10) != (int)(g_loading_progress*10);
+        g_loading_progress = progress;
+        if (!redraw) return;
+
+        g_device->getVideoDriver()
+                ->beginScene(true, true, video::SColor(255,100,101,140));
+        renderLoading(false);
+        g_device->getVideoDriver()->endScene();
+    }   // setLoadingProgress
+
+    // -----------------------------------------------------------------------
+
     Widget* getWidget(const char* name)
     {
         // if a modal dialog is shown, search within it too
@@ -225,6 +225,10 @@ namespace GUIEngine
     /** \brief to spice up a bit the loading icon : add icons to the loading screen */
     void addLoadingIcon(irr::video::ITexture* icon);
 
+    /** \brief shows a progress bar (0 to 1) on the loading screen, it is
+      * removed again by renderLoading(true) */
+    void setLoadingProgress(float progress);
+
     /** \brief      Finds a widget from its name (PROP_ID) in the current screen/dialog
       * \param name the name (PROP_ID) of the widget to search for
       * \return     the widget that bears that name, or NULL if it was not found
@@ -0,0 +1,300 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2013 Joerg Henrichs
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#include "io/cache_file.hpp"
+
+#include "io/file_manager.hpp"
+#include "io/metadata_index.hpp"
+#include "utils/log.hpp"
+#include "utils/string_utils.hpp"
+#include "utils/synchronised.hpp"
+
+#include <set>
+#include <stdio.h>
+#include <string.h>
+
+#ifdef WIN32
+#  include <process.h>
+#  define getpid _getpid
+#else
+#  include <unistd.h>
+#endif
+
+/** Written in native byte order, to detect cache files from a system with
+ *  a different byte order (the data is stored in native byte order). */
+static const unsigned int CACHE_FILE_BYTE_ORDER = 0x01020304;
+
+/** Longest path of a data file that is accepted in a cache file. */
+static const unsigned int CACHE_FILE_MAX_NAME   = 4096;
+
+/** Header of a cache file. It is followed by the full path of the data
+ *  file, the cache specific information, and the data. */
+struct CacheFileHeader
+{
+    char         m_magic[4];
+    unsigned int m_version;
+    unsigned int m_byte_order;
+    unsigned int m_mtime;
+    unsigned int m_file_size;
+    unsigned int m_name_length;
+    unsigned int m_info_size;
+    unsigned int m_data_size;
+    /** Checksum of the information and the data. */
+    unsigned int m_checksum;
+};   // CacheFileHeader
+
+/** Counter to create unique names of temporary files within a process. */
+static Synchronised<unsigned int> g_temp_file_counter(0);
+
+namespace CacheFile
+{
+// ----------------------------------------------------------------------------
+/** Computes the 32 bit FNV-1a hash of a block of data.
+ *  \param data The data.
+ *  \param size Size of the data in bytes.
+ *  \param hash Hash value to continue from, which allows to hash data
+ *         which is stored in several blocks.
+ */
+unsigned int fnvHash(const void *data, unsigned int size, unsigned int hash)
+{
+    const unsigned char *p = (const unsigned char*)data;
+    for(unsigned int i=0; i<size; i++)
+        hash = (hash ^ p[i]) * 16777619u;
+    return hash;
+}   // fnvHash
+
+// ----------------------------------------------------------------------------
+/** Returns the full path of the cache file of a data file. The name
+ *  contains a 64 bit hash of the full path of the data file, so in
+ *  practice each data file gets its own cache file (and in case of a
+ *  collision the cache file is just not used, since the path of the data
+ *  file is stored in it as well).
+ *  \param prefix Prefix of the name, which identifies the type of cache.
+ *  \param filename Full path of the data file.
+ *  \param suffix Suffix of the name, including the '.'.
+ */
+std::string getName(const std::string &prefix, const std::string &filename,
+                    const std::string &suffix)
+{
+    // Two FNV-1a hashes with different offset bases
+    const unsigned int low  = fnvHash(filename.c_str(), filename.size());
+    const unsigned int high = fnvHash(filename.c_str(), filename.size(),
+                                      0x84222325u);
+    char hash[17];
+    sprintf(hash, "%08x%08x", high, low);
+    return file_manager->getCachedDataDir() + prefix + hash + suffix;
+}   // getName
+
+// ----------------------------------------------------------------------------
+/** Reads the header and the name of the data file of a cache file, and
+ *  checks that it is a cache file of the expected type and version.
+ *  \param f The opened cache file.
+ *  \param magic, version Expected type and version.
+ *  \param header On return the header.
+ *  \param name On return the full path of the data file.
+ */
+static bool readHeader(FILE *f, const char *magic, unsigned int version,
+                       CacheFileHeader *header, std::string *name)
+{
+    if(fread(header, sizeof(*header), 1, f)!=1           ||
+       memcmp(header->m_magic, magic, 4)!=0              ||
+       header->m_version     != version                  ||
+       header->m_byte_order  != CACHE_FILE_BYTE_ORDER    ||
+       header->m_name_length == 0                        ||
+       header->m_name_length >  CACHE_FILE_MAX_NAME         )
+        return false;
+    name->resize(header->m_name_length);
+    return fread(&(*name)[0], header->m_name_length, 1, f)==1;
+}   // readHeader
+
+// ----------------------------------------------------------------------------
+/** Reads the data of a cache file. The cache file is only used if it was
+ *  created for the given data file, the data file was not modified since
+ *  then, and the checksum is correct.
+ *  \param cache_file Full path of the cache file, see getName().
+ *  \param magic Four characters which identify the type of cache.
+ *  \param version Version of the cache format.
+ *  \param filename Full path of the data file.
+ *  \param info On return the cache specific information.
+ *  \param info_size Size of the cache specific information.
+ *  \param max_data_size Files with more data are not used.
+ *  \param data_size On return the size of the data.
+ *  \return The data (allocated with new[]), or NULL if the cache file
+ *          does not exist or can not be used.
+ */
+char *read(const std::string &cache_file, const char *magic,
+           unsigned int version, const std::string &filename,
+           void *info, unsigned int info_size, unsigned int max_data_size,
+           unsigned int *data_size)
+{
+    long mtime, file_size;
+    if(!MetadataIndex::getFileInfo(filename, &mtime, &file_size))
+        return NULL;
+
+    FILE *f = fopen(cache_file.c_str(), "rb");
+    if(!f) return NULL;
+
+    CacheFileHeader header;
+    std::string name;
+    // The file name hash can collide, so compare the full path
+    bool ok = readHeader(f, magic, version, &header, &name)    &&
+              name                 == filename                 &&
+              header.m_mtime       == (unsigned int)mtime      &&
+              header.m_file_size   == (unsigned int)file_size  &&
+              header.m_info_size   == info_size                &&
+              header.m_data_size   >  0                        &&
+              header.m_data_size   <= max_data_size            &&
+              fread(info, info_size, 1, f)==1;
+    char *data = NULL;
+    if(ok)
+    {
+        data = new char[header.m_data_size];
+        ok   = fread(data, header.m_data_size, 1, f)==1 &&
+               fnvHash(data, header.m_data_size,
+                       fnvHash(info, info_size)) == header.m_checksum;
+    }
+    fclose(f);
+    if(!ok)
+    {
+        delete [] data;
+        return NULL;
+    }
+    *data_size = header.m_data_size;
+    return data;
+}   // read
+
+// ----------------------------------------------------------------------------
+/** Writes a cache file. The data is written to a temporary file first,
+ *  which then replaces the cache file.
+ *  \param cache_file Full path of the cache file, see getName().
+ *  \param magic Four characters which identify the type of cache.
+ *  \param version Version of the cache format.
+ *  \param filename Full path of the data file.
+ *  \param info, info_size The cache specific information.
+ *  \param data, data_size The data.
+ *  \return True if the cache file was written.
+ */
+bool write(const std::string &cache_file, const char *magic,
+           unsigned int version, const std::string &filename,
+           const void *info, unsigned int info_size,
+           const void *data, unsigned int data_size)
+{
+    long mtime, file_size;
+    if(!MetadataIndex::getFileInfo(filename, &mtime, &file_size) ||
+       filename.size() > CACHE_FILE_MAX_NAME                        )
+        return false;
+
+    CacheFileHeader header;
+    memcpy(header.m_magic, magic, 4);
+    header.m_version     = version;
+    header.m_byte_order  = CACHE_FILE_BYTE_ORDER;
+    header.m_mtime       = (unsigned int)mtime;
+    header.m_file_size   = (unsigned int)file_size;
+    header.m_name_length = filename.size();
+    header.m_info_size   = info_size;
+    header.m_data_size   = data_size;
+    header.m_checksum    = fnvHash(data, data_size,
+                                   fnvHash(info, info_size));
+
+    // Each thread and process writes its own temporary file
+    g_temp_file_counter.lock();
+    const unsigned int counter = g_temp_file_counter.getData()++;
+    g_temp_file_counter.unlock();
+    const std::string temp_file = cache_file + "."
+                                + StringUtils::toString((int)getpid()) + "-"
+                                + StringUtils::toString(counter) + ".tmp";
+
+    FILE *f = fopen(temp_file.c_str(), "wb");
+    bool ok = f!=NULL;
+    if(f)
+    {
+        ok = fwrite(&header, sizeof(header), 1, f)==1               &&
+             fwrite(filename.c_str(), filename.size(), 1, f)==1     &&
+             fwrite(info, info_size, 1, f)==1                       &&
+             fwrite(data, data_size, 1, f)==1;
+        ok = fclose(f)==0 && ok;
+    }
+    if(ok)
+    {
+#ifdef WIN32
+        // rename fails on windows if the target file already exists
+        remove(cache_file.c_str());
+#endif
+        ok = rename(temp_file.c_str(), cache_file.c_str())==0;
+    }
+    if(!ok)
+    {
+        Log::warn("CacheFile", "Can't write cache file '%s'.",
+                  cache_file.c_str());
+        remove(temp_file.c_str());
+    }
+    return ok;
+}   // write
+
+// ----------------------------------------------------------------------------
+/** Removes all cache files of one type which can not be used anymore: files
+ *  of data files which were removed, moved or modified (a moved file gets a
+ *  different cache file, and a modified one is only written again if it is
+ *  loaded), files of an older cache version, and temporary files left
+ *  behind by a crash.
+ *  \param prefix, suffix Prefix and suffix of the names of the cache files.
+ *  \param magic, version Type and version of the cache files.
+ */
+void removeStaleFiles(const std::string &prefix, const std::string &suffix,
+                      const char *magic, unsigned int version)
+{
+    const std::string dir = file_manager->getCachedDataDir();
+    std::set<std::string> files;
+    file_manager->listFiles(files, dir, /*is_full_path*/true);
+    for(std::set<std::string>::const_iterator i=files.begin();
+        i!=files.end(); i++)
+    {
+        if(i->compare(0, prefix.size(), prefix)!=0)
+            continue;
+        const std::string cache_file = dir+*i;
+        if(StringUtils::hasSuffix(*i, ".tmp"))
+        {
+            Log::verbose("CacheFile", "Removing temporary file '%s'.",
+                         cache_file.c_str());
+            remove(cache_file.c_str());
+            continue;
+        }
+        if(!StringUtils::hasSuffix(*i, suffix))
+            continue;
+
+        FILE *f = fopen(cache_file.c_str(), "rb");
+        if(!f) continue;
+        CacheFileHeader header;
+        std::string name;
+        bool ok = readHeader(f, magic, version, &header, &name);
+        fclose(f);
+
+        long mtime, file_size;
+        if(ok && getName(prefix, name, suffix)==cache_file        &&
+           MetadataIndex::getFileInfo(name, &mtime, &file_size)   &&
+           header.m_mtime     == (unsigned int)mtime              &&
+           header.m_file_size == (unsigned int)file_size             )
+            continue;
+
+        Log::verbose("CacheFile", "Removing stale cache file '%s'.",
+                     cache_file.c_str());
+        remove(cache_file.c_str());
+    }   // for i in files
+}   // removeStaleFiles
+
+}   // namespace CacheFile
@@ -0,0 +1,58 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2013 Joerg Henrichs
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#ifndef HEADER_CACHE_FILE_HPP
+#define HEADER_CACHE_FILE_HPP
+
+#include <string>
+
+/**
+  * \brief Reads and writes files in the cache directory which store data
+  * derived from a data file (e.g. a decoded image or sound).
+  * Each cache file starts with a header, followed by the full path of the
+  * data file, a small block of cache specific information (e.g. the size
+  * of an image) and the data. A cache file is only used if it has the
+  * expected type and version, was written on a system with the same byte
+  * order, was created for the same data file, the data file was not
+  * modified since then, and the checksum of the data is correct.
+  * Files are written to a temporary file first which is then renamed, so
+  * several threads or processes can write the same cache file at the same
+  * time without ever leaving a partially written file.
+  * \ingroup io
+  */
+namespace CacheFile
+{
+    unsigned int fnvHash(const void *data, unsigned int size,
+                         unsigned int hash=2166136261u);
+    std::string  getName(const std::string &prefix,
+                         const std::string &filename,
+                         const std::string &suffix);
+    char        *read(const std::string &cache_file, const char *magic,
+                      unsigned int version, const std::string &filename,
+                      void *info, unsigned int info_size,
+                      unsigned int max_data_size, unsigned int *data_size);
+    bool         write(const std::string &cache_file, const char *magic,
+                       unsigned int version, const std::string &filename,
+                       const void *info, unsigned int info_size,
+                       const void *data, unsigned int data_size);
+    void         removeStaleFiles(const std::string &prefix,
+                                  const std::string &suffix,
+                                  const char *magic, unsigned int version);
+}   // CacheFile
+
+#endif
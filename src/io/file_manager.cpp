@@ -119,6 +119,7 @@ FileManager::FileManager(char *argv[])
     chdir( buffer );
 #endif
 
+    pthread_mutex_init(&m_list_files_mutex, NULL);
     m_file_system  = irr_driver->getDevice()->getFileSystem();
     m_file_system->grab();
 
@@ -161,6 +162,7 @@ FileManager::FileManager(char *argv[])
     checkAndCreateConfigDir();
     checkAndCreateAddonsDir();
     checkAndCreateScreenshotDir();
+    checkAndCreateCachedDataDir();
 
 #ifdef WIN32
     redirectOutput();
@@ -267,6 +269,7 @@ FileManager::~FileManager()
     popTextureSearchPath();
     m_file_system->drop();
     m_file_system = NULL;
+    pthread_mutex_destroy(&m_list_files_mutex);
 }   // ~FileManager
 
 //-----------------------------------------------------------------------------
@@ -470,6 +473,14 @@ std::string FileManager::getScreenshotDir() const
     return m_screenshot_dir;
 }   // getScreenshotDir
 
+//-----------------------------------------------------------------------------
+/** Returns the directory in which cached data should be stored.
+ */
+std::string FileManager::getCachedDataDir() const
+{
+    return m_cached_data_dir;
+}   // getCachedDataDir
+
 //-----------------------------------------------------------------------------
 /** Returns the translation directory.
  */
@@ -726,6 +737,32 @@ void FileManager::checkAndCreateScreenshotDir()
 
 }   // checkAndCreateScreenshotDir
 
+// ----------------------------------------------------------------------------
+/** Creates the directory for cached data. This will set m_cached_data_dir
+ *  with the appropriate path.
+ */
+void FileManager::checkAndCreateCachedDataDir()
+{
+#if defined(WIN32) || defined(__CYGWIN__)
+    m_cached_data_dir  = m_config_dir+"cache/";
+#elif defined(__APPLE__)
+    m_cached_data_dir  = getenv("HOME");
+    m_cached_data_dir += "/Library/Caches/SuperTuxKart/";
+#else
+    m_cached_data_dir = checkAndCreateLinuxDir("XDG_CACHE_HOME",
+                                               "supertuxkart", ".cache/",
+                                               ".");
+    m_cached_data_dir += "cache/";
+#endif
+
+    if(!checkAndCreateDirectory(m_cached_data_dir))
+    {
+        Log::error("FileManager", "Can not create cache directory '%s', "
+                   "falling back to '.'.", m_cached_data_dir.c_str());
+        m_cached_data_dir = "./";
+    }
+}   // checkAndCreateCachedDataDir
+
 // ----------------------------------------------------------------------------
 #if !defined(WIN32) && !defined(__CYGWIN__) && !defined(__APPLE__)
 
@@ -947,6 +984,10 @@ bool FileManager::isDirectory(const std::string &path) const
  *  \param is_full_path True if directory is already a full path,
  *         otherwise m_root_dir is used.
  *  \param make_full_path If set to true, all listed files will be full paths.
+ *  Since this temporarily changes irrlicht's working directory, several
+ *  threads (e.g. jobs of the worker pool) must not call it at the same time.
+ *  This is prevented by a mutex, but other threads must still not use
+ *  relative file names meanwhile.
  */
 void FileManager::listFiles(std::set<std::string>& result,
                             const std::string& dir, bool is_full_path,
@@ -961,10 +1002,12 @@ void FileManager::listFiles(std::set<std::string>& result,
         return;
 #endif
 
+    pthread_mutex_lock(&m_list_files_mutex);
     io::path previous_cwd = m_file_system->getWorkingDirectory();
 
     if(!m_file_system->changeWorkingDirectoryTo( path.c_str() ))
     {
+        pthread_mutex_unlock(&m_list_files_mutex);
         Log::error("FileManager", "listFiles : Could not change CWD!\n");
         return;
     }
@@ -977,6 +1020,7 @@ void FileManager::listFiles(std::set<std::string>& result,
     }
 
     m_file_system->changeWorkingDirectoryTo( previous_cwd );
+    pthread_mutex_unlock(&m_list_files_mutex);
     files->drop();
 }   // listFiles
 
@@ -24,6 +24,7 @@
  * Contains generic utility classes for file I/O (especially XML handling).
  */
 
+#include <pthread.h>
 #include <string>
 #include <vector>
 #include <set>
@@ -58,6 +59,14 @@ private:
     /** Directory to store screenshots in. */
     std::string       m_screenshot_dir;
 
+    /** Directory to store cached data (which can be recreated at any
+     *  time) in, e.g. the collision data of tracks. */
+    std::string       m_cached_data_dir;
+
+    /** Protects irrlicht's working directory, which is temporarily changed
+     *  by listFiles. */
+    mutable pthread_mutex_t m_list_files_mutex;
+
     std::vector<std::string>
                       m_texture_search_path,
                       m_model_search_path,
@@ -74,6 +83,7 @@ private:
     bool              isDirectory(const std::string &path) const;
     void              checkAndCreateAddonsDir();
     void              checkAndCreateScreenshotDir();
+    void              checkAndCreateCachedDataDir();
 #if !defined(WIN32) && !defined(__CYGWIN__) && !defined(__APPLE__)
     std::string       checkAndCreateLinuxDir(const char *env_name,
                                              const char *dir_name,
@@ -93,6 +103,7 @@ public:
     std::string       getTextureDir() const;
     std::string       getShaderDir() const;
     std::string       getScreenshotDir() const;
+    std::string       getCachedDataDir() const;
     bool              checkAndCreateDirectoryP(const std::string &path);
     const std::string &getAddonsDir() const;
     std::string        getAddonsFile(const std::string &name);
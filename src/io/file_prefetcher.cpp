@@ -0,0 +1,126 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2013 Joerg Henrichs
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#include "io/file_prefetcher.hpp"
+
+#include "utils/log.hpp"
+
+#include <stdio.h>
+
+/** Size of the blocks in which the files are read. */
+static const unsigned int BLOCK_SIZE = 64*1024;
+
+// ----------------------------------------------------------------------------
+/** Starts the background thread. */
+FilePrefetcher::FilePrefetcher()
+{
+    m_next   = 0;
+    m_abort  = false;
+    pthread_mutex_init(&m_mutex, NULL);
+    pthread_cond_init (&m_cond,  NULL);
+
+    int error = pthread_create(&m_thread, NULL, &FilePrefetcher::mainLoop,
+                               this);
+    m_thread_started = error==0;
+    if(!m_thread_started)
+        Log::warn("FilePrefetcher", "Could not create thread, error=%d.",
+                  error);
+}   // FilePrefetcher
+
+// ----------------------------------------------------------------------------
+/** Stops the background thread, files that were not read yet are skipped. */
+FilePrefetcher::~FilePrefetcher()
+{
+    pthread_mutex_lock(&m_mutex);
+    m_abort = true;
+    pthread_cond_signal(&m_cond);
+    pthread_mutex_unlock(&m_mutex);
+
+    if(m_thread_started)
+        pthread_join(m_thread, NULL);
+
+    pthread_cond_destroy (&m_cond);
+    pthread_mutex_destroy(&m_mutex);
+}   // ~FilePrefetcher
+
+// ----------------------------------------------------------------------------
+/** Adds a file to the end of the queue of files to read. Files that were
+ *  added before are ignored.
+ *  \param filename Full path of the file.
+ */
+void FilePrefetcher::add(const std::string &filename)
+{
+    if(!m_thread_started) return;
+
+    pthread_mutex_lock(&m_mutex);
+    if(m_all_files.insert(filename).second)
+    {
+        m_queue.push_back(filename);
+        pthread_cond_signal(&m_cond);
+    }
+    pthread_mutex_unlock(&m_mutex);
+}   // add
+
+// ----------------------------------------------------------------------------
+/** The main loop of the background thread: reads the queued files one
+ *  after another, and waits for more files if the queue is empty.
+ *  \param obj Pointer to the prefetcher.
+ */
+void *FilePrefetcher::mainLoop(void *obj)
+{
+    FilePrefetcher *me = (FilePrefetcher*)obj;
+    pthread_mutex_lock(&me->m_mutex);
+    while(!me->m_abort)
+    {
+        if(me->m_next>=me->m_queue.size())
+        {
+            pthread_cond_wait(&me->m_cond, &me->m_mutex);
+            continue;
+        }
+        // Copy the name, since the queue might be resized by add()
+        const std::string filename = me->m_queue[me->m_next++];
+        pthread_mutex_unlock(&me->m_mutex);
+        me->readFile(filename);
+        pthread_mutex_lock(&me->m_mutex);
+    }
+    pthread_mutex_unlock(&me->m_mutex);
+    return NULL;
+}   // mainLoop
+
+// ----------------------------------------------------------------------------
+/** Reads a file completely (and discards the data). This is called without
+ *  the mutex being locked. The abort flag is checked between blocks, so
+ *  that large files don't delay stopping the thread.
+ *  \param filename Full path of the file.
+ */
+void FilePrefetcher::readFile(const std::string &filename)
+{
+    FILE *file = fopen(filename.c_str(), "rb");
+    if(!file) return;
+
+    char *buffer = new char[BLOCK_SIZE];
+    bool abort   = false;
+    while(!abort && fread(buffer, 1, BLOCK_SIZE, file)==BLOCK_SIZE)
+    {
+        pthread_mutex_lock(&m_mutex);
+        abort = m_abort;
+        pthread_mutex_unlock(&m_mutex);
+    }
+    delete [] buffer;
+    fclose(file);
+}   // readFile
@@ -0,0 +1,77 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2013 Joerg Henrichs
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#ifndef HEADER_FILE_PREFETCHER_HPP
+#define HEADER_FILE_PREFETCHER_HPP
+
+#include "utils/no_copy.hpp"
+
+#include <pthread.h>
+#include <set>
+#include <string>
+#include <vector>
+
+/**
+ *  \brief Reads files in a background thread, so that they are in the file
+ *  system cache by the time they are actually loaded.
+ *  Irrlicht's mesh and texture loading can only be done in the main thread,
+ *  but the main thread spends much of the track loading time waiting for
+ *  the disk. The prefetcher reads the files (in the order they were added)
+ *  while the main thread processes the previous files. The data read is
+ *  discarded, only the operating system keeps it cached.
+ *  Destroying the prefetcher stops the thread, files not read at that
+ *  time are skipped.
+ * \ingroup io
+ */
+class FilePrefetcher : public NoCopy
+{
+private:
+    /** The thread reading the files. */
+    pthread_t                m_thread;
+
+    /** True if the thread was started. */
+    bool                     m_thread_started;
+
+    /** Protects all following data. */
+    pthread_mutex_t          m_mutex;
+
+    /** Signalled when a file was added (or the thread should stop). */
+    pthread_cond_t           m_cond;
+
+    /** The queue of files to read. */
+    std::vector<std::string> m_queue;
+
+    /** Index of the next file in m_queue to read. */
+    unsigned int             m_next;
+
+    /** All files ever added, to avoid reading a file twice. */
+    std::set<std::string>    m_all_files;
+
+    /** Set to true to stop the thread. */
+    bool                     m_abort;
+
+    static void *mainLoop(void *obj);
+    void         readFile(const std::string &filename);
+
+public:
+         FilePrefetcher();
+        ~FilePrefetcher();
+    void add(const std::string &filename);
+};   // FilePrefetcher
+
+#endif
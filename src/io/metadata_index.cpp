@@ -0,0 +1,289 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2013 Joerg Henrichs
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#include "io/metadata_index.hpp"
+
+#include "io/file_manager.hpp"
+#include "io/xml_node.hpp"
+#include "utils/log.hpp"
+#include "utils/string_utils.hpp"
+
+#include <assert.h>
+#include <fstream>
+#include <set>
+#include <sstream>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+MetadataIndex *MetadataIndex::m_metadata_index = NULL;
+
+// ----------------------------------------------------------------------------
+/** Creates the metadata index singleton and loads the index file.
+ *  \param filename Full path of the index file.
+ */
+void MetadataIndex::create(const std::string &filename)
+{
+    assert(!m_metadata_index);
+    m_metadata_index = new MetadataIndex(filename);
+}   // create
+
+// ----------------------------------------------------------------------------
+/** Saves the index (if it was modified) and destroys the singleton. */
+void MetadataIndex::destroy()
+{
+    if(m_metadata_index)
+    {
+        m_metadata_index->save();
+        delete m_metadata_index;
+    }
+    m_metadata_index = NULL;
+}   // destroy
+
+// ----------------------------------------------------------------------------
+/** Loads the index file. A missing or invalid file results in an empty
+ *  index, i.e. all karts and tracks are loaded.
+ *  \param filename Full path of the index file.
+ */
+MetadataIndex::MetadataIndex(const std::string &filename)
+{
+    m_filename = filename;
+    m_modified = false;
+
+    if(!file_manager->fileExists(m_filename))
+        return;
+    const XMLNode *root = file_manager->createXMLTree(m_filename);
+    if(!root || root->getName()!="metadata-index")
+    {
+        Log::warn("MetadataIndex", "Ignoring invalid index file '%s'.",
+                  m_filename.c_str());
+        if(root) delete root;
+        return;
+    }
+
+    for(unsigned int i=0; i<root->getNumNodes(); i++)
+    {
+        const XMLNode *node = root->getNode(i);
+        std::string path;
+        int64_t mtime, size;
+        Entry entry;
+        if(node->getName()!="dir"          ||
+           !node->get("path",    &path   ) ||
+           !node->get("mtime",   &mtime  ) ||
+           !node->get("size",    &size   ) ||
+           !node->get("version", &entry.m_version))
+            continue;
+        entry.m_mtime = (long)mtime;
+        entry.m_size  = (long)size;
+        entry.m_used  = false;
+        for(unsigned int j=0; j<node->getNumNodes(); j++)
+        {
+            const XMLNode *field = node->getNode(j);
+            std::string name, value;
+            if(field->getName()!="field"  ||
+               !field->get("name",  &name ) ||
+               !field->get("value", &value)   )
+                continue;
+            entry.m_fields[name] = unescape(value);
+        }
+        m_entries[unescape(path)] = entry;
+    }
+    delete root;
+}   // MetadataIndex
+
+// ----------------------------------------------------------------------------
+MetadataIndex::~MetadataIndex()
+{
+}   // ~MetadataIndex
+
+// ----------------------------------------------------------------------------
+/** Converts a string so that it can be written as an xml attribute value.
+ *  All special and non-ASCII characters are written as &#x..; codes, which
+ *  (unlike e.g. &amp;) are not replaced by the xml reader, so that reading
+ *  a value always gives back the original string (see unescape).
+ *  \param s The string to convert.
+ */
+std::string MetadataIndex::escape(const std::string &s)
+{
+    std::ostringstream out;
+    for(unsigned int i=0; i<s.size(); i++)
+    {
+        const unsigned char c = s[i];
+        if(c<0x80 && c!='&' && c!='<' && c!='>' && c!='"')
+            out << s[i];
+        else
+            out << "&#x" << std::hex << std::uppercase << (int)c << ";";
+    }
+    return out.str();
+}   // escape
+
+// ----------------------------------------------------------------------------
+/** Converts a value read from the index file back (see escape).
+ *  \param s The string read from the index file.
+ */
+std::string MetadataIndex::unescape(const std::string &s)
+{
+    return core::stringc(StringUtils::decodeFromHtmlEntities(s)).c_str();
+}   // unescape
+
+// ----------------------------------------------------------------------------
+/** Determines the modification time and size of a file.
+ *  \param filename Full path of the file.
+ *  \param mtime, size On return the modification time and size.
+ *  \return False if the file does not exist.
+ */
+bool MetadataIndex::getFileInfo(const std::string &filename, long *mtime,
+                                long *size)
+{
+    struct stat file_stat;
+    if(stat(filename.c_str(), &file_stat)!=0)
+        return false;
+    *mtime = (long)file_stat.st_mtime;
+    *size  = (long)file_stat.st_size;
+    return true;
+}   // getFileInfo
+
+// ----------------------------------------------------------------------------
+/** Determines the latest modification time and the total size of a
+ *  directory and all files in it. Adding, removing or changing any file
+ *  in the directory changes at least one of the two values.
+ *  \param dir Full path of the directory.
+ *  \param mtime, size On return the modification time and size.
+ *  \return False if the directory does not exist.
+ */
+bool MetadataIndex::getDirInfo(const std::string &dir, long *mtime,
+                               long *size)
+{
+    if(!getFileInfo(dir, mtime, size))
+        return false;
+
+    std::set<std::string> files;
+    file_manager->listFiles(files, dir, /*is_full_path*/true);
+    for(std::set<std::string>::const_iterator i=files.begin();
+        i!=files.end(); i++)
+    {
+        if(*i=="." || *i=="..") continue;
+        long file_mtime, file_size;
+        if(!getFileInfo(dir+"/"+*i, &file_mtime, &file_size))
+            continue;
+        if(file_mtime>*mtime) *mtime = file_mtime;
+        *size += file_size;
+    }
+    return true;
+}   // getDirInfo
+
+// ----------------------------------------------------------------------------
+/** Returns the version and the cached fields of the kart or track in a
+ *  directory, if no file in the directory was modified since they were
+ *  stored.
+ *  \param dir Full path of the kart or track directory.
+ *  \param version On return the stored version (or LOAD_FAILED).
+ *  \param fields On return the stored fields.
+ *  \return True if the stored data is valid.
+ */
+bool MetadataIndex::get(const std::string &dir, int *version, Fields *fields)
+{
+    std::map<std::string, Entry>::iterator i = m_entries.find(dir);
+    if(i==m_entries.end())
+        return false;
+
+    long mtime, size;
+    if(!getDirInfo(dir, &mtime, &size) ||
+       mtime!=i->second.m_mtime || size!=i->second.m_size)
+        return false;
+
+    i->second.m_used = true;
+    *version = i->second.m_version;
+    *fields  = i->second.m_fields;
+    return true;
+}   // get
+
+// ----------------------------------------------------------------------------
+/** Stores the version and the fields of the kart or track in a directory
+ *  (together with the current modification time and size of the
+ *  directory).
+ *  \param dir Full path of the kart or track directory.
+ *  \param version The version, or LOAD_FAILED.
+ *  \param fields The fields to cache (empty if the kart or track can't
+ *         be used).
+ */
+void MetadataIndex::set(const std::string &dir, int version,
+                        const Fields &fields)
+{
+    Entry entry;
+    if(!getDirInfo(dir, &entry.m_mtime, &entry.m_size))
+        return;
+    entry.m_version = version;
+    entry.m_fields  = fields;
+    entry.m_used    = true;
+
+    std::map<std::string, Entry>::iterator i = m_entries.find(dir);
+    if(i!=m_entries.end()                     &&
+       i->second.m_mtime   == entry.m_mtime   &&
+       i->second.m_size    == entry.m_size    &&
+       i->second.m_version == entry.m_version &&
+       i->second.m_fields  == entry.m_fields     )
+    {
+        i->second.m_used = true;
+        return;
+    }
+    m_entries[dir] = entry;
+    m_modified = true;
+}   // set
+
+// ----------------------------------------------------------------------------
+/** Saves all entries used in this run, if any entry was modified or
+ *  an entry was not used.
+ */
+void MetadataIndex::save()
+{
+    bool all_used = true;
+    std::map<std::string, Entry>::const_iterator i;
+    for(i=m_entries.begin(); i!=m_entries.end(); i++)
+        all_used &= i->second.m_used;
+    if(!m_modified && all_used) return;
+
+    std::ofstream out(m_filename.c_str(), std::ios::out);
+    if(!out.is_open())
+    {
+        Log::warn("MetadataIndex", "Can't write index file '%s'.",
+                  m_filename.c_str());
+        return;
+    }
+
+    out << "<?xml version=\"1.0\"?>\n";
+    out << "<metadata-index>\n";
+    for(i=m_entries.begin(); i!=m_entries.end(); i++)
+    {
+        if(!i->second.m_used) continue;
+        out << "  <dir path=\""    << escape(i->first)
+            << "\" mtime=\""   << i->second.m_mtime
+            << "\" size=\""    << i->second.m_size
+            << "\" version=\"" << i->second.m_version
+            << "\">\n";
+        Fields::const_iterator f;
+        for(f=i->second.m_fields.begin(); f!=i->second.m_fields.end(); f++)
+        {
+            out << "    <field name=\"" << escape(f->first)
+                << "\" value=\""        << escape(f->second) << "\"/>\n";
+        }
+        out << "  </dir>\n";
+    }
+    out << "</metadata-index>\n";
+    out.close();
+    m_modified = false;
+}   // save
@@ -0,0 +1,100 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2013 Joerg Henrichs
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#ifndef HEADER_METADATA_INDEX_HPP
+#define HEADER_METADATA_INDEX_HPP
+
+#include "utils/no_copy.hpp"
+
+#include <map>
+#include <string>
+
+/**
+ *  \brief A persistent index of the kart and track directories found
+ *  when scanning for karts and tracks.
+ *  For each directory the index stores the latest modification time and
+ *  the total size of the files in it, together with the version of the
+ *  kart or track (or that it could not be loaded at all) and the fields
+ *  needed to show it in the menus (name, groups, icon, ...). As long as
+ *  no file in the directory was changed, the managers use this to skip
+ *  unusable karts and tracks, and to create usable ones without parsing
+ *  their xml files. Since the whole directory is checked, a kart or
+ *  track that failed to load is tried again once e.g. a model is fixed.
+ *  Only entries which were used in this run are saved, so removed
+ *  karts and tracks disappear from the index.
+ * \ingroup io
+ */
+class MetadataIndex : public NoCopy
+{
+public:
+    /** Version stored for directories that could not be loaded. */
+    static const int LOAD_FAILED = -1;
+
+    /** The cached fields of a kart or track, indexed by name. */
+    typedef std::map<std::string, std::string> Fields;
+
+private:
+    /** Information about one kart or track directory. */
+    struct Entry
+    {
+        /** Latest modification time of the directory and its files. */
+        long   m_mtime;
+        /** Total size of the files in the directory. */
+        long   m_size;
+        /** Version of the kart or track, or LOAD_FAILED. */
+        int    m_version;
+        /** The cached fields of the kart or track. */
+        Fields m_fields;
+        /** True if the entry was used in this run. */
+        bool   m_used;
+    };   // Entry
+
+    /** The singleton. */
+    static MetadataIndex *m_metadata_index;
+
+    /** Full path of the index file. */
+    std::string                  m_filename;
+
+    /** All entries, indexed by the full path of the directory. */
+    std::map<std::string, Entry> m_entries;
+
+    /** True if an entry was added or changed since loading. */
+    bool                         m_modified;
+
+         MetadataIndex(const std::string &filename);
+        ~MetadataIndex();
+    static std::string escape(const std::string &s);
+    static std::string unescape(const std::string &s);
+
+public:
+    static void create(const std::string &filename);
+    static void destroy();
+    static bool getFileInfo(const std::string &filename, long *mtime,
+                            long *size);
+    static bool getDirInfo(const std::string &dir, long *mtime, long *size);
+    // ------------------------------------------------------------------------
+    /** Returns the metadata index, or NULL if it was not created. */
+    static MetadataIndex *get() { return m_metadata_index; }
+    // ------------------------------------------------------------------------
+    bool get(const std::string &dir, int *version, Fields *fields);
+    void set(const std::string &dir, int version,
+             const Fields &fields=Fields());
+    void save();
+};   // MetadataIndex
+
+#endif
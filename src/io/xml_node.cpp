@@ -22,28 +22,326 @@
 #include "utils/interpolation_array.hpp"
 #include "utils/vec3.hpp"
 
+#include <ctype.h>
+#include <errno.h>
+#include <limits.h>
+#include <set>
 #include <stdexcept>
+#include <stdlib.h>
+#include <string.h>
 
+/** Data shared by all nodes of one tree. Each tree has its own data, so
+ *  different threads can read XML files at the same time without any
+ *  locking.
+ */
+struct XMLNode::SharedData
+{
+    /** The values of all attributes of all nodes in this tree. */
+    std::string           m_values;
+
+    /** All names of nodes and attributes in this tree. Each node only
+     *  stores pointers to the entries of its name and the names of its
+     *  attributes, so the strings are not duplicated in each node. Pointers
+     *  to the entries stay valid when more names are added. */
+    std::set<std::string> m_names;
+};   // SharedData
+
+/** The name of a node that was not read. */
+static const std::string g_empty_name;
+
+// ----------------------------------------------------------------------------
+/** Returns the interned string for a name.
+ *  \param name The name (which is converted like core::stringc does).
+ *  \param names The set of interned names.
+ *  \param tmp Temporary string used for the conversion, which avoids
+ *         allocating memory for each name.
+ */
+static const std::string *internName(const wchar_t *name,
+                                     std::set<std::string> *names,
+                                     std::string *tmp)
+{
+    tmp->clear();
+    for(; *name; name++)
+        tmp->push_back((char)*name);
+    return &*names->insert(*tmp).first;
+}   // internName
+
+// ----------------------------------------------------------------------------
+/** Appends the UTF-8 encoding of a wide string to a string.
+ *  \param s The wide string (UTF-16 or UTF-32 depending on the size of
+ *         wchar_t).
+ *  \param out The string to append to.
+ */
+static void appendUTF8(const wchar_t *s, std::string *out)
+{
+    for(; *s; s++)
+    {
+        uint32_t c = (uint32_t)*s;
+        // Combine surrogate pairs (if wchar_t is 16 bit)
+        if(c>=0xD800 && c<0xDC00 &&
+           (uint32_t)s[1]>=0xDC00 && (uint32_t)s[1]<0xE000)
+        {
+            c = 0x10000 + ((c-0xD800)<<10) + ((uint32_t)s[1]-0xDC00);
+            s++;
+        }
+
+        if(c<0x80)
+            out->push_back((char)c);
+        else if(c<0x800)
+        {
+            out->push_back((char)(0xC0 |  (c>>6)      ));
+            out->push_back((char)(0x80 | ( c     &0x3F)));
+        }
+        else if(c<0x10000)
+        {
+            out->push_back((char)(0xE0 |  (c>>12)     ));
+            out->push_back((char)(0x80 | ((c>>6 )&0x3F)));
+            out->push_back((char)(0x80 | ( c     &0x3F)));
+        }
+        else
+        {
+            out->push_back((char)(0xF0 |  (c>>18)     ));
+            out->push_back((char)(0x80 | ((c>>12)&0x3F)));
+            out->push_back((char)(0x80 | ((c>>6 )&0x3F)));
+            out->push_back((char)(0x80 | ( c     &0x3F)));
+        }
+    }   // for s
+}   // appendUTF8
+
+// ----------------------------------------------------------------------------
+/** Decodes an UTF-8 string (as created by appendUTF8) into a wide string.
+ *  \param s The UTF-8 encoded string.
+ *  \param out The decoded string.
+ */
+static void decodeUTF8(const char *s, core::stringw *out)
+{
+    *out = L"";
+    const unsigned char *p = (const unsigned char*)s;
+    while(*p)
+    {
+        uint32_t c = *p++;
+        int extra = 0;
+        if     (c>=0xF0) { c &= 0x07; extra = 3; }
+        else if(c>=0xE0) { c &= 0x0F; extra = 2; }
+        else if(c>=0xC0) { c &= 0x1F; extra = 1; }
+        for(; extra>0 && (*p & 0xC0)==0x80; extra--)
+            c = (c<<6) | (*p++ & 0x3F);
+
+        if(sizeof(wchar_t)==2 && c>=0x10000)
+        {
+            c -= 0x10000;
+            out->append((wchar_t)(0xD800 + (c>>10)  ));
+            out->append((wchar_t)(0xDC00 + (c&0x3FF)));
+        }
+        else
+            out->append((wchar_t)c);
+    }
+}   // decodeUTF8
+
+// ----------------------------------------------------------------------------
+/** Returns true if a character can start a number. This rejects values
+ *  that strtod/strtol accept, but StringUtils::parseString does not (e.g.
+ *  leading spaces, 'inf' or 'nan').
+ */
+static bool isNumberStart(char c)
+{
+    return (c>='0' && c<='9') || c=='-' || c=='+' || c=='.';
+}   // isNumberStart
+
+// ----------------------------------------------------------------------------
+/** Parses a float at the beginning of a string, without creating any
+ *  temporary strings. The number must be followed by a space or the end of
+ *  the string. Like StringUtils::parseString only decimal numbers are
+ *  accepted (no hex numbers, inf or nan), and values that are out of
+ *  range are an error.
+ *  \param s The string to parse.
+ *  \param value On return the parsed value.
+ *  \return Pointer to the character after the number, or NULL if the string
+ *          does not start with a valid float.
+ */
+static const char *parseFloat(const char *s, float *value)
+{
+    const char *c = s;
+    while((*c>='0' && *c<='9') || *c=='-' || *c=='+' || *c=='.' ||
+          *c=='e' || *c=='E')
+        c++;
+    if(c==s || (*c!=' ' && *c!=0)) return NULL;
+
+    char *end;
+    errno = 0;
+    const float f = strtof(s, &end);
+    if(end!=c || errno==ERANGE) return NULL;
+    *value = f;
+    return end;
+}   // parseFloat
+
+// ----------------------------------------------------------------------------
+/** Parses an int at the beginning of a string, without creating any
+ *  temporary strings. The number must be followed by a space or the end of
+ *  the string.
+ *  \param s The string to parse.
+ *  \param value On return the parsed value.
+ *  \return Pointer to the character after the number, or NULL if the string
+ *          does not start with a valid int.
+ */
+static const char *parseInt(const char *s, int *value)
+{
+    if(!isNumberStart(*s)) return NULL;
+    char *end;
+    errno = 0;
+    const long l = strtol(s, &end, 10);
+    if(end==s || (*end!=' ' && *end!=0) || errno==ERANGE ||
+       l<INT_MIN || l>INT_MAX)
+        return NULL;
+    *value = (int)l;
+    return end;
+}   // parseInt
+
+// ----------------------------------------------------------------------------
+/** Parses an unsigned int at the beginning of a string, see parseInt.
+ *  Negative values are an error.
+ *  \param s The string to parse.
+ *  \param value On return the parsed value.
+ *  \return Pointer to the character after the number, or NULL if the string
+ *          does not start with a valid unsigned int.
+ */
+static const char *parseUnsigned(const char *s, unsigned int *value)
+{
+    if(!isNumberStart(*s) || *s=='-') return NULL;
+    char *end;
+    errno = 0;
+    const unsigned long l = strtoul(s, &end, 10);
+    if(end==s || (*end!=' ' && *end!=0) || errno==ERANGE || l>UINT_MAX)
+        return NULL;
+    *value = (unsigned int)l;
+    return end;
+}   // parseUnsigned
+
+// ----------------------------------------------------------------------------
+/** Parses a 64 bit int at the beginning of a string, see parseInt. The
+ *  digits are converted directly, since strtoll is not available on all
+ *  supported compilers.
+ *  \param s The string to parse.
+ *  \param value On return the parsed value.
+ *  \return Pointer to the character after the number, or NULL if the string
+ *          does not start with a valid 64 bit int.
+ */
+static const char *parseInt64(const char *s, int64_t *value)
+{
+    const char *c = s;
+    const bool negative = *c=='-';
+    if(*c=='-' || *c=='+') c++;
+    if(*c<'0' || *c>'9') return NULL;
+
+    // The magnitude of the smallest negative value is one larger than the
+    // largest positive value.
+    const uint64_t max_positive = ~(uint64_t)0 >> 1;
+    const uint64_t limit        = negative ? max_positive+1 : max_positive;
+    uint64_t magnitude = 0;
+    for(; *c>='0' && *c<='9'; c++)
+    {
+        const unsigned int digit = *c-'0';
+        if(magnitude > (limit-digit)/10) return NULL;
+        magnitude = magnitude*10 + digit;
+    }
+    if(*c!=' ' && *c!=0) return NULL;
+
+    *value = negative && magnitude>0 ? -(int64_t)(magnitude-1)-1
+                                     :  (int64_t)magnitude;
+    return c;
+}   // parseInt64
+
+// ----------------------------------------------------------------------------
+/** Parses a list of space separated floats. This gives the same result as
+ *  splitting the string at spaces and parsing each part with
+ *  StringUtils::parseString, but does not create any strings.
+ *  \param s The string to parse.
+ *  \param values On return contains the values (at most max_values).
+ *  \param max_values Maximum number of values to store.
+ *  \return The number of values in the string (which can be larger than
+ *          max_values), or -1 if a value is not a valid float.
+ */
+static int parseFloatList(const char *s, float *values, int max_values)
+{
+    int n = 0;
+    while(*s)
+    {
+        float f;
+        s = parseFloat(s, &f);
+        if(!s) return -1;
+        if(n<max_values) values[n] = f;
+        n++;
+        if(*s==' ') s++;
+    }
+    return n;
+}   // parseFloatList
+
+// ----------------------------------------------------------------------------
+/** Parses a list of space separated ints, see parseFloatList.
+ *  \param s The string to parse.
+ *  \param values On return contains the values (at most max_values).
+ *  \param max_values Maximum number of values to store.
+ *  \return The number of values in the string (which can be larger than
+ *          max_values), or -1 if a value is not a valid int.
+ */
+static int parseIntList(const char *s, int *values, int max_values)
+{
+    int n = 0;
+    while(*s)
+    {
+        int i;
+        s = parseInt(s, &i);
+        if(!s) return -1;
+        if(n<max_values) values[n] = i;
+        n++;
+        if(*s==' ') s++;
+    }
+    return n;
+}   // parseIntList
+
+// ----------------------------------------------------------------------------
 XMLNode::XMLNode(io::IXMLReader *xml)
 {
-    m_file_name = "[unknown]";
+    m_file_name   = "[unknown]";
+    m_name        = &g_empty_name;
+    m_shared      = new SharedData();
+    m_owns_shared = true;
 
     while(xml->getNodeType()!=io::EXN_ELEMENT && xml->read());
     readXML(xml);
 }   // XMLNode
 
+// ----------------------------------------------------------------------------
+/** Creates a sub node, which stores its attribute values and names in the
+ *  shared data of the root node.
+ *  \param xml The XML reader.
+ *  \param shared The shared data of the tree.
+ */
+XMLNode::XMLNode(io::IXMLReader *xml, SharedData *shared)
+{
+    m_file_name   = "[unknown]";
+    m_name        = &g_empty_name;
+    m_shared      = shared;
+    m_owns_shared = false;
+    readXML(xml);
+}   // XMLNode
+
 // ----------------------------------------------------------------------------
 /** Reads a XML file and convert it into a XMLNode tree.
  *  \param filename Name of the XML file to read.
  */
 XMLNode::XMLNode(const std::string &filename)
 {
-    m_file_name = filename;
+    m_file_name   = filename;
+    m_name        = &g_empty_name;
+    m_shared      = new SharedData();
+    m_owns_shared = true;
 
     io::IXMLReader *xml = file_manager->createXMLReader(filename);
 
     if (xml == NULL)
     {
+        delete m_shared;
         throw std::runtime_error("Cannot find file "+filename);
     }
 
@@ -83,6 +381,8 @@ XMLNode::~XMLNode()
         delete m_nodes[i];
     }
     m_nodes.clear();
+    if(m_owns_shared)
+        delete m_shared;
 }   // ~XMLNode
 
 // ----------------------------------------------------------------------------
@@ -91,13 +391,26 @@ XMLNode::~XMLNode()
  */
 void XMLNode::readXML(io::IXMLReader *xml)
 {
-    m_name = std::string(core::stringc(xml->getNodeName()).c_str());
+    std::string tmp;
+    m_name = internName(xml->getNodeName(), &m_shared->m_names, &tmp);
 
     for(unsigned int i=0; i<xml->getAttributeCount(); i++)
     {
-        std::string   name  = core::stringc(xml->getAttributeName(i)).c_str();
-        core::stringw value = xml->getAttributeValue(i);
-        m_attributes[name] = value;
+        Attribute attribute;
+        attribute.m_name  = internName(xml->getAttributeName(i),
+                                       &m_shared->m_names, &tmp);
+        attribute.m_value = m_shared->m_values.size();
+        appendUTF8(xml->getAttributeValue(i), &m_shared->m_values);
+        m_shared->m_values.push_back(0);
+
+        // If an attribute is defined more than once, the last value is used
+        unsigned int j = 0;
+        while(j<m_attributes.size() && m_attributes[j].m_name!=attribute.m_name)
+            j++;
+        if(j<m_attributes.size())
+            m_attributes[j] = attribute;
+        else
+            m_attributes.push_back(attribute);
     }   // for i
 
     // If no children, we are done
@@ -111,7 +424,7 @@ void XMLNode::readXML(io::IXMLReader *xml)
         {
         case io::EXN_ELEMENT:
             {
-                XMLNode* n = new XMLNode(xml);
+                XMLNode* n = new XMLNode(xml, m_shared);
                 n->m_file_name = m_file_name;
                 m_nodes.push_back(n);
                 break;
@@ -166,6 +479,21 @@ const void XMLNode::getNodes(const std::string &s, std::vector<XMLNode*>& out) c
     }
 }   // getNode
 
+// ----------------------------------------------------------------------------
+/** Returns the (UTF-8 encoded) value of an attribute, or NULL if the
+ *  attribute is not defined.
+ *  \param attribute Name of the attribute.
+ */
+const char *XMLNode::getValue(const std::string &attribute) const
+{
+    for(unsigned int i=0; i<m_attributes.size(); i++)
+    {
+        if(*m_attributes[i].m_name==attribute)
+            return m_shared->m_values.c_str() + m_attributes[i].m_value;
+    }
+    return NULL;
+}   // getValue
+
 // ----------------------------------------------------------------------------
 /** If 'attribute' was defined, set 'value' to the value of the
 *   attribute and return 1, otherwise return 0 and do not change value.
@@ -174,33 +502,40 @@ const void XMLNode::getNodes(const std::string &s, std::vector<XMLNode*>& out) c
 */
 int XMLNode::get(const std::string &attribute, std::string *value) const
 {
-    if(m_attributes.size()==0) return 0;
-    std::map<std::string, core::stringw>::const_iterator o;
-    o = m_attributes.find(attribute);
-    if(o==m_attributes.end()) return 0;
-    *value=core::stringc(o->second).c_str();
+    const char *v = getValue(attribute);
+    if(!v) return 0;
+
+    // Non-ASCII characters are converted the same way as core::stringc does
+    const char *c = v;
+    while(*c && (unsigned char)*c<0x80) c++;
+    if(*c)
+    {
+        core::stringw w;
+        decodeUTF8(v, &w);
+        *value = core::stringc(w).c_str();
+    }
+    else
+        *value = v;
     return 1;
 }   // get
 // ----------------------------------------------------------------------------
 int XMLNode::get(const std::string &attribute, core::stringw *value) const
 {
-    if(m_attributes.size()==0) return 0;
-    std::map<std::string, core::stringw>::const_iterator o;
-    o = m_attributes.find(attribute);
-    if(o==m_attributes.end()) return 0;
-    *value = o->second;
+    const char *v = getValue(attribute);
+    if(!v) return 0;
+    decodeUTF8(v, value);
     return 1;
 }   // get
 // ----------------------------------------------------------------------------
 int XMLNode::get(const std::string &attribute, core::vector2df *value) const
 {
-    std::string s = "";
-    if(!get(attribute, &s)) return 0;
+    const char *s = getValue(attribute);
+    if(!s) return 0;
 
-    std::vector<std::string> v = StringUtils::split(s,' ');
-    if(v.size()!=2) return 0;
-    value->X = (float)atof(v[0].c_str());
-    value->Y = (float)atof(v[1].c_str());
+    float xy[2];
+    if(parseFloatList(s, xy, 2)!=2) return 0;
+    value->X = xy[0];
+    value->Y = xy[1];
     return 1;
 }   // get(vector2df)
 
@@ -217,33 +552,20 @@ int XMLNode::get(const std::string &attribute, core::vector3df *value) const
 // ----------------------------------------------------------------------------
 int XMLNode::get(const std::string &attribute, Vec3 *value) const
 {
-    std::string s = "";
-    if(!get(attribute, &s)) return 0;
+    const char *s = getValue(attribute);
+    if(!s) return 0;
 
-    std::vector<std::string> v = StringUtils::split(s,' ');
-    if (v.size() != 3)
+    float xyz[3];
+    if (parseFloatList(s, xyz, 3) != 3)
     {
         fprintf(stderr, "[XMLNode] WARNING: Expected 3 floating-point values, but found '%s' in file %s\n",
-                s.c_str(), m_file_name.c_str());
+                s, m_file_name.c_str());
         return 0;
     }
 
-    float x, y, z;
-
-    if (StringUtils::parseString<float>(v[0], &x) &&
-        StringUtils::parseString<float>(v[1], &y) &&
-        StringUtils::parseString<float>(v[2], &z) )
-    {
-        value->setX(x);
-        value->setY(y);
-        value->setZ(z);
-    }
-    else
-    {
-        fprintf(stderr, "[XMLNode] WARNING: Expected 3 floating-point values, but found '%s' in file %s\n",
-                s.c_str(), m_file_name.c_str());
-        return 0;
-    }
+    value->setX(xyz[0]);
+    value->setY(xyz[1]);
+    value->setZ(xyz[2]);
 
     return 1;
 }   // get(Vec3)
@@ -251,23 +573,22 @@ int XMLNode::get(const std::string &attribute, Vec3 *value) const
 // ----------------------------------------------------------------------------
 int XMLNode::get(const std::string &attribute, video::SColor *color) const
 {
-    std::string s;
-    if(!get(attribute, &s)) return 0;
+    const char *s = getValue(attribute);
+    if(!s) return 0;
 
-    std::vector<std::string> v = StringUtils::split(s,' ');
-    if (v.size()<3 || v.size()>4) return 0;
-    if (v.size()==3)
+    int v[4];
+    const int count = parseIntList(s, v, 4);
+    if (count<3 || count>4) return 0;
+    if (count==3)
     {
-        color->setRed  (atoi(v[0].c_str()));
-        color->setGreen(atoi(v[1].c_str()));
-        color->setBlue (atoi(v[2].c_str()));
+        color->setRed  (v[0]);
+        color->setGreen(v[1]);
+        color->setBlue (v[2]);
     }
     else
     {
-        color->set(atoi(v[3].c_str()), // irrLicht expects ARGB, and we use RGBA in XML files
-                   atoi(v[0].c_str()),
-                   atoi(v[1].c_str()),
-                   atoi(v[2].c_str()));
+        color->set(v[3], // irrLicht expects ARGB, and we use RGBA in XML files
+                   v[0], v[1], v[2]);
     }
     return 1;
 }   // get(SColor)
@@ -275,46 +596,56 @@ int XMLNode::get(const std::string &attribute, video::SColor *color) const
 // ----------------------------------------------------------------------------
 int XMLNode::get(const std::string &attribute, video::SColorf *color) const
 {
-    std::string s;
-    if(!get(attribute, &s)) return 0;
+    const char *s = getValue(attribute);
+    if(!s) return 0;
 
-    std::vector<std::string> v = StringUtils::split(s,' ');
-    if(v.size()!=4) return 0;
-    color->set((float)atof(v[3].c_str()),  // set takes ARGB, but we use RGBA
-               (float)atof(v[0].c_str()),
-               (float)atof(v[1].c_str()),
-               (float)atof(v[2].c_str()));
+    float v[4];
+    if(parseFloatList(s, v, 4)!=4) return 0;
+    color->set(v[3],  // set takes ARGB, but we use RGBA
+               v[0], v[1], v[2]);
     return 1;
 }   // get(SColor)
 // ----------------------------------------------------------------------------
 int XMLNode::get(const std::string &attribute, int32_t *value) const
 {
-    std::string s;
-    if(!get(attribute, &s)) return 0;
-
-    if (!StringUtils::parseString<int>(s, value))
+    const char *s = getValue(attribute);
+    if(!s) return 0;
+
+    int i;
+    // Leading white space is accepted (like StringUtils::parseString does)
+    const char *start = s;
+    while(isspace((unsigned char)*start)) start++;
+    const char *end = parseInt(start, &i);
+    if (!end || *end)
     {
         fprintf(stderr, "[XMLNode] WARNING: Expected int but found '%s' for attribute '%s' of node '%s' in file %s\n",
-                s.c_str(), attribute.c_str(), m_name.c_str(), m_file_name.c_str());
+                s, attribute.c_str(), m_name->c_str(), m_file_name.c_str());
         return 0;
     }
 
+    *value = i;
     return 1;
 }   // get(int32_t)
 
 // ----------------------------------------------------------------------------
 int XMLNode::get(const std::string &attribute, int64_t *value) const
 {
-    std::string s;
-    if(!get(attribute, &s)) return 0;
-
-    if (!StringUtils::parseString<int64_t>(s, value))
+    const char *s = getValue(attribute);
+    if(!s) return 0;
+
+    int64_t i;
+    // Leading white space is accepted (like StringUtils::parseString does)
+    const char *start = s;
+    while(isspace((unsigned char)*start)) start++;
+    const char *end = parseInt64(start, &i);
+    if (!end || *end)
     {
         fprintf(stderr, "[XMLNode] WARNING: Expected int but found '%s' for attribute '%s' of node '%s' in file %s\n",
-                s.c_str(), attribute.c_str(), m_name.c_str(), m_file_name.c_str());
+                s, attribute.c_str(), m_name->c_str(), m_file_name.c_str());
         return 0;
     }
 
+    *value = i;
     return 1;
 }   // get(int64_t)
 
@@ -322,44 +653,56 @@ int XMLNode::get(const std::string &attribute, int64_t *value) const
 // ----------------------------------------------------------------------------
 int XMLNode::get(const std::string &attribute, uint32_t *value) const
 {
-    std::string s;
-    if(!get(attribute, &s)) return 0;
-
-    if (!StringUtils::parseString<unsigned int>(s, value))
+    const char *s = getValue(attribute);
+    if(!s) return 0;
+
+    unsigned int u;
+    // Leading white space is accepted (like StringUtils::parseString does)
+    const char *start = s;
+    while(isspace((unsigned char)*start)) start++;
+    const char *end = parseUnsigned(start, &u);
+    if (!end || *end)
     {
         fprintf(stderr, "[XMLNode] WARNING: Expected uint but found '%s' for attribute '%s' of node '%s' in file %s\n",
-                s.c_str(), attribute.c_str(), m_name.c_str(), m_file_name.c_str());
+                s, attribute.c_str(), m_name->c_str(), m_file_name.c_str());
         return 0;
     }
 
+    *value = u;
     return 1;
 }   // get(uint32_t)
 
 // ----------------------------------------------------------------------------
 int XMLNode::get(const std::string &attribute, float *value) const
 {
-    std::string s;
-    if(!get(attribute, &s)) return 0;
+    const char *s = getValue(attribute);
+    if(!s) return 0;
 
-    if (!StringUtils::parseString<float>(s, value))
+    float f;
+    // Leading white space is accepted (like StringUtils::parseString does)
+    const char *start = s;
+    while(isspace((unsigned char)*start)) start++;
+    const char *end = parseFloat(start, &f);
+    if (!end || *end)
     {
         fprintf(stderr, "[XMLNode] WARNING: Expected float but found '%s' for attribute '%s' of node '%s' in file %s\n",
-                s.c_str(), attribute.c_str(), m_name.c_str(), m_file_name.c_str());
+                s, attribute.c_str(), m_name->c_str(), m_file_name.c_str());
         return 0;
     }
 
+    *value = f;
     return 1;
-}   // get(int)
+}   // get(float)
 
 // ----------------------------------------------------------------------------
 int XMLNode::get(const std::string &attribute, bool *value) const
 {
-    std::string s;
+    const char *s = getValue(attribute);
 
     // FIXME: for some reason, missing attributes don't trigger that if???
-    if(!get(attribute, &s)) return 0;
+    if(!s) return 0;
     *value = s[0]=='T' || s[0]=='t' || s[0]=='Y' || s[0]=='y' ||
-             s=="#t"   || s   =="#T" || s=="1";
+             strcmp(s, "#t")==0 || strcmp(s, "#T")==0 || strcmp(s, "1")==0;
     return 1;
 }   // get(bool)
 
@@ -390,25 +733,21 @@ int XMLNode::get(const std::string &attribute,
 int XMLNode::get(const std::string &attribute,
                  std::vector<float> *value) const
 {
-    std::string s;
-    if(!get(attribute, &s)) return 0;
+    const char *s = getValue(attribute);
+    if(!s) return 0;
 
-    std::vector<std::string> v = StringUtils::split(s,' ');
     value->clear();
-
-    const unsigned int count = v.size();
-    for (unsigned int i=0; i<count; i++)
+    const int count = parseFloatList(s, NULL, 0);
+    if (count<0)
     {
-        float curr;
-        if (!StringUtils::parseString<float>(v[i], &curr))
-        {
-            fprintf(stderr, "[XMLNode] WARNING: Expected float but found '%s' for attribute '%s' of node '%s' in file %s\n",
-                    v[i].c_str(), attribute.c_str(), m_name.c_str(), m_file_name.c_str());
-            return 0;
-        }
-
-        value->push_back(curr);
+        fprintf(stderr, "[XMLNode] WARNING: Expected floats but found '%s' for attribute '%s' of node '%s' in file %s\n",
+                s, attribute.c_str(), m_name->c_str(), m_file_name.c_str());
+        return 0;
     }
+    if (count==0) return 0;
+
+    value->resize(count);
+    parseFloatList(s, &(*value)[0], count);
     return value->size();
 }   // get(vector<float>)
 
@@ -421,24 +760,23 @@ int XMLNode::get(const std::string &attribute,
  */
 int XMLNode::get(const std::string &attribute, std::vector<int> *value) const
 {
-    std::string s;
-    if(!get(attribute, &s)) return 0;
+    const char *s = getValue(attribute);
+    if(!s) return 0;
 
-    std::vector<std::string> v = StringUtils::split(s,' ');
     value->clear();
-
-    const unsigned int count = v.size();
-    for (unsigned int i=0; i<count; i++)
+    while (*s)
     {
         int val;
-        if (!StringUtils::parseString<int>(v[i], &val))
+        const char *end = parseInt(s, &val);
+        if (!end)
         {
             fprintf(stderr, "[XMLNode] WARNING: Expected int but found '%s' for attribute '%s' of node '%s'\n",
-                    v[i].c_str(), attribute.c_str(), m_name.c_str());
+                    s, attribute.c_str(), m_name->c_str());
             return 0;
         }
 
         value->push_back(val);
+        s = *end==' ' ? end+1 : end;
     }
     return value->size();
 }   // get(vector<int>)
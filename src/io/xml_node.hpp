@@ -54,14 +54,33 @@ class Vec3;
 class XMLNode : public NoCopy
 {
 private:
-    /** Name of this element. */
-    std::string                          m_name;
+    /** An attribute of a node. */
+    struct Attribute
+    {
+        /** The name of the attribute (interned, i.e. all attributes with
+         *  the same name in a tree point to the same string). */
+        const std::string *m_name;
+        /** Offset of the (UTF-8 encoded and 0 terminated) value in the
+         *  value buffer of the shared data. */
+        unsigned int       m_value;
+    };   // Attribute
+
+    /** Name of this element (interned). */
+    const std::string                   *m_name;
     /** List of all attributes. */
-    std::map<std::string, core::stringw> m_attributes;
+    std::vector<Attribute>               m_attributes;
+    /** Data shared by all nodes of a tree (the attribute values and the
+     *  interned names), owned by the root node. */
+    struct SharedData;
+    SharedData                          *m_shared;
+    /** True if this node owns (i.e. has to delete) the shared data. */
+    bool                                 m_owns_shared;
     /** List of all sub nodes. */
     std::vector<XMLNode *>               m_nodes;
 
+         XMLNode(io::IXMLReader *xml, SharedData *shared);
     void readXML(io::IXMLReader *xml);
+    const char *getValue(const std::string &attribute) const;
 
     std::string                          m_file_name;
 
@@ -74,7 +93,7 @@ public:
 
         ~XMLNode();
 
-    const std::string &getName() const {return m_name; }
+    const std::string &getName() const {return *m_name; }
     const XMLNode     *getNode(const std::string &name) const;
     const void         getNodes(const std::string &s, std::vector<XMLNode*>& out) const;
     const XMLNode     *getNode(unsigned int i) const;
@@ -24,6 +24,7 @@
 #if defined(WIN32) && !defined(__CYGWIN__) && !defined(__MINGW32__)
 #  define isnan _isnan
 #endif
+#include <float.h>
 #include <math.h>
 
 #include <IMeshManipulator.h>
@@ -37,6 +38,7 @@
 #include "items/projectile_manager.hpp"
 #include "karts/abstract_kart.hpp"
 #include "karts/explosion_animation.hpp"
+#include "karts/kart_spatial_index.hpp"
 #include "modes/world.hpp"
 #include "network/flyable_info.hpp"
 #include "physics/physics.hpp"
@@ -202,70 +204,101 @@ Flyable::~Flyable()
 }   // ~Flyable
 
 //-----------------------------------------------------------------------------
-/** Returns information on what is the closest kart and at what distance it is.
- *  All 3 parameters first are of type 'out'. 'inFrontOf' can be set if you
- *  wish to know the closest kart in front of some karts (will ignore those
- *  behind). Useful e.g. for throwing projectiles in front only.
+/** The distance function used in getClosestKart to select the karts that
+ *  can be targeted by a flyable.
  */
-
-void Flyable::getClosestKart(const AbstractKart **minKart,
-                             float *minDistSquared, Vec3 *minDelta,
-                             const AbstractKart* inFrontOf,
-                             const bool backwards) const
+class FlyableTargetDistance : public KartSpatialIndex::DistanceFunction
 {
-    btTransform trans_projectile = (inFrontOf != NULL ? inFrontOf->getTrans()
-                                                      : getTrans());
-
-    *minDistSquared = 999999.9f;
-    *minKart = NULL;
-
-    World *world = World::getWorld();
-    for(unsigned int i=0 ; i<world->getNumKarts(); i++ )
+private:
+    const AbstractKart *m_owner;
+    const AbstractKart *m_in_front_of;
+    bool                m_backwards;
+    btTransform         m_trans_projectile;
+public:
+    FlyableTargetDistance(const AbstractKart *owner,
+                          const AbstractKart *in_front_of, bool backwards,
+                          const btTransform &trans_projectile)
+    {
+        m_owner            = owner;
+        m_in_front_of      = in_front_of;
+        m_backwards        = backwards;
+        m_trans_projectile = trans_projectile;
+    }   // FlyableTargetDistance
+    // ------------------------------------------------------------------------
+    virtual float getDistance2(const AbstractKart *kart) const
     {
-        AbstractKart *kart = world->getKart(i);
         // If a kart has star effect shown, the kart is immune, so
         // it is not considered a target anymore.
         if(kart->isEliminated() || kart == m_owner ||
             kart->isInvulnerable()                 ||
-            kart->getKartAnimation()                   ) continue;
+            kart->getKartAnimation()                   ) return -1;
         btTransform t=kart->getTrans();
 
-        Vec3 delta      = t.getOrigin()-trans_projectile.getOrigin();
+        Vec3 delta      = t.getOrigin()-m_trans_projectile.getOrigin();
         // the Y distance is added again because karts above or below should//
         // not be prioritized when aiming
         float distance2 = delta.length2() + abs(t.getOrigin().getY()
-                        - trans_projectile.getOrigin().getY())*2;
+                        - m_trans_projectile.getOrigin().getY())*2;
 
-        if(inFrontOf != NULL)
+        if(m_in_front_of != NULL)
         {
             // Ignore karts behind the current one
-            Vec3 to_target       = kart->getXYZ() - inFrontOf->getXYZ();
+            Vec3 to_target       = kart->getXYZ() - m_in_front_of->getXYZ();
             const float distance = to_target.length();
-            if(distance > 50) continue; // kart too far, don't aim at it
+            if(distance > 50) return -1; // kart too far, don't aim at it
 
-            btTransform trans = inFrontOf->getTrans();
+            btTransform trans = m_in_front_of->getTrans();
             // get heading=trans.getBasis*(0,0,1) ... so save the multiplication:
             Vec3 direction(trans.getBasis().getColumn(2));
             // Originally it used angle = to_target.angle( backwards ? -direction : direction );
             // but sometimes due to rounding errors we get an acos(x) with x>1, causing
             // an assertion failure. So we remove the whole acos() test here and copy the
             // code from to_target.angle(...)
-            Vec3  v = backwards ? -direction : direction;
+            Vec3  v = m_backwards ? -direction : direction;
             float s = sqrt(v.length2() * to_target.length2());
             float c = to_target.dot(v)/s;
             // Original test was: fabsf(acos(c))>1,  which is the same as
             // c<cos(1) (acos returns values in [0, pi] anyway)
-            if(c<0.54) continue;
+            if(c<0.54) return -1;
         }
+        return distance2;
+    }   // getDistance2
+};   // FlyableTargetDistance
 
-        if(distance2 < *minDistSquared)
-        {
-            *minDistSquared = distance2;
-            *minKart  = kart;
-            *minDelta = delta;
-        }
-    }  // for i<getNumKarts
+//-----------------------------------------------------------------------------
+/** Returns information on what is the closest kart and at what distance it is.
+ *  All 3 parameters first are of type 'out'. 'inFrontOf' can be set if you
+ *  wish to know the closest kart in front of some karts (will ignore those
+ *  behind). Useful e.g. for throwing projectiles in front only.
+ */
 
+void Flyable::getClosestKart(const AbstractKart **minKart,
+                             float *minDistSquared, Vec3 *minDelta,
+                             const AbstractKart* inFrontOf,
+                             const bool backwards) const
+{
+    btTransform trans_projectile = (inFrontOf != NULL ? inFrontOf->getTrans()
+                                                      : getTrans());
+
+    *minDistSquared = 999999.9f;
+    *minKart = NULL;
+
+    // Karts in front further away than 50 are not targeted
+    const float max_distance = inFrontOf != NULL ? 50.0f : FLT_MAX;
+    FlyableTargetDistance distance(m_owner, inFrontOf, backwards,
+                                   trans_projectile);
+    float distance2;
+    const KartSpatialIndex *index = World::getWorld()->getKartIndex();
+    AbstractKart *kart = index->getClosestKart(trans_projectile.getOrigin(),
+                                               distance, max_distance,
+                                               &distance2);
+    if(kart && distance2 < *minDistSquared)
+    {
+        *minDistSquared = distance2;
+        *minKart        = kart;
+        *minDelta       = kart->getTrans().getOrigin()
+                        - trans_projectile.getOrigin();
+    }
 }   // getClosestKart
 
 //-----------------------------------------------------------------------------
@@ -18,6 +18,8 @@
 
 #include "items/item_manager.hpp"
 
+#include <algorithm>
+#include <math.h>
 #include <stdexcept>
 #include <string>
 #include <sstream>
@@ -41,6 +43,14 @@ std::vector<scene::IMesh *> ItemManager::m_item_mesh;
 std::vector<scene::IMesh *> ItemManager::m_item_lowres_mesh;
 ItemManager *               ItemManager::m_item_manager = NULL;
 
+/** Size of a cell of the item hash. This is larger than the collection
+ *  radius of normal items, so that an item is usually stored in only a
+ *  few cells. */
+static const float        ITEM_HASH_CELL_SIZE   = 4.0f;
+
+/** Number of buckets in the item hash, must be a power of 2. */
+static const unsigned int ITEM_HASH_NUM_BUCKETS = 1024;
+
 //-----------------------------------------------------------------------------
 /** Creates one instance of the item manager. */
 void ItemManager::create()
@@ -148,6 +158,8 @@ ItemManager::ItemManager()
         m_switch_to.push_back((Item::ItemType)i);
     setSwitchItems(stk_config->m_switch_items);
 
+    m_item_hash.resize(ITEM_HASH_NUM_BUCKETS);
+
     if(QuadGraph::get())
     {
         m_items_in_quads = new std::vector<AllItemTypes>;
@@ -209,6 +221,7 @@ void ItemManager::insertItem(Item *item)
     else
         m_all_items.push_back(item);
     item->setItemId(index);
+    addToHash(item);
 
     // Now insert into the appropriate quad list, if there is a quad list
     // (i.e. race mode has a quad graph).
@@ -226,6 +239,79 @@ void ItemManager::insertItem(Item *item)
     }   // if m_items_in_quads
 }   // insertItem
 
+//-----------------------------------------------------------------------------
+/** Returns the bucket of the item hash used for a grid cell.
+ *  \param x, z Coordinates of the grid cell.
+ */
+unsigned int ItemManager::getHashIndex(int x, int z) const
+{
+    return ((unsigned int)x*73856093u ^ (unsigned int)z*19349663u)
+           & (ITEM_HASH_NUM_BUCKETS-1);
+}   // getHashIndex
+
+//-----------------------------------------------------------------------------
+/** Determines the range of grid cells that overlap the collection radius of
+ *  an item.
+ *  \param item The item.
+ *  \param min_x, min_z, max_x, max_z On return the range of grid cells.
+ */
+void ItemManager::getHashCells(const Item *item, int *min_x, int *min_z,
+                               int *max_x, int *max_z) const
+{
+    const Vec3 &xyz = item->getXYZ();
+    const float r   = sqrtf(item->getDistance2());
+    *min_x = (int)floorf((xyz.getX()-r)/ITEM_HASH_CELL_SIZE);
+    *max_x = (int)floorf((xyz.getX()+r)/ITEM_HASH_CELL_SIZE);
+    *min_z = (int)floorf((xyz.getZ()-r)/ITEM_HASH_CELL_SIZE);
+    *max_z = (int)floorf((xyz.getZ()+r)/ITEM_HASH_CELL_SIZE);
+}   // getHashCells
+
+//-----------------------------------------------------------------------------
+/** Adds an item to all buckets of the item hash that overlap its collection
+ *  radius. Each bucket is kept sorted by item index, so that items are
+ *  tested for collection in the same order as in m_all_items.
+ *  \param item The item to add.
+ */
+void ItemManager::addToHash(Item *item)
+{
+    int min_x, min_z, max_x, max_z;
+    getHashCells(item, &min_x, &min_z, &max_x, &max_z);
+    for(int z=min_z; z<=max_z; z++)
+    {
+        for(int x=min_x; x<=max_x; x++)
+        {
+            AllItemTypes &bucket = m_item_hash[getHashIndex(x, z)];
+            AllItemTypes::iterator it = bucket.begin();
+            while(it!=bucket.end() && (*it)->getItemId()<item->getItemId())
+                it++;
+            // Different cells can use the same bucket
+            if(it==bucket.end() || *it!=item)
+                bucket.insert(it, item);
+        }   // for x
+    }   // for z
+}   // addToHash
+
+//-----------------------------------------------------------------------------
+/** Removes an item from the item hash.
+ *  \param item The item to remove.
+ */
+void ItemManager::removeFromHash(Item *item)
+{
+    int min_x, min_z, max_x, max_z;
+    getHashCells(item, &min_x, &min_z, &max_x, &max_z);
+    for(int z=min_z; z<=max_z; z++)
+    {
+        for(int x=min_x; x<=max_x; x++)
+        {
+            AllItemTypes &bucket = m_item_hash[getHashIndex(x, z)];
+            AllItemTypes::iterator it = std::find(bucket.begin(),
+                                                  bucket.end(), item);
+            if(it!=bucket.end())
+                bucket.erase(it);
+        }   // for x
+    }   // for z
+}   // removeFromHash
+
 //-----------------------------------------------------------------------------
 /** Creates a new item.
  *  \param type Type of the item.
@@ -296,26 +382,27 @@ void  ItemManager::checkItemHit(AbstractKart* kart)
     // Only do this on the server
     if(network_manager->getMode()==NetworkManager::NW_CLIENT) return;
 
-    // We could use m_items_in_quads to to check for item hits: take the quad
-    // of the graph node of the kart, and only check items in that quad. But
-    // then we also need to check for any adjacent quads (since an item just
-    // on the order of one quad might get hit from an adjacent quad). Then
-    // it is possible that a quad is that short that we need to test adjacent
-    // of adjacent quads. And check for items outside of the track.
-    // Since at this stace item detection is by far not a bottle neck,
-    // the original, simple and stable algorithm is left in place.
-
-    for(AllItemTypes::iterator i =m_all_items.begin();
-        i!=m_all_items.end();  i++)
+    // Only the items in the hash bucket of the grid cell the kart is in
+    // can be hit: each item is stored in all cells that overlap its
+    // collection radius. Using the hash instead of m_items_in_quads also
+    // works for items outside of the track and in battle mode (which has
+    // no quad graph). Since the buckets are sorted by item index, items
+    // are collected in the same order as when testing all items.
+    const Vec3 &xyz = kart->getXYZ();
+    const int x = (int)floorf(xyz.getX()/ITEM_HASH_CELL_SIZE);
+    const int z = (int)floorf(xyz.getZ()/ITEM_HASH_CELL_SIZE);
+    AllItemTypes &bucket = m_item_hash[getHashIndex(x, z)];
+
+    for(AllItemTypes::iterator i =bucket.begin(); i!=bucket.end(); i++)
     {
-        if((!*i) || (*i)->wasCollected()) continue;
+        if((*i)->wasCollected()) continue;
         // To allow inlining and avoid including kart.hpp in item.hpp,
         // we pass the kart and the position separately.
         if((*i)->hitKart(kart->getXYZ(), kart))
         {
             collectedItem(*i, kart);
         }   // if hit
-    }   // for m_all_items
+    }   // for i in bucket
 }   // checkItemHit
 
 //-----------------------------------------------------------------------------
@@ -419,6 +506,8 @@ void ItemManager::deleteItem(Item *item)
         items.erase(it);
     }   // if m_items_in_quads
 
+    removeFromHash(item);
+
     int index = item->getItemId();
     m_all_items[index] = NULL;
     delete item;
@@ -74,6 +74,12 @@ private:
      *  field is undefined if no QuadGraph exist, e.g. in battle mode. */
     std::vector< AllItemTypes > *m_items_in_quads;
 
+    /** A spatial hash of all items (using a 2d grid in the XZ plane), used
+     *  to quickly find the items a kart can hit. Each item is stored in all
+     *  grid cells that overlap its collection radius, and each bucket is
+     *  sorted by item index. */
+    std::vector< AllItemTypes > m_item_hash;
+
     /** What item this item is switched to. */
     std::vector<Item::ItemType> m_switch_to;
 
@@ -83,6 +89,11 @@ private:
 
     void  insertItem(Item *item);
     void  deleteItem(Item *item);
+    void  addToHash(Item *item);
+    void  removeFromHash(Item *item);
+    void  getHashCells(const Item *item, int *min_x, int *min_z,
+                       int *max_x, int *max_z) const;
+    unsigned int getHashIndex(int x, int z) const;
 
     // Make those private so only create/destroy functions can call them.
                    ItemManager();
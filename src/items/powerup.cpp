@@ -28,6 +28,7 @@
 #include "karts/abstract_kart.hpp"
 #include "karts/controller/controller.hpp"
 #include "karts/kart_properties.hpp"
+#include "karts/kart_spatial_index.hpp"
 #include "modes/world.hpp"
 #include "network/network_manager.hpp"
 #include "network/race_state.hpp"
@@ -323,12 +324,9 @@ void Powerup::use()
     case PowerupManager::POWERUP_ANVIL:
         //Attach an anvil(twice as good as the one given
         //by the bananas) to the kart in the 1st position.
-        for(unsigned int i = 0 ; i < world->getNumKarts(); ++i)
         {
-            AbstractKart *kart=world->getKart(i);
-            if(kart->isEliminated()) continue;
-            if(kart == m_owner) continue;
-            if(kart->getPosition() == 1)
+            AbstractKart *kart = world->getKartIndex()->getLeadingKart();
+            if(kart && kart != m_owner && kart->getPosition() == 1)
             {
                 kart->getAttachment()->set(Attachment::ATTACH_ANVIL,
                                            stk_config->m_anvil_time);
@@ -350,7 +348,6 @@ void Powerup::use()
                 anchor_message += StringUtils::insertValues(getAnchorString(), core::stringw(kart->getName()));
                 gui->addMessage(translations->fribidize(anchor_message), NULL, 3.0f,
                                 video::SColor(255, 255, 255, 255), false);
-                break;
             }
         }
 
@@ -362,25 +359,22 @@ void Powerup::use()
             //Attach a parachutte(that last twice as long as the
             //one from the bananas) to all the karts that
             //are in front of this one.
-            for(unsigned int i = 0 ; i < world->getNumKarts(); ++i)
+            const KartSpatialIndex *index = world->getKartIndex();
+            AbstractKart *kart;
+            for(unsigned int n=1; (kart=index->getKartAhead(m_owner, n)); n++)
             {
-                AbstractKart *kart=world->getKart(i);
-                if(kart->isEliminated() || kart== m_owner) continue;
                 if(kart->isShielded())
                 {
                     kart->decreaseShieldTime(stk_config->m_bubblegum_shield_time);
                     Log::verbose("Powerup", "Decreasing shield \n");
                     continue;
                 }
-                if(m_owner->getPosition() > kart->getPosition())
-                {
-                    kart->getAttachment()
-                        ->set(Attachment::ATTACH_PARACHUTE,
-                              stk_config->m_parachute_time_other);
+                kart->getAttachment()
+                    ->set(Attachment::ATTACH_PARACHUTE,
+                          stk_config->m_parachute_time_other);
 
-                    if(kart->getController()->isPlayerController())
-                        player_kart = kart;
-                }
+                if(kart->getController()->isPlayerController())
+                    player_kart = kart;
             }
 
             // should we position the sound at the kart that is hit,
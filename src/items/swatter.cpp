@@ -37,6 +37,7 @@
 #include "karts/controller/controller.hpp"
 #include "karts/explosion_animation.hpp"
 #include "karts/kart_properties.hpp"
+#include "karts/kart_spatial_index.hpp"
 #include "modes/world.hpp"
 #include "karts/abstract_kart.hpp"
 
@@ -206,33 +207,41 @@ void Swatter::onAnimationEnd()
 }   // onAnimationEnd
 
 // ----------------------------------------------------------------------------
-/** Determine the nearest kart or item and update the current target
- *  accordingly.
+/** The distance function used to find the kart to aim the swatter at.
  */
-void Swatter::chooseTarget()
+class SwatterTargetDistance : public KartSpatialIndex::DistanceFunction
 {
-    // TODO: for the moment, only handle karts...
-    const World*  world         = World::getWorld();
-    AbstractKart* closest_kart  = NULL;
-    float         min_dist2     = FLT_MAX;
-
-    for(unsigned int i=0; i<world->getNumKarts(); i++)
+private:
+    const AbstractKart *m_kart;
+public:
+    SwatterTargetDistance(const AbstractKart *kart) { m_kart = kart; }
+    // ------------------------------------------------------------------------
+    virtual float getDistance2(const AbstractKart *kart) const
     {
-        AbstractKart *kart = world->getKart(i);
         // TODO: isSwatterReady(), isSquashable()?
         if(kart->isEliminated() || kart==m_kart)
-            continue;
+            return -1;
         // don't squash an already hurt kart
         if (kart->isInvulnerable() || kart->isSquashed())
-            continue;
+            return -1;
 
-        float dist2 = (kart->getXYZ()-m_kart->getXYZ()).length2();
-        if(dist2<min_dist2)
-        {
-            min_dist2 = dist2;
-            closest_kart = kart;
-        }
-    }
+        return (kart->getXYZ()-m_kart->getXYZ()).length2();
+    }   // getDistance2
+};   // SwatterTargetDistance
+
+// ----------------------------------------------------------------------------
+/** Determine the nearest kart or item and update the current target
+ *  accordingly.
+ */
+void Swatter::chooseTarget()
+{
+    // TODO: for the moment, only handle karts...
+    const World*  world         = World::getWorld();
+    float         min_dist2;
+    AbstractKart* closest_kart  =
+        world->getKartIndex()->getClosestKart(m_kart->getXYZ(),
+                                              SwatterTargetDistance(m_kart),
+                                              FLT_MAX, &min_dist2);
     m_target = closest_kart;    // may be NULL
 }
 
@@ -279,9 +288,12 @@ void Swatter::squashThingsAround()
     m_swat_sound->play();
 
     // Squash karts around
-    for(unsigned int i=0; i<world->getNumKarts(); i++)
+    std::vector<AbstractKart*> karts;
+    world->getKartIndex()->getKartsInRadius(swatter_pos, sqrtf(min_dist2),
+                                            &karts);
+    for(unsigned int i=0; i<karts.size(); i++)
     {
-        AbstractKart *kart = world->getKart(i);
+        AbstractKart *kart = karts[i];
         // TODO: isSwatterReady()
         if(kart->isEliminated() || kart==m_kart)
             continue;
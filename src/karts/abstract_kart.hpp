@@ -364,6 +364,11 @@ public:
      *  which includes attaching an anvil to the kart (and detaching). */
     virtual void updateWeight() = 0;
     // ------------------------------------------------------------------------
+    /** Casts the terrain ray of the next update in advance. This is called
+     *  for all karts in parallel after the physics step and before any kart
+     *  is updated, so it must only modify data of this kart. */
+    virtual void predictTerrainInfo() = 0;
+    // ------------------------------------------------------------------------
     /** Multiplies the velocity of the kart by a factor f (both linear
      *  and angular). This is used by anvils, which suddenly slow down the kart
      *  when they are attached. */
@@ -34,7 +34,7 @@
 #include "karts/kart_properties.hpp"
 #include "karts/skidding.hpp"
 #include "karts/rescue_animation.hpp"
-#include "modes/world.hpp"
+#include "modes/world_with_rank.hpp"
 #include "race/history.hpp"
 #include "states_screens/race_gui_base.hpp"
 #include "utils/constants.hpp"
@@ -393,18 +393,13 @@ void PlayerController::setPosition(int p)
 {
     if(m_kart->getPosition()<p)
     {
-        World *world = World::getWorld();
+        WorldWithRank *world = dynamic_cast<WorldWithRank*>(World::getWorld());
+        if(!world) return;
         //have the kart that did the passing beep.
         //I'm not sure if this method of finding the passing kart is fail-safe.
-        for(unsigned int i = 0 ; i < world->getNumKarts(); i++ )
-        {
-            AbstractKart *kart = world->getKart(i);
-            if(kart->getPosition() == p + 1)
-            {
-                kart->beep();
-                break;
-            }
-        }
+        AbstractKart *kart = world->getKartAtPosition(p + 1);
+        if(kart)
+            kart->beep();
     }
 }   // setPosition
 
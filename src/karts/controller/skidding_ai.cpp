@@ -45,6 +45,7 @@
 #include "karts/controller/kart_control.hpp"
 #include "karts/controller/ai_properties.hpp"
 #include "karts/kart_properties.hpp"
+#include "karts/kart_spatial_index.hpp"
 #include "karts/max_speed.hpp"
 #include "karts/rescue_animation.hpp"
 #include "karts/skidding.hpp"
@@ -77,6 +78,10 @@
 #include <cstdio>
 #include <iostream>
 
+/** Number of lateral positions on each graph node for which the result
+ *  of findNonCrashingPoint is cached. */
+static const int NUM_AIM_POINT_BINS = 5;
+
 SkiddingAI::SkiddingAI(AbstractKart *kart)
                    : AIBaseController(kart)
 {
@@ -194,6 +199,7 @@ void SkiddingAI::reset()
     m_avoid_item_close           = false;
     m_skid_probability_state     = SKID_PROBAB_NOT_YET;
     m_last_item_random           = NULL;
+    clearAimPointCache();
 
     AIBaseController::reset();
     m_track_node               = QuadGraph::UNKNOWN_SECTOR;
@@ -232,6 +238,30 @@ unsigned int SkiddingAI::getNextSector(unsigned int index)
     return m_successor_index[index];
 }   // getNextSector
 
+//-----------------------------------------------------------------------------
+/** Called when a new lap is started. Since the AI might select a different
+ *  path, the cached aim points are discarded.
+ *  \param lap The new lap.
+ */
+void SkiddingAI::newLap(int lap)
+{
+    AIBaseController::newLap(lap);
+    clearAimPointCache();
+}   // newLap
+
+//-----------------------------------------------------------------------------
+/** Marks all entries of the aim point cache as not computed. */
+void SkiddingAI::clearAimPointCache()
+{
+    AimPointCacheEntry empty;
+    empty.m_last_node     = -1;
+    empty.m_previous_node = -1;
+    empty.m_sharp_turn    = false;
+    m_aim_point_cache.clear();
+    m_aim_point_cache.resize(QuadGraph::get()->getNumNodes()
+                             *NUM_AIM_POINT_BINS, empty);
+}   // clearAimPointCache
+
 //-----------------------------------------------------------------------------
 /** This is the main entry point for the AI.
  *  It is called once per frame for each AI and determines the behaviour of
@@ -1374,32 +1404,21 @@ void SkiddingAI::handleItems(const float dt)
 
 //-----------------------------------------------------------------------------
 /** Determines the closest karts just behind and in front of this kart. The
- *  'closeness' is for now simply based on the position, i.e. if a kart is
- *  more than one lap behind or ahead, it is not considered to be closest.
+ *  'closeness' is for now simply based on the overall distance along the
+ *  driveline (i.e. the position), i.e. if a kart is more than one lap behind
+ *  or ahead, it is not considered to be closest. Only karts that are still
+ *  racing are considered.
  */
 void SkiddingAI::computeNearestKarts()
 {
-    int my_position    = m_kart->getPosition();
+    const KartSpatialIndex *index = m_world->getKartIndex();
 
-    // If we are not the first, there must be another kart ahead of this kart
-    if( my_position>1 )
-    {
-        m_kart_ahead = m_world->getKartAtPosition(my_position-1);
-        if(m_kart_ahead &&
-              ( m_kart_ahead->isEliminated() || m_kart_ahead->hasFinishedRace()))
-              m_kart_ahead = NULL;
-    }
-    else
+    m_kart_ahead = index->getKartAhead(m_kart);
+    if(m_kart_ahead && m_kart_ahead->isEliminated())
         m_kart_ahead = NULL;
 
-    if( my_position<(int)m_world->getCurrentNumKarts())
-    {
-        m_kart_behind = m_world->getKartAtPosition(my_position+1);
-        if(m_kart_behind &&
-            (m_kart_behind->isEliminated() || m_kart_behind->hasFinishedRace()))
-            m_kart_behind = NULL;
-    }
-    else
+    m_kart_behind = index->getKartBehind(m_kart);
+    if(m_kart_behind && m_kart_behind->isEliminated())
         m_kart_behind = NULL;
 
     m_distance_ahead = m_distance_behind = 9999999.9f;
@@ -1961,15 +1980,70 @@ void SkiddingAI::findNonCrashingPointFixed(Vec3 *aim_position, int *last_node)
     Vec3 forw(0, 0, 50);
     m_curve[CURVE_KART]->addPoint(m_kart->getTrans()(forw)+eps);
 #endif
-    *last_node = m_next_node_index[m_track_node];
-    float angle = QuadGraph::get()->getAngleToNext(m_track_node,
-                                              m_successor_index[m_track_node]);
-    int target_sector;
+    const QuadGraph *qg = QuadGraph::get();
+    const GraphNode &node = qg->getNode(m_track_node);
+    const Vec3 &xyz = m_kart->getXYZ();
+
+    // The result mostly depends on the lateral position of the kart on
+    // its graph node, so the search is done once for a few lateral
+    // positions and then cached.
+    Vec3 track_coord;
+    qg->spatialToTrack(&track_coord, xyz, m_track_node);
+    const float width = node.getPathWidth();
+    int bin = NUM_AIM_POINT_BINS/2;
+    if(width>0)
+    {
+        float f = (track_coord[0]/width + 0.5f) * NUM_AIM_POINT_BINS;
+        bin = f<0 ? 0 : (f>=NUM_AIM_POINT_BINS ? NUM_AIM_POINT_BINS-1
+                                              : (int)f);
+    }
+    AimPointCacheEntry &cached =
+        m_aim_point_cache[m_track_node*NUM_AIM_POINT_BINS+bin];
+    if(cached.m_last_node==-1)
+    {
+        const float offset = ((bin+0.5f)/NUM_AIM_POINT_BINS - 0.5f)*width;
+        searchNonCrashingPoint(node.getCenter()
+                               + node.getRightUnitVector()*offset,
+                               &cached);
+    }
+
+    // Check that the cached result is also correct for the actual kart
+    // position: the last node must be reachable, and (unless the search
+    // stopped because of a sharp turn) the node after it must not be.
+    AimPointCacheEntry result = cached;
+    bool valid = result.m_previous_node==-1 ||
+                 canDriveStraight(xyz, result.m_previous_node,
+                                  result.m_last_node);
+    if(valid && !result.m_sharp_turn)
+        valid = !canDriveStraight(xyz, result.m_last_node,
+                                  m_next_node_index[result.m_last_node]);
+    if(!valid)
+        searchNonCrashingPoint(xyz, &result);
+
+    *last_node = result.m_last_node;
+    const int aim_node = result.m_sharp_turn
+                       ? m_next_node_index[result.m_last_node]
+                       : result.m_last_node;
+    *aim_position = qg->getQuadOfNode(aim_node).getCenter();
+}   // findNonCrashingPoint
 
-    Vec3 direction;
-    Vec3 step_track_coord;
+//-----------------------------------------------------------------------------
+/** Searches the furthest graph node (on the path of this AI) that can be
+ *  reached by driving in a straight line from the given point without
+ *  leaving the track. See findNonCrashingPoint for details.
+ *  \param xyz The point from which to drive.
+ *  \param result On return the result of the search.
+ */
+void SkiddingAI::searchNonCrashingPoint(const Vec3 &xyz,
+                                        AimPointCacheEntry *result)
+{
+    const QuadGraph *qg = QuadGraph::get();
+    int last_node     = m_next_node_index[m_track_node];
+    int previous_node = -1;
+    float angle = qg->getAngleToNext(m_track_node,
+                                     m_successor_index[m_track_node]);
+    result->m_sharp_turn = false;
 
-    float angle1;
     // The original while(1) loop is replaced with a for loop to avoid
     // infinite loops (which we had once or twice). Usually the number
     // of iterations in the while loop is less than 7.
@@ -1977,63 +2051,79 @@ void SkiddingAI::findNonCrashingPointFixed(Vec3 *aim_position, int *last_node)
     {
         // target_sector is the sector at the longest distance that we can
         // drive to without crashing with the track.
-        target_sector = m_next_node_index[*last_node];
-        angle1 = QuadGraph::get()->getAngleToNext(target_sector,
-                                                m_successor_index[target_sector]);
+        int target_sector = m_next_node_index[last_node];
+        float angle1 = qg->getAngleToNext(target_sector,
+                                          m_successor_index[target_sector]);
         // In very sharp turns this algorithm tends to aim at off track points,
         // resulting in hitting a corner. So test for this special case and
         // prevent a too-far look-ahead in this case
         float diff = normalizeAngle(angle1-angle);
         if(fabsf(diff)>1.5f)
         {
-            *aim_position = QuadGraph::get()->getQuadOfNode(target_sector)
-                                                 .getCenter();
-            return;
+            result->m_sharp_turn = true;
+            break;
         }
 
-        //direction is a vector from our kart to the sectors we are testing
-        direction = QuadGraph::get()->getQuadOfNode(target_sector).getCenter()
-                  - m_kart->getXYZ();
+        //If we are outside, the previous node is what we are looking for
+        if(!canDriveStraight(xyz, last_node, target_sector))
+            break;
 
-        float len=direction.length_2d();
-        unsigned int steps = (unsigned int)( len / m_kart_length );
-        if( steps < 3 ) steps = 3;
+        angle         = angle1;
+        previous_node = last_node;
+        last_node     = target_sector;
+    }   // for i<100
+    result->m_last_node     = last_node;
+    result->m_previous_node = previous_node;
+}   // searchNonCrashingPoint
 
-        // That shouldn't happen, but since we had one instance of
-        // STK hanging, add an upper limit here (usually it's at most
-        // 20 steps)
-        if( steps>1000) steps = 1000;
+//-----------------------------------------------------------------------------
+/** Tests if the kart would stay on track when driving in a straight line
+ *  from a point to the center of a graph node. Note that (as described in
+ *  findNonCrashingPoint) all tested points are compared with the same
+ *  graph node, and with the full path width.
+ *  \param xyz The start point.
+ *  \param last_node The graph node against which all points are tested.
+ *  \param target The graph node to drive to.
+ */
+bool SkiddingAI::canDriveStraight(const Vec3 &xyz, int last_node,
+                                  int target) const
+{
+    const QuadGraph *qg = QuadGraph::get();
 
-        // Protection against having vel_normal with nan values
-        if(len>0.0f) {
-            direction*= 1.0f/len;
-        }
+    //direction is a vector from our kart to the sectors we are testing
+    Vec3 direction = qg->getQuadOfNode(target).getCenter() - xyz;
 
-        Vec3 step_coord;
-        //Test if we crash if we drive towards the target sector
-        for(unsigned int i = 2; i < steps; ++i )
-        {
-            step_coord = m_kart->getXYZ()+direction*m_kart_length * float(i);
+    float len=direction.length_2d();
+    unsigned int steps = (unsigned int)( len / m_kart_length );
+    if( steps < 3 ) steps = 3;
 
-            QuadGraph::get()->spatialToTrack(&step_track_coord, step_coord,
-                                             *last_node );
+    // That shouldn't happen, but since we had one instance of
+    // STK hanging, add an upper limit here (usually it's at most
+    // 20 steps)
+    if( steps>1000) steps = 1000;
 
-            float distance = fabsf(step_track_coord[0]);
+    // Protection against having vel_normal with nan values
+    if(len>0.0f) {
+        direction*= 1.0f/len;
+    }
 
-            //If we are outside, the previous node is what we are looking for
-            if ( distance + m_kart_width * 0.5f
-                 > QuadGraph::get()->getNode(*last_node).getPathWidth() )
-            {
-                *aim_position = QuadGraph::get()->getQuadOfNode(*last_node)
-                                                 .getCenter();
-                return;
-            }
-        }
-        angle = angle1;
-        *last_node = target_sector;
-    }   // for i<100
-    *aim_position = QuadGraph::get()->getQuadOfNode(*last_node).getCenter();
-}   // findNonCrashingPoint
+    Vec3 step_coord;
+    Vec3 step_track_coord;
+    //Test if we crash if we drive towards the target sector
+    for(unsigned int i = 2; i < steps; ++i )
+    {
+        step_coord = xyz+direction*m_kart_length * float(i);
+
+        qg->spatialToTrack(&step_track_coord, step_coord, last_node);
+
+        float distance = fabsf(step_track_coord[0]);
+
+        if ( distance + m_kart_width * 0.5f
+             > qg->getNode(last_node).getPathWidth() )
+            return false;
+    }
+    return true;
+}   // canDriveStraight
 
 //-----------------------------------------------------------------------------
 /** Determines the direction of the track ahead of the kart: 0 indicates
@@ -183,6 +183,28 @@ private:
     /** A random number generator for collecting items. */
     RandomGenerator m_random_collect_item;
 
+    /** The result of the search in findNonCrashingPoint. */
+    struct AimPointCacheEntry
+    {
+        /** The furthest node that can be reached driving straight, or -1
+         *  if this entry was not computed yet. */
+        int  m_last_node;
+        /** The node before m_last_node on the path, which is used to test
+         *  if m_last_node can be reached, or -1 if m_last_node is the next
+         *  node after the kart's node (which needs no test). */
+        int  m_previous_node;
+        /** True if the search stopped because of a sharp turn after
+         *  m_last_node, in which case the successor of m_last_node is
+         *  aimed at. */
+        bool m_sharp_turn;
+    };   // AimPointCacheEntry
+
+    /** For each graph node, the result of findNonCrashingPoint for a few
+     *  lateral positions on the node. This depends on the path selected
+     *  by this AI and the size of its kart, so it is computed on demand
+     *  and discarded when a new path is selected. */
+    std::vector<AimPointCacheEntry> m_aim_point_cache;
+
     /** \brief Determines the algorithm to use to select the point-to-aim-for
      *  There are three different Point Selection Algorithms:
      *  1. findNonCrashingPoint() is the default (which is actually slightly 
@@ -242,6 +264,10 @@ private:
     void  findNonCrashingPointFixed(Vec3 *result, int *last_node);
     void  findNonCrashingPointNew(Vec3 *result, int *last_node);
     void  findNonCrashingPoint(Vec3 *result, int *last_node);
+    void  searchNonCrashingPoint(const Vec3 &xyz,
+                                 AimPointCacheEntry *result);
+    bool  canDriveStraight(const Vec3 &xyz, int last_node, int target) const;
+    void  clearAimPointCache();
 
     void  determineTrackDirection();
     void  determineTurnRadius(const Vec3 &start,
@@ -255,6 +281,7 @@ private:
 
 protected:
     virtual unsigned int getNextSector(unsigned int index);
+    virtual void newLap(int lap);
 
 public:
                  SkiddingAI(AbstractKart *kart);
@@ -55,6 +55,9 @@ private:
 public:
                  GhostKart(const std::string& ident);
     virtual void update (float dt);
+    // ------------------------------------------------------------------------
+    /** No terrain information for ghost kart, it is only replayed. */
+    virtual void predictTerrainInfo() {}
     virtual void addTransform(float time, const btTransform &trans);
     virtual void addReplayEvent(const ReplayBase::KartReplayEvent &kre);
     virtual void reset();
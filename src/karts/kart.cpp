@@ -1050,6 +1050,22 @@ void Kart::eliminate()
     m_node->setVisible(false);
 }   // eliminate
 
+//-----------------------------------------------------------------------------
+/** Casts the ray of the terrain information from the position at which
+ *  update() will most likely cast it: the transform the physics computed for
+ *  this kart. update() only uses the result if the kart is still at this
+ *  position (i.e. no kart animation or other kart moved it in the meantime).
+ *  This is called for all karts in parallel before any kart is updated, so
+ *  it only reads the physics state and the track mesh.
+ */
+void Kart::predictTerrainInfo()
+{
+    if(m_kart_animation) return;
+    btTransform trans;
+    getPhysicsTrans(&trans);
+    m_terrain_info->predict(trans.getOrigin()+btVector3(0,0.3f,0));
+}   // predictTerrainInfo
+
 //-----------------------------------------------------------------------------
 /** Updates the kart in each time step. It updates the physics setting,
  *  particle effects, camera position, etc.
@@ -35,6 +35,7 @@
 #include "utils/no_copy.hpp"
 
 class btKart;
+class btKartRaycaster;
 class btUprightConstraint;
 
 class Attachment;
@@ -144,7 +145,7 @@ private:
     // Bullet physics parameters
     // -------------------------
     btCompoundShape          m_kart_chassis;
-    btVehicleRaycaster      *m_vehicle_raycaster;
+    btKartRaycaster         *m_vehicle_raycaster;
     btKart                  *m_vehicle;
     btUprightConstraint     *m_uprightConstraint;
 
@@ -266,6 +267,7 @@ public:
     virtual void   crashed          (AbstractKart *k, bool update_attachments);
     virtual void   crashed          (const Material *m, const Vec3 &normal);
     virtual float  getHoT           () const;
+    virtual void   predictTerrainInfo();
     virtual void   update           (float dt);
     virtual void   finishedRace(float time);
     virtual void   setPosition(int p);
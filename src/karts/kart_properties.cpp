@@ -44,8 +44,17 @@ float KartProperties::UNDEFINED = -99.9f;
  *  then be checked (for STKConfig) that all values are indeed defined.
  *  Otherwise the defaults are taken from STKConfig (and since they are all
  *  defined, it is guaranteed that each kart has well defined physics values).
+ *  \param filename Full path of the kart.xml file, or "" for the defaults
+ *         of STKConfig.
+ *  \param metadata The cached fields of this kart (see getMetadata), or
+ *         NULL. If defined, only these fields are set, and all other data
+ *         is only loaded when needed (see loadData).
+ *  \param root The already parsed kart.xml file, or NULL if it must be
+ *         read. It is not deleted.
  */
-KartProperties::KartProperties(const std::string &filename)
+KartProperties::KartProperties(const std::string &filename,
+                               const MetadataIndex::Fields *metadata,
+                               const XMLNode *root)
 {
     m_icon_material = NULL;
     m_minimap_icon  = NULL;
@@ -109,13 +118,27 @@ KartProperties::KartProperties(const std::string &filename)
     m_kart_model             = NULL;
     m_has_rand_wheels        = false;
     m_nitro_min_consumption  = 1.05f;
+    m_is_loaded              = true;
     // The default constructor for stk_config uses filename=""
     if (filename != "")
     {
         m_skidding_properties = NULL;
         for(unsigned int i=0; i<RaceManager::DIFFICULTY_COUNT; i++)
             m_ai_properties[i]= NULL;
-        load(filename, "kart");
+        if(!metadata)
+        {
+            load(filename, "kart", root);
+            return;
+        }
+        // Only set the values needed in the menus
+        MetadataIndex::Fields fields = *metadata;
+        m_root      = StringUtils::getPath(filename)+"/";
+        m_ident     = fields["ident"];
+        m_name      = fields["name"];
+        m_icon_file = fields["icon"];
+        m_groups    = StringUtils::split(fields["groups"], ' ');
+        m_version   = atoi(fields["version"].c_str());
+        m_is_loaded = false;
     }
     else
     {
@@ -137,6 +160,35 @@ KartProperties::~KartProperties()
             delete m_ai_properties[i];
 }   // ~KartProperties
 
+//-----------------------------------------------------------------------------
+/** Returns the fields of this kart which are needed in the menus, so that
+ *  they can be stored in the metadata index, and the kart can later be
+ *  created without loading its kart.xml file and models.
+ *  \param metadata On return contains the fields of this kart.
+ */
+void KartProperties::getMetadata(MetadataIndex::Fields *metadata) const
+{
+    (*metadata)["ident"  ] = m_ident;
+    (*metadata)["name"   ] = m_name;
+    (*metadata)["icon"   ] = m_icon_file;
+    std::string groups;
+    for(unsigned int i=0; i<m_groups.size(); i++)
+        groups += (i==0 ? "" : " ") + m_groups[i];
+    (*metadata)["groups" ] = groups;
+    (*metadata)["version"] = StringUtils::toString(m_version);
+}   // getMetadata
+
+//-----------------------------------------------------------------------------
+/** Loads the kart.xml file and the models of a kart that was created from
+ *  the metadata index. This is done by KartPropertiesManager::loadKartData,
+ *  see there for details. Throws an exception if the kart can't be loaded.
+ */
+void KartProperties::loadData()
+{
+    if(m_is_loaded) return;
+    load(m_root+"kart.xml", "kart");
+}   // loadData
+
 //-----------------------------------------------------------------------------
 /** Copies this KartProperties to another one. Importnat: if you add any
  *  pointers to kart_properties, the data structure they are pointing to
@@ -166,18 +218,23 @@ void KartProperties::copyFrom(const KartProperties *source)
 /** Loads the kart properties from a file.
  *  \param filename Filename to load.
  *  \param node Name of the xml node to load the data from
+ *  \param parsed_root The already parsed file, or NULL if the file must be
+ *         read. It is not deleted.
  */
-void KartProperties::load(const std::string &filename, const std::string &node)
+void KartProperties::load(const std::string &filename, const std::string &node,
+                          const XMLNode *parsed_root)
 {
     // Get the default values from STKConfig. This will also allocate any
     // pointers used in KartProperties
     copyFrom(&stk_config->getDefaultKartProperties());
+    // Only set once loading succeeded
+    m_is_loaded = false;
     // m_kart_model must be initialised after assigning the default
     // values from stk_config (otherwise all kart_properties will
     // share the same KartModel
     m_kart_model  = new KartModel(/*is_master*/true);
 
-    const XMLNode * root = 0;
+    const XMLNode * root = parsed_root;
     m_root  = StringUtils::getPath(filename)+"/";
     m_ident = StringUtils::getBasename(StringUtils::getPath(filename));
     // If this is an addon kart, add "addon_" to the identifier - just in
@@ -187,7 +244,8 @@ void KartProperties::load(const std::string &filename, const std::string &node)
         m_ident = Addon::createAddonId(m_ident);
     try
     {
-        root = new XMLNode(filename);
+        if(!root)
+            root = new XMLNode(filename);
         if(!root || root->getName()!="kart")
         {
             std::ostringstream msg;
@@ -205,7 +263,7 @@ void KartProperties::load(const std::string &filename, const std::string &node)
                    filename.c_str());
         Log::error("KartProperties", "%s\n", err.what());
     }
-    if(root) delete root;
+    if(root && root!=parsed_root) delete root;
 
     // Set a default group (that has to happen after init_default and load)
     if(m_groups.size()==0)
@@ -243,6 +301,7 @@ void KartProperties::load(const std::string &filename, const std::string &node)
         if (!success)
         {
             delete m_kart_model;
+            m_kart_model = NULL;
             file_manager->popTextureSearchPath();
             file_manager->popModelSearchPath();
             throw std::runtime_error("Cannot load kart models");
@@ -271,6 +330,7 @@ void KartProperties::load(const std::string &filename, const std::string &node)
     m_shadow_texture = irr_driver->getTexture(m_shadow_file);
     file_manager->popTextureSearchPath();
     file_manager->popModelSearchPath();
+    m_is_loaded = true;
 
 }   // load
 
@@ -32,6 +32,7 @@ using namespace irr;
 
 #include "audio/sfx_manager.hpp"
 #include "karts/kart_model.hpp"
+#include "io/metadata_index.hpp"
 #include "io/xml_node.hpp"
 #include "race/race_manager.hpp"
 #include "utils/interpolation_array.hpp"
@@ -87,6 +88,10 @@ private:
     /** List of all groups the kart belongs to. */
     std::vector<std::string> m_groups;
 
+    /** False if the kart was created from the metadata index, and the
+     *  kart.xml file and the models were not loaded yet. */
+    bool                     m_is_loaded;
+
     /** Dummy value to detect unset properties. */
     static float UNDEFINED;
 
@@ -374,12 +379,17 @@ private:
 
 
     void  load              (const std::string &filename,
-                             const std::string &node);
+                             const std::string &node,
+                             const XMLNode *root=NULL);
 
 
 public:
-          KartProperties    (const std::string &filename="");
+          KartProperties    (const std::string &filename="",
+                             const MetadataIndex::Fields *metadata=NULL,
+                             const XMLNode *root=NULL);
          ~KartProperties    ();
+    void  getMetadata       (MetadataIndex::Fields *metadata) const;
+    void  loadData          ();
     void  copyFrom          (const KartProperties *source);
     void  getAllData        (const XMLNode * root);
     void  checkAllSet       (const std::string &filename);
@@ -398,6 +408,11 @@ public:
         return m_turn_angle_at_speed.get(speed);
     }   // getMaxSteerAngle
 
+    // ------------------------------------------------------------------------
+    /** Returns false if the kart was created from the metadata index and
+     *  its data was not loaded yet, see KartPropertiesManager::loadKartData.
+     */
+    bool isLoaded() const { return m_is_loaded; }
     // ------------------------------------------------------------------------
     /** Returns the material for the kart icons. */
     Material*     getIconMaterial    () const {return m_icon_material;        }
@@ -30,9 +30,13 @@
 #include "graphics/irr_driver.hpp"
 #include "guiengine/engine.hpp"
 #include "io/file_manager.hpp"
+#include "io/file_prefetcher.hpp"
+#include "io/metadata_index.hpp"
 #include "karts/kart_properties.hpp"
 #include "utils/log.hpp"
 #include "utils/string_utils.hpp"
+#include "utils/time.hpp"
+#include "utils/worker_pool.hpp"
 
 KartPropertiesManager *kart_properties_manager=0;
 
@@ -95,7 +99,8 @@ void KartPropertiesManager::removeKart(const std::string &ident)
 {
     // Remove the kart properties from the vector of all kart properties
     int index = getKartId(ident);
-    const KartProperties *kp = getKart(ident);  // must be done before remove
+    // must be done before remove
+    const KartProperties *kp = getKartMetadataById(index);
     m_karts_properties.remove(index);
     m_all_kart_dirs.erase(m_all_kart_dirs.begin()+index);
     m_kart_available.erase(m_kart_available.begin()+index);
@@ -151,17 +156,174 @@ void KartPropertiesManager::removeKart(const std::string &ident)
 }   // removeKart
 
 //-----------------------------------------------------------------------------
-/** Loads all kart properties and models.
+/** Collects the files referenced by the kart.xml file of a kart: the models
+ *  and the images named in it.
+ *  \param root The root node of the kart.xml file.
+ *  \param dir The kart directory (including the trailing '/').
+ *  \param files The full paths of the files are appended to this vector.
+ */
+static void collectKartFiles(const XMLNode &root, const std::string &dir,
+                             std::vector<std::string> *files)
+{
+    static const char *file_attributes[] =
+    {
+        "model-file", "icon-file", "minimap-icon-file", "shadow-file"
+    };
+    for(unsigned int i=0; i<sizeof(file_attributes)/sizeof(char*); i++)
+    {
+        std::string file;
+        if(root.get(file_attributes[i], &file) && file!="")
+            files->push_back(dir+file);
+    }
+    if(const XMLNode *wheels = root.getNode("wheels"))
+    {
+        for(unsigned int i=0; i<wheels->getNumNodes(); i++)
+        {
+            std::string model;
+            if(wheels->getNode(i)->get("model", &model) && model!="")
+                files->push_back(dir+model);
+        }
+    }
+}   // collectKartFiles
+
+//-----------------------------------------------------------------------------
+/** Prepares loading all karts: each kart directory is looked up in the
+ *  metadata index, and for the karts that are not created from the
+ *  metadata index the kart.xml files are parsed in parallel by the worker
+ *  pool, and the models they reference are added to a prefetcher. Other
+ *  files of the karts (e.g. sounds) are not read. The results are used by
+ *  loadKart.
+ *  \param prefetcher The prefetcher to add the models to.
+ *  \param images On return contains the full paths of the images of the
+ *         karts: the images named in kart.xml, and the images in the kart
+ *         directory (the textures of the models are only named inside
+ *         the models, which are possibly compressed).
+ */
+void KartPropertiesManager::prefetchKartFiles(FilePrefetcher *prefetcher,
+                                              std::vector<std::string> *images)
+{
+    /** Parses the kart.xml file of one kart, and collects the files it
+     *  references. */
+    class ParseJob : public WorkerPool::Job
+    {
+    public:
+        std::vector<std::string>               m_dirs;
+        std::vector<XMLNode*>                  m_roots;
+        std::vector<std::vector<std::string> > m_files;
+        // --------------------------------------------------------------------
+        virtual void run(unsigned int i)
+        {
+            m_roots[i] = file_manager->createXMLTree(m_dirs[i]+"/kart.xml");
+            if(m_roots[i])
+                collectKartFiles(*m_roots[i], m_dirs[i]+"/", &m_files[i]);
+        }   // run
+    };   // ParseJob
+
+    ParseJob job;
+    std::vector<std::string>::const_iterator dir;
+    for(dir = m_kart_search_path.begin(); dir!=m_kart_search_path.end(); dir++)
+    {
+        std::vector<std::string> kart_dirs;
+        if(file_manager->fileExists(*dir+"/kart.xml"))
+            kart_dirs.push_back(*dir);
+        else
+        {
+            std::set<std::string> result;
+            file_manager->listFiles(result, *dir, /*is_full_path*/ true);
+            for(std::set<std::string>::const_iterator subdir=result.begin();
+                subdir!=result.end(); subdir++)
+            {
+                if(file_manager->fileExists(*dir+*subdir+"/kart.xml"))
+                    kart_dirs.push_back(*dir+*subdir);
+            }
+        }
+        for(unsigned int i=0; i<kart_dirs.size(); i++)
+        {
+            // Looking up a directory checks all its files, so the result is
+            // kept for loadKart. Karts in the metadata index are not loaded
+            // at startup.
+            IndexEntry &entry = m_index_entries[kart_dirs[i]];
+            entry.m_cached = MetadataIndex::get()->get(kart_dirs[i],
+                                                       &entry.m_version,
+                                                       &entry.m_fields);
+            if(!entry.m_cached)
+                job.m_dirs.push_back(kart_dirs[i]);
+        }
+    }   // for dir
+
+    job.m_roots.resize(job.m_dirs.size(), NULL);
+    job.m_files.resize(job.m_dirs.size());
+    WorkerPool::execute(&job, job.m_dirs.size());
+
+    for(unsigned int i=0; i<job.m_dirs.size(); i++)
+    {
+        if(!job.m_roots[i]) continue;
+        m_parsed_kart_files[job.m_dirs[i]] = job.m_roots[i];
+        const std::vector<std::string> &files = job.m_files[i];
+        for(unsigned int j=0; j<files.size(); j++)
+        {
+            const std::string ext = StringUtils::getExtension(files[j]);
+            if(ext=="png" || ext=="jpg")
+                images->push_back(files[j]);
+            else
+                prefetcher->add(files[j]);
+        }
+        std::set<std::string> result;
+        file_manager->listFiles(result, job.m_dirs[i], /*is_full_path*/ true);
+        for(std::set<std::string>::const_iterator f=result.begin();
+            f!=result.end(); f++)
+        {
+            const std::string ext = StringUtils::getExtension(*f);
+            if(ext=="png" || ext=="jpg")
+                images->push_back(job.m_dirs[i]+"/"+*f);
+        }
+    }
+}   // prefetchKartFiles
+
+//-----------------------------------------------------------------------------
+/** Loads a single kart (see loadKart) and logs the time it took.
+ *  \param dir The directory of the kart.
+ */
+bool KartPropertiesManager::loadKartTimed(const std::string &dir)
+{
+    const double start = StkTime::getRealTime();
+    const bool loaded  = loadKart(dir);
+    if(loaded)
+        Log::verbose("Kart_Properties_Manager", "Loaded kart '%s' in %.3fs.",
+                     m_karts_properties[m_karts_properties.size()-1]
+                         .getIdent().c_str(),
+                     StkTime::getRealTime()-start);
+    return loaded;
+}   // loadKartTimed
+
+//-----------------------------------------------------------------------------
+/** Loads all kart properties and models. Karts which are unchanged since
+ *  the last run are created from the metadata index, and their files are
+ *  only loaded when they are needed (see loadKart).
+ *  Loading a kart creates Irrlicht meshes and textures, which can only be
+ *  done in the main thread (irrlicht's mesh loaders create the textures of
+ *  a mesh while parsing it). But the kart.xml files of all karts are parsed
+ *  in parallel, their models are read by a background thread, so that the
+ *  main thread doesn't have to wait for the disk for each kart, and the
+ *  images of all karts are decoded in parallel before the karts are
+ *  loaded.
  */
 void KartPropertiesManager::loadAllKarts(bool loading_icon)
 {
+    const double start = StkTime::getRealTime();
+    FilePrefetcher prefetcher;
+    std::vector<std::string> images;
+    prefetchKartFiles(&prefetcher, &images);
+    std::vector<video::ITexture*> textures;
+    irr_driver->preloadTextures(images, &textures);
+
     m_all_kart_dirs.clear();
     std::vector<std::string>::const_iterator dir;
     for(dir = m_kart_search_path.begin(); dir!=m_kart_search_path.end(); dir++)
     {
         // First check if there is a kart in the current directory
         // -------------------------------------------------------
-        if(loadKart(*dir)) continue;
+        if(loadKartTimed(*dir)) continue;
 
         // If not, check each subdir of this directory.
         // --------------------------------------------
@@ -170,7 +332,7 @@ void KartPropertiesManager::loadAllKarts(bool loading_icon)
         for(std::set<std::string>::const_iterator subdir=result.begin();
             subdir!=result.end(); subdir++)
         {
-            const bool loaded = loadKart(*dir+*subdir);
+            const bool loaded = loadKartTimed(*dir+*subdir);
 
             if (loaded && loading_icon)
             {
@@ -181,6 +343,22 @@ void KartPropertiesManager::loadAllKarts(bool loading_icon)
             }
         }   // for all files in the currently handled directory
     }   // for i
+
+    // The textures of the karts are never freed, so the preloaded textures
+    // are not removed from the texture cache (even if a texture is not
+    // used, e.g. the minimap icon is used without grabbing it).
+    for(unsigned int i=0; i<textures.size(); i++)
+        textures[i]->drop();
+
+    // Kart files which were parsed, but not used (which should not happen)
+    std::map<std::string, XMLNode*>::iterator i;
+    for(i=m_parsed_kart_files.begin(); i!=m_parsed_kart_files.end(); i++)
+        delete i->second;
+    m_parsed_kart_files.clear();
+    m_index_entries.clear();
+
+    Log::info("Kart_Properties_Manager", "Loaded %d karts in %.3fs.",
+              m_karts_properties.size(), StkTime::getRealTime()-start);
 }   // loadAllKarts
 
 //-----------------------------------------------------------------------------
@@ -193,17 +371,66 @@ bool KartPropertiesManager::loadKart(const std::string &dir)
     if(!file_manager->fileExists(config_filename))
     	return false;
 
+    // Don't load the kart (and its models) again if it could not be used
+    // in a previous run, and no file in its directory was modified since
+    // then. A usable kart is created from the cached fields, and its
+    // kart.xml file and models are only loaded when the kart is needed.
+    int version;
+    MetadataIndex::Fields fields;
+    bool cached;
+    std::map<std::string, IndexEntry>::iterator entry =
+                                                   m_index_entries.find(dir);
+    if(entry!=m_index_entries.end())
+    {
+        // Already looked up by prefetchKartFiles
+        cached  = entry->second.m_cached;
+        version = entry->second.m_version;
+        fields.swap(entry->second.m_fields);
+        m_index_entries.erase(entry);
+    }
+    else
+        cached = MetadataIndex::get()->get(dir, &version, &fields);
+    if(cached &&
+       (version==MetadataIndex::LOAD_FAILED                     ||
+        version<stk_config->m_min_kart_version                  ||
+        version>stk_config->m_max_kart_version                    ) )
+    {
+        Log::verbose("Kart_Properties_Manager",
+                     "Skipping unusable kart '%s'.", dir.c_str());
+        return false;
+    }
+
+    // Use the kart.xml file if it was already parsed by prefetchKartFiles
+    XMLNode *root = NULL;
+    std::map<std::string, XMLNode*>::iterator parsed =
+                                               m_parsed_kart_files.find(dir);
+    if(parsed!=m_parsed_kart_files.end())
+    {
+        root = parsed->second;
+        m_parsed_kart_files.erase(parsed);
+    }
+
     KartProperties* kart_properties;
     try
     {
-        kart_properties = new KartProperties(config_filename);
+        kart_properties = new KartProperties(config_filename,
+                                             cached ? &fields : NULL, root);
     }
     catch (std::runtime_error& err)
     {
+        delete root;
         std::cerr << "Giving up loading '" << config_filename.c_str()
                   << "' : " << err.what() << std::endl;
+        MetadataIndex::get()->set(dir, MetadataIndex::LOAD_FAILED);
         return false;
     }
+    delete root;
+    if(!cached)
+    {
+        fields.clear();
+        kart_properties->getMetadata(&fields);
+        MetadataIndex::get()->set(dir, kart_properties->getVersion(), fields);
+    }
 
     // If the version of the kart file is not supported,
     // ignore this .kart file
@@ -250,8 +477,51 @@ const int KartPropertiesManager::getKartId(const std::string &ident) const
 }   // getKartId
 
 //-----------------------------------------------------------------------------
+/** Returns the kart with the given identifier, or NULL if it does not
+ *  exist. The data of a kart created from the metadata index must have been
+ *  loaded (see loadKartData), use getKartMetadata if only the ident, name,
+ *  icon file, groups, version or directory of the kart are needed.
+ *  \param ident Identifier of the kart.
+ */
 const KartProperties* KartPropertiesManager::getKart(
                                                 const std::string &ident) const
+{
+    const KartProperties *kp = getKartMetadata(ident);
+    assert(!kp || kp->isLoaded());
+    return kp;
+}   // getKart
+
+//-----------------------------------------------------------------------------
+/** Returns the kart with the given index, see getKart.
+ *  \param i Index of the kart.
+ */
+const KartProperties* KartPropertiesManager::getKartById(int i) const
+{
+    const KartProperties *kp = getKartMetadataById(i);
+    assert(!kp || kp->isLoaded());
+    return kp;
+}   // getKartById
+
+//-----------------------------------------------------------------------------
+/** Returns a kart without loading its data if it was created from the
+ *  metadata index. Only the ident, name, icon file, groups, version and
+ *  directory of the returned kart can be used.
+ *  \param i Index of the kart.
+ */
+const KartProperties* KartPropertiesManager::getKartMetadataById(int i) const
+{
+    if (i < 0 || i >= int(m_karts_properties.size()))
+        return NULL;
+
+    return m_karts_properties.get(i);
+}   // getKartMetadataById
+
+//-----------------------------------------------------------------------------
+/** Returns a kart without loading its data, see getKartMetadataById.
+ *  \param ident Identifier of the kart.
+ */
+const KartProperties* KartPropertiesManager::getKartMetadata(
+                                                const std::string &ident) const
 {
     const KartProperties* kp;
     for_in (kp, m_karts_properties)
@@ -261,16 +531,44 @@ const KartProperties* KartPropertiesManager::getKart(
     }
 
     return NULL;
-}   // getKart
+}   // getKartMetadata
 
 //-----------------------------------------------------------------------------
-const KartProperties* KartPropertiesManager::getKartById(int i) const
+/** Loads the data (the kart.xml file and the models) of a kart which was
+ *  created from the metadata index, so that it can be used in a race or
+ *  shown in the menus. Loading adds the shared materials of the kart, so
+ *  this must not be done while the temporary materials of a track are
+ *  loaded (see RaceManager::startNextRace). If the kart can't be loaded,
+ *  it is marked as unusable in the metadata index (so it is skipped in
+ *  the next run), and as unavailable in this run.
+ *  \param ident Identifier of the kart.
+ *  \return True if the kart exists and its data is loaded.
+ */
+bool KartPropertiesManager::loadKartData(const std::string &ident)
 {
-    if (i < 0 || i >= int(m_karts_properties.size()))
-        return NULL;
-
-    return m_karts_properties.get(i);
-}   // getKartById
+    for (int i=0; i<m_karts_properties.size(); i++)
+    {
+        KartProperties *kp = m_karts_properties.get(i);
+        if (kp->getIdent() != ident) continue;
+        if (kp->isLoaded()) return true;
+        if (!m_kart_available[i]) return false;
+        try
+        {
+            kp->loadData();
+        }
+        catch (std::runtime_error& err)
+        {
+            Log::error("Kart_Properties_Manager",
+                       "Can't load kart '%s': %s", ident.c_str(), err.what());
+            MetadataIndex::get()->set(m_all_kart_dirs[i],
+                                      MetadataIndex::LOAD_FAILED);
+            m_kart_available[i] = false;
+            return false;
+        }
+        return true;
+    }
+    return false;
+}   // loadKartData
 
 //-----------------------------------------------------------------------------
 /** Returns a list of all available kart identifiers.                        */
@@ -351,7 +649,7 @@ bool KartPropertiesManager::kartAvailable(int kartid)
     {
         if ( kartid == *it) return false;
     }
-    const KartProperties *kartprop = getKartById(kartid);
+    const KartProperties *kartprop = getKartMetadataById(kartid);
     if(unlock_manager->getCurrentSlot()->isLocked(kartprop->getIdent())) return false;
     return true;
 }   // kartAvailable
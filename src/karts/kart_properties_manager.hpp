@@ -22,12 +22,15 @@
 #include "utils/ptr_vector.hpp"
 #include <map>
 
+#include "io/metadata_index.hpp"
 #include "network/remote_kart_info.hpp"
 #include "utils/no_copy.hpp"
 
 #define ALL_KART_GROUPS_ID  "all"
 
+class FilePrefetcher;
 class KartProperties;
+class XMLNode;
 
 /**
   * \ingroup karts
@@ -57,6 +60,27 @@ private:
      *  all clients or not. */
     std::vector<bool>        m_kart_available;
 
+    /** The kart.xml files parsed by prefetchKartFiles, indexed by the
+     *  kart directory. Each is removed when the kart is loaded. */
+    std::map<std::string, XMLNode*> m_parsed_kart_files;
+
+    /** The entry of a kart directory in the metadata index. */
+    struct IndexEntry
+    {
+        /** True if the directory is in the metadata index. */
+        bool                  m_cached;
+        int                   m_version;
+        MetadataIndex::Fields m_fields;
+    };   // IndexEntry
+
+    /** The kart directories looked up by prefetchKartFiles, indexed by
+     *  the kart directory. Each is removed when the kart is loaded. */
+    std::map<std::string, IndexEntry> m_index_entries;
+
+    void prefetchKartFiles(FilePrefetcher *prefetcher,
+                           std::vector<std::string> *images);
+    bool loadKartTimed(const std::string &dir);
+
 protected:
 
     typedef PtrVector<KartProperties> KartPropertiesVector;
@@ -69,6 +93,9 @@ public:
     static void              addKartSearchDir       (const std::string &s);
     const KartProperties*    getKartById            (int i) const;
     const KartProperties*    getKart(const std::string &ident) const;
+    const KartProperties*    getKartMetadataById    (int i) const;
+    const KartProperties*    getKartMetadata(const std::string &ident) const;
+    bool                     loadKartData(const std::string &ident);
     const int                getKartId(const std::string &ident) const;
     int                      getKartByGroup(const std::string& group,
                                            int i) const;
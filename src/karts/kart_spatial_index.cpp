@@ -0,0 +1,286 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2013 Joerg Henrichs
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#include "karts/kart_spatial_index.hpp"
+
+#include "karts/abstract_kart.hpp"
+#include "karts/kart_properties.hpp"
+#include "utils/vec3.hpp"
+
+#include <algorithm>
+#include <math.h>
+
+/** Minimum size of a grid cell. */
+static const float MIN_CELL_SIZE = 16.0f;
+
+/** Maximum number of cells, large tracks will use bigger cells. */
+static const int   MAX_CELLS     = 1024;
+
+/** Karts move between two updates of the index. This is the maximum
+ *  distance a kart is expected to move in one world update, all spatial
+ *  queries are extended by this distance. */
+static const float MAX_MOVEMENT  = 5.0f;
+
+// ----------------------------------------------------------------------------
+KartSpatialIndex::KartSpatialIndex()
+{
+    m_min_x     = m_min_z = 0;
+    m_cell_size = MIN_CELL_SIZE;
+    m_num_x     = m_num_z = 0;
+    m_max_slipstream_reach = 0;
+}   // KartSpatialIndex
+
+// ----------------------------------------------------------------------------
+/** Rebuilds the index from the current kart positions. This is called once
+ *  per world update (after the karts were updated).
+ *  \param karts All karts of the world.
+ */
+void KartSpatialIndex::update(const std::vector<AbstractKart*> &karts)
+{
+    m_karts.clear();
+    m_max_slipstream_reach = 0;
+
+    float max_x = 0, max_z = 0;
+    for(unsigned int i=0; i<karts.size(); i++)
+    {
+        AbstractKart *kart = karts[i];
+        if(kart->isEliminated()) continue;
+
+        const Vec3 &xyz = kart->getXYZ();
+        if(m_karts.size()==0 || xyz.getX()<m_min_x) m_min_x = xyz.getX();
+        if(m_karts.size()==0 || xyz.getZ()<m_min_z) m_min_z = xyz.getZ();
+        if(m_karts.size()==0 || xyz.getX()>max_x  ) max_x   = xyz.getX();
+        if(m_karts.size()==0 || xyz.getZ()>max_z  ) max_z   = xyz.getZ();
+        m_karts.push_back(kart);
+        m_max_slipstream_reach =
+            std::max(m_max_slipstream_reach,
+                     kart->getKartProperties()->getSlipstreamLength()
+                     + 0.5f*kart->getKartLength());
+    }
+
+    if(m_karts.size()==0)
+    {
+        m_num_x = m_num_z = 0;
+        m_cell_start.clear();
+        m_cell_content.clear();
+        return;
+    }
+
+    m_cell_size = MIN_CELL_SIZE;
+    float cells = (max_x-m_min_x)*(max_z-m_min_z) / (m_cell_size*m_cell_size);
+    if(cells > MAX_CELLS)
+        m_cell_size *= sqrtf(cells/MAX_CELLS);
+    m_num_x = (int)((max_x-m_min_x)/m_cell_size)+1;
+    m_num_z = (int)((max_z-m_min_z)/m_cell_size)+1;
+
+    // Counting sort of the karts into the cells, which keeps the karts
+    // in each cell sorted by kart id.
+    m_cell_start.clear();
+    m_cell_start.resize(m_num_x*m_num_z+1, 0);
+    for(unsigned int i=0; i<m_karts.size(); i++)
+    {
+        const Vec3 &xyz = m_karts[i]->getXYZ();
+        m_cell_start[getCellZ(xyz.getZ())*m_num_x+getCellX(xyz.getX())+1]++;
+    }
+    for(unsigned int i=1; i<m_cell_start.size(); i++)
+        m_cell_start[i] += m_cell_start[i-1];
+
+    std::vector<unsigned int> next(m_cell_start.begin(),
+                                   m_cell_start.end()-1);
+    m_cell_content.resize(m_karts.size());
+    for(unsigned int i=0; i<m_karts.size(); i++)
+    {
+        const Vec3 &xyz = m_karts[i]->getXYZ();
+        const int n = getCellZ(xyz.getZ())*m_num_x + getCellX(xyz.getX());
+        m_cell_content[next[n]++] = i;
+    }
+}   // update
+
+// ----------------------------------------------------------------------------
+/** Returns the (clamped) cell index in X direction of a coordinate. */
+int KartSpatialIndex::getCellX(float x) const
+{
+    int n = (int)floorf((x-m_min_x)/m_cell_size);
+    return n<0 ? 0 : (n>=m_num_x ? m_num_x-1 : n);
+}   // getCellX
+
+// ----------------------------------------------------------------------------
+/** Returns the (clamped) cell index in Z direction of a coordinate. */
+int KartSpatialIndex::getCellZ(float z) const
+{
+    int n = (int)floorf((z-m_min_z)/m_cell_size);
+    return n<0 ? 0 : (n>=m_num_z ? m_num_z-1 : n);
+}   // getCellZ
+
+// ----------------------------------------------------------------------------
+/** Finds all karts that are (in the XZ plane) not further away than the
+ *  given radius from a point. The karts are returned sorted by kart id,
+ *  i.e. in the same order as looping over all karts of the world.
+ *  \param xyz The point.
+ *  \param radius The maximum distance.
+ *  \param karts On return contains the karts found.
+ */
+void KartSpatialIndex::getKartsInRadius(const Vec3 &xyz, float radius,
+                                        std::vector<AbstractKart*> *karts)
+                                        const
+{
+    karts->clear();
+    if(m_karts.size()==0) return;
+
+    const float r = radius + MAX_MOVEMENT;
+    const int min_x = getCellX(xyz.getX()-r), max_x = getCellX(xyz.getX()+r);
+    const int min_z = getCellZ(xyz.getZ()-r), max_z = getCellZ(xyz.getZ()+r);
+
+    std::vector<unsigned int> found;
+    for(int z=min_z; z<=max_z; z++)
+    {
+        for(int x=min_x; x<=max_x; x++)
+        {
+            const int n = z*m_num_x + x;
+            for(unsigned int i=m_cell_start[n]; i<m_cell_start[n+1]; i++)
+            {
+                const unsigned int k = m_cell_content[i];
+                if((m_karts[k]->getXYZ()-xyz).length2_2d() <= radius*radius)
+                    found.push_back(k);
+            }
+        }   // for x
+    }   // for z
+
+    std::sort(found.begin(), found.end());
+    for(unsigned int i=0; i<found.size(); i++)
+        karts->push_back(m_karts[found[i]]);
+}   // getKartsInRadius
+
+// ----------------------------------------------------------------------------
+/** Finds the closest kart to a point. The cells are searched in rings
+ *  around the cell containing the point, until no kart outside of the
+ *  searched rings can be closer than the best kart found. If several karts
+ *  have the same distance, the one with the lowest kart id is returned
+ *  (same as looping over all karts).
+ *  \param xyz The point.
+ *  \param distance Defines which karts are considered, and the distance
+ *         used to compare them.
+ *  \param max_distance Only karts which are (in the XZ plane) not further
+ *         away than this distance are searched.
+ *  \param distance2 On return the distance of the closest kart as
+ *         computed by the distance function (undefined if no kart was
+ *         found).
+ *  \return The closest kart, or NULL if no kart was found.
+ */
+AbstractKart *KartSpatialIndex::getClosestKart(const Vec3 &xyz,
+                                               const DistanceFunction &distance,
+                                               float max_distance,
+                                               float *distance2) const
+{
+    if(m_karts.size()==0) return NULL;
+
+    const int cx = getCellX(xyz.getX());
+    const int cz = getCellZ(xyz.getZ());
+    const int max_ring = std::max(std::max(cx, m_num_x-1-cx),
+                                  std::max(cz, m_num_z-1-cz));
+    int   best = -1;
+    float best_distance2 = 0;
+    for(int ring=0; ring<=max_ring; ring++)
+    {
+        for(int z=cz-ring; z<=cz+ring; z++)
+        {
+            if(z<0 || z>=m_num_z) continue;
+            // Only visit the border cells of the ring
+            const int step = (z==cz-ring || z==cz+ring) ? 1 : 2*ring;
+            for(int x=cx-ring; x<=cx+ring; x+=step)
+            {
+                if(x<0 || x>=m_num_x) continue;
+                const int n = z*m_num_x + x;
+                for(unsigned int i=m_cell_start[n]; i<m_cell_start[n+1]; i++)
+                {
+                    const int k = m_cell_content[i];
+                    const float d = distance.getDistance2(m_karts[k]);
+                    if(d<0) continue;
+                    if(best==-1 || d<best_distance2 ||
+                       (d==best_distance2 && k<best))
+                    {
+                        best           = k;
+                        best_distance2 = d;
+                    }
+                }   // for i in cell
+            }   // for x
+        }   // for z
+
+        // All karts in cells outside of this ring are at least this far
+        // away (considering the movement since the index was built):
+        const float min_distance = ring*m_cell_size - MAX_MOVEMENT;
+        if(min_distance > max_distance) break;
+        if(best!=-1 && min_distance>0 &&
+           min_distance*min_distance > best_distance2)
+            break;
+    }   // for ring
+
+    if(best==-1) return NULL;
+    *distance2 = best_distance2;
+    return m_karts[best];
+}   // getClosestKart
+
+// ----------------------------------------------------------------------------
+/** Sets the order of the racing karts along the driveline. This is called
+ *  by LinearWorld each time the race positions are computed.
+ *  \param karts The karts that are still racing, sorted by the overall
+ *         distance along the driveline (the leading kart first).
+ *  \param num_karts Number of karts in the world.
+ */
+void KartSpatialIndex::setDrivelineOrder(const std::vector<AbstractKart*> &karts,
+                                         unsigned int num_karts)
+{
+    m_driveline_karts = karts;
+    m_driveline_index.clear();
+    m_driveline_index.resize(num_karts, -1);
+    for(unsigned int i=0; i<karts.size(); i++)
+        m_driveline_index[karts[i]->getWorldKartId()] = i;
+}   // setDrivelineOrder
+
+// ----------------------------------------------------------------------------
+/** Returns the n-th racing kart ahead of a kart along the driveline (as
+ *  it was when the race positions were last computed), or NULL if there is
+ *  no such kart or the kart is not racing (e.g. has finished the race).
+ *  \param kart The kart.
+ *  \param n 1 for the kart directly ahead, 2 for the kart ahead of that ...
+ */
+AbstractKart *KartSpatialIndex::getKartAhead(const AbstractKart *kart,
+                                             unsigned int n) const
+{
+    const unsigned int id = kart->getWorldKartId();
+    if(id>=m_driveline_index.size() || m_driveline_index[id]<(int)n)
+        return NULL;
+    return m_driveline_karts[m_driveline_index[id]-n];
+}   // getKartAhead
+
+// ----------------------------------------------------------------------------
+/** Returns the n-th racing kart behind a kart along the driveline (as it
+ *  was when the race positions were last computed), or NULL if there is no
+ *  such kart or the kart is not racing (e.g. has finished the race).
+ *  \param kart The kart.
+ *  \param n 1 for the kart directly behind, 2 for the kart behind that ...
+ */
+AbstractKart *KartSpatialIndex::getKartBehind(const AbstractKart *kart,
+                                              unsigned int n) const
+{
+    const unsigned int id = kart->getWorldKartId();
+    if(id>=m_driveline_index.size() || m_driveline_index[id]<0 ||
+       m_driveline_index[id]+n >= m_driveline_karts.size())
+        return NULL;
+    return m_driveline_karts[m_driveline_index[id]+n];
+}   // getKartBehind
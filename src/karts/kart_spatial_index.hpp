@@ -0,0 +1,126 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2013 Joerg Henrichs
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#ifndef HEADER_KART_SPATIAL_INDEX_HPP
+#define HEADER_KART_SPATIAL_INDEX_HPP
+
+#include "utils/no_copy.hpp"
+
+#include <vector>
+
+class AbstractKart;
+class Vec3;
+
+/**
+ *  \brief A spatial index of all karts that are not eliminated, rebuilt
+ *  once per world update.
+ *  The karts are sorted into a uniform 2d grid (XZ plane) that covers all
+ *  karts. This allows the items and the slipstream to find close karts
+ *  without looping over all karts each time.
+ *  Since karts keep on moving after the index was built (until it is
+ *  rebuilt in the next world update), all spatial queries are extended by
+ *  a small safety margin, and the callers must always test the actual
+ *  kart position. The margin only covers the movement of a kart driving,
+ *  so the index must be rebuilt when a kart is moved to a different
+ *  place (see World::moveKartTo).
+ *  In a linear world the index also keeps the karts that are still racing
+ *  sorted along the driveline (set by LinearWorld::updateRacePosition when
+ *  the race positions are computed), to find the karts ahead and behind a
+ *  kart.
+ * \ingroup karts
+ */
+class KartSpatialIndex : public NoCopy
+{
+public:
+    /** Interface used by getClosestKart to select and compare karts. */
+    class DistanceFunction
+    {
+    public:
+        virtual ~DistanceFunction() {}
+        /** Returns the (squared) distance of a kart used to find the
+         *  closest kart, or a negative value if the kart should be
+         *  ignored. The value must never be smaller than the squared
+         *  distance in the XZ plane to the query point. */
+        virtual float getDistance2(const AbstractKart *kart) const = 0;
+    };   // DistanceFunction
+
+private:
+    /** Minimum X and Z coordinate covered by the grid. */
+    float m_min_x, m_min_z;
+
+    /** Size of a (square) cell. */
+    float m_cell_size;
+
+    /** Number of cells in X and Z direction. */
+    int   m_num_x, m_num_z;
+
+    /** All indexed karts, sorted by kart id. */
+    std::vector<AbstractKart*> m_karts;
+
+    /** Index of the first entry in m_cell_content for each cell. */
+    std::vector<unsigned int>  m_cell_start;
+
+    /** Index (in m_karts) of the karts in each cell, sorted by kart id
+     *  in each cell. */
+    std::vector<unsigned int>  m_cell_content;
+
+    /** The maximum over all karts of slipstream length plus half the
+     *  kart length, i.e. how far a kart can be behind another kart and
+     *  still be in its slipstream. */
+    float m_max_slipstream_reach;
+
+    /** The karts that are still racing, sorted by the overall distance
+     *  along the driveline (the leading kart first). */
+    std::vector<AbstractKart*> m_driveline_karts;
+
+    /** For each kart (indexed by world kart id) the index in
+     *  m_driveline_karts, or -1 if the kart is not racing. */
+    std::vector<int>           m_driveline_index;
+
+    int  getCellX(float x) const;
+    int  getCellZ(float z) const;
+
+public:
+                  KartSpatialIndex();
+    void          update(const std::vector<AbstractKart*> &karts);
+    void          getKartsInRadius(const Vec3 &xyz, float radius,
+                                   std::vector<AbstractKart*> *karts) const;
+    AbstractKart *getClosestKart(const Vec3 &xyz,
+                                 const DistanceFunction &distance,
+                                 float max_distance,
+                                 float *distance2) const;
+    void          setDrivelineOrder(const std::vector<AbstractKart*> &karts,
+                                    unsigned int num_karts);
+    AbstractKart *getKartAhead(const AbstractKart *kart,
+                               unsigned int n=1) const;
+    AbstractKart *getKartBehind(const AbstractKart *kart,
+                                unsigned int n=1) const;
+    // ------------------------------------------------------------------------
+    /** Returns the racing kart that is furthest along the driveline, or
+     *  NULL if no kart is racing. */
+    AbstractKart *getLeadingKart() const
+    {
+        return m_driveline_karts.empty() ? NULL : m_driveline_karts[0];
+    }   // getLeadingKart
+    // ------------------------------------------------------------------------
+    /** Returns how far behind a kart another kart can be and still be in
+     *  its slipstream (not including the length of the kart behind). */
+    float getMaxSlipstreamReach() const { return m_max_slipstream_reach; }
+};   // KartSpatialIndex
+
+#endif
@@ -117,14 +117,26 @@ void Moveable::stopFlying()
 }
 
 //-----------------------------------------------------------------------------
-/** Updates the current position and rotation from the corresponding physics
- *  body, and then calls updateGraphics to position the model correctly.
- *  \param float dt Time step size.
+/** Returns the transform of the physics body, i.e. the transform this
+ *  moveable takes in the next call of updatePosition. This only reads
+ *  data, so it can be called from a worker thread.
+ *  \param trans On return the transform of the physics body.
  */
-void Moveable::update(float dt)
+void Moveable::getPhysicsTrans(btTransform *trans) const
 {
     if(m_body->getInvMass()!=0)
-        m_motion_state->getWorldTransform(m_transform);
+        m_motion_state->getWorldTransform(*trans);
+    else
+        *trans = m_transform;
+}   // getPhysicsTrans
+
+//-----------------------------------------------------------------------------
+/** Updates the current position and rotation from the corresponding physics
+ *  body. This does not change the graphical model, see update.
+ */
+void Moveable::updatePosition()
+{
+    getPhysicsTrans(&m_transform);
     m_velocityLC  = getVelocity()*m_transform.getBasis();
     Vec3 forw_vec = m_transform.getBasis().getColumn(0);
     m_heading     = -atan2f(forw_vec.getZ(), forw_vec.getX());
@@ -135,7 +147,16 @@ void Moveable::update(float dt)
     Vec3 up       = getTrans().getBasis().getColumn(1);
     m_pitch       = atan2(up.getZ(), fabsf(up.getY()));
     m_roll        = atan2(up.getX(), up.getY());
+}   // updatePosition
 
+//-----------------------------------------------------------------------------
+/** Updates the current position and rotation from the corresponding physics
+ *  body, and then calls updateGraphics to position the model correctly.
+ *  \param float dt Time step size.
+ */
+void Moveable::update(float dt)
+{
+    updatePosition();
     updateGraphics(dt, Vec3(0,0,0), btQuaternion(0, 0, 0, 1));
 }   // update
 
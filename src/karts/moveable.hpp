@@ -103,6 +103,8 @@ public:
                                  const btQuaternion& off_rotation);
     virtual void  reset();
     virtual void  update(float dt) ;
+    void          updatePosition();
+    void          getPhysicsTrans(btTransform *trans) const;
     btRigidBody  *getBody() const {return m_body; }
     void          createBody(float mass, btTransform& trans,
                              btCollisionShape *shape,
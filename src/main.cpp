@@ -143,6 +143,7 @@
 #include "addons/inetwork_http.hpp"
 #include "addons/news_manager.hpp"
 #include "audio/music_manager.hpp"
+#include "audio/sfx_buffer.hpp"
 #include "audio/sfx_manager.hpp"
 #include "challenges/unlock_manager.hpp"
 #include "config/stk_config.hpp"
@@ -151,14 +152,17 @@
 #include "graphics/hardware_skinning.hpp"
 #include "graphics/irr_driver.hpp"
 #include "graphics/material_manager.hpp"
+#include "graphics/particle_emitter.hpp"
 #include "graphics/particle_kind_manager.hpp"
 #include "graphics/referee.hpp"
+#include "graphics/texture_cache.hpp"
 #include "guiengine/engine.hpp"
 #include "guiengine/event_handler.hpp"
 #include "input/input_manager.hpp"
 #include "input/device_manager.hpp"
 #include "input/wiimote_manager.hpp"
 #include "io/file_manager.hpp"
+#include "io/metadata_index.hpp"
 #include "items/attachment_manager.hpp"
 #include "items/item_manager.hpp"
 #include "items/projectile_manager.hpp"
@@ -166,6 +170,7 @@
 #include "karts/kart_properties.hpp"
 #include "karts/kart_properties_manager.hpp"
 #include "modes/demo_world.hpp"
+#include "modes/profile_batch.hpp"
 #include "modes/profile_world.hpp"
 #include "network/network_manager.hpp"
 #include "race/grand_prix_manager.hpp"
@@ -183,6 +188,7 @@
 #include "utils/leak_check.hpp"
 #include "utils/log.hpp"
 #include "utils/translation.hpp"
+#include "utils/worker_pool.hpp"
 
 static void cleanSuperTuxKart();
 
@@ -390,6 +396,15 @@ void cmdLineHelp (char* invocation)
     "       --profile-time=n   Enable automatic driven profile mode for n "
                               "seconds.\n"
     "       --no-graphics      Do not display the actual race.\n"
+    "       --profile-batch FILE Run all AI races listed in FILE in parallel\n"
+    "                          without graphics (implies --no-graphics).\n"
+    "       --profile-jobs=n   Maximum number of races to run at the same "
+                              "time\n"
+    "                          in batch profiling (default: number of cores).\n"
+    "       --profile-report FILE Write the batch profiling statistics to "
+                              "FILE.\n"
+    "       --profile-particles Measure the time of the particle affectors "
+                              "and exit.\n"
     "       --demo-mode t      Enables demo mode after t seconds idle time in "
                                "main menu.\n"
     "       --demo-tracks t1,t2 List of tracks to be used in demo mode. No\n"
@@ -518,6 +533,19 @@ int handleCmdLinePreliminary(int argc, char **argv)
             ProfileWorld::disableGraphics();
             UserConfigParams::m_log_errors_to_console=true;
         }
+        else if( !strcmp(argv[i], "--profile-batch") && i+1<argc )
+        {
+            // The worker processes are forked, which can't be done
+            // with an active graphics context.
+            ProfileWorld::disableGraphics();
+            UserConfigParams::m_log_errors_to_console=true;
+            i++;
+        }
+        else if( !strcmp(argv[i], "--profile-particles") )
+        {
+            ProfileWorld::disableGraphics();
+            UserConfigParams::m_log_errors_to_console=true;
+        }
 #if !defined(WIN32) && !defined(__CYGWIN)
         else if ( !strcmp(argv[i], "--fullscreen") || !strcmp(argv[i], "-f"))
         {
@@ -651,7 +679,9 @@ int handleCmdLine(int argc, char **argv)
                 i<kart_properties_manager->getNumberOfKarts(); i++)
             {
                 const KartProperties *km =
-                    kart_properties_manager->getKartById(i);
+                    kart_properties_manager->getKartMetadataById(i);
+                if(!kart_properties_manager->loadKartData(km->getIdent()))
+                    continue;
                  Log::info("main", "%s:\t%swidth: %f length: %f height: %f "
                                    "mesh-buffer count %d",
                         km->getIdent().c_str(),
@@ -737,7 +767,7 @@ int handleCmdLine(int argc, char **argv)
             if (!unlock_manager->getCurrentSlot()->isLocked(argv[i+1]))
             {
                 const KartProperties *prop =
-                    kart_properties_manager->getKart(argv[i+1]);
+                    kart_properties_manager->getKartMetadata(argv[i+1]);
                 if(prop)
                 {
                     UserConfigParams::m_default_kart = argv[i+1];
@@ -920,7 +950,7 @@ int handleCmdLine(int argc, char **argv)
                  i < kart_properties_manager->getNumberOfKarts(); i++)
             {
                 const KartProperties* KP =
-                    kart_properties_manager->getKartById(i);
+                    kart_properties_manager->getKartMetadataById(i);
                 unlock_manager->setCurrentSlot(UserConfigParams::m_all_players[0]
                                               .getUniqueID()                    );
                 const char * locked = "";
@@ -981,6 +1011,34 @@ int handleCmdLine(int argc, char **argv)
             ProfileWorld::setProfileModeTime((float)n);
             race_manager->setNumLaps(999999); // profile end depends on time
         }
+        else if( !strcmp(argv[i], "--profile-batch") && i+1<argc )
+        {
+            if(!ProfileBatch::loadManifest(argv[i+1]))
+                return 0;
+            UserConfigParams::m_no_start_screen = true;
+            // The actual number of laps is set for each race.
+            ProfileWorld::setProfileModeLaps(1);
+            i++;
+        }
+        else if( sscanf(argv[i], "--profile-jobs=%d",  &n)==1)
+        {
+            if (n < 0)
+            {
+                Log::error("main", "Invalid number of profile-jobs: %i.\n", n );
+                return 0;
+            }
+            ProfileBatch::setMaxProcesses(n);
+        }
+        else if( !strcmp(argv[i], "--profile-particles") )
+        {
+            ParticleEmitter::profileAffectors();
+            return 0;
+        }
+        else if( !strcmp(argv[i], "--profile-report") && i+1<argc )
+        {
+            ProfileBatch::setReportFile(argv[i+1]);
+            i++;
+        }
         else if( !strcmp(argv[i], "--no-graphics") )
         {
             // Set default profile mode of 1 lap if we haven't already set one
@@ -1153,6 +1211,8 @@ void initRest()
 
     GUIEngine::init(device, driver, StateManager::get());
 
+    WorkerPool::create();
+
     // This only initialises the non-network part of the addons manager. The
     // online section of the addons manager will be initialised from a
     // separate thread running in network http.
@@ -1184,6 +1244,8 @@ void initRest()
     track_manager->addTrackSearchDir(
                  file_manager->getAddonsFile("tracks/"));
 
+    MetadataIndex::create(file_manager->getConfigDir()
+                          +"/metadata_index.xml");
     track_manager->loadTrackList();
     music_manager->addMusicToTracks();
 
@@ -1234,12 +1296,19 @@ static void cleanSuperTuxKart()
     if(projectile_manager)      delete projectile_manager;
     if(kart_properties_manager) delete kart_properties_manager;
     if(track_manager)           delete track_manager;
+    MetadataIndex::destroy();
+    if(file_manager)
+    {
+        TextureCache::removeStaleFiles();
+        SFXBuffer::removeStaleCacheFiles();
+    }
     if(material_manager)        delete material_manager;
     if(history)                 delete history;
     ReplayRecorder::destroy();
     if(sfx_manager)             delete sfx_manager;
     if(music_manager)           delete music_manager;
     delete ParticleKindManager::get();
+    WorkerPool::destroy();
     if(stk_config)              delete stk_config;
 
 #ifndef WIN32
@@ -1330,6 +1399,8 @@ int main(int argc, char *argv[] )
         GUIEngine::addLoadingIcon( irr_driver->getTexture(
                            file_manager->getGUIDir() + "options_video.png") );
         kart_properties_manager -> loadAllKarts    ();
+        // All karts and tracks are scanned now, save the updated index
+        MetadataIndex::get()->save();
         unlock_manager          = new UnlockManager();
         //m_tutorial_manager      = new TutorialManager();
         GUIEngine::addLoadingIcon( irr_driver->getTexture(
@@ -1444,7 +1515,7 @@ int main(int argc, char *argv[] )
             StateManager::get()->createActivePlayer(
                     UserConfigParams::m_all_players.get(0), device );
 
-            if (kart_properties_manager->getKart(UserConfigParams::m_default_kart) == NULL)
+            if (kart_properties_manager->getKartMetadata(UserConfigParams::m_default_kart) == NULL)
             {
                 Log::warn("main", "Kart '%s' is unknown so will use the "
                           "default kart.",
@@ -1525,8 +1596,18 @@ int main(int argc, char *argv[] )
             // =========
             race_manager->setMajorMode (RaceManager::MAJOR_MODE_SINGLE);
             race_manager->setDifficulty(RaceManager::DIFFICULTY_HARD);
-            network_manager->setupPlayerKartInfo();
-            race_manager->startNew(false);
+            if(ProfileBatch::isBatchMode())
+            {
+                // Each race is run (and the main loop executed) in its
+                // own worker process.
+                ProfileBatch::run();
+                main_loop->abort();
+            }
+            else
+            {
+                network_manager->setupPlayerKartInfo();
+                race_manager->startNew(false);
+            }
         }
         main_loop->run();
 
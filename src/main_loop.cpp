@@ -21,6 +21,7 @@
 #include <assert.h>
 
 #include "audio/music_manager.hpp"
+#include "audio/sfx_manager.hpp"
 #include "config/user_config.hpp"
 #include "graphics/irr_driver.hpp"
 #include "graphics/material_manager.hpp"
@@ -148,6 +149,10 @@ void MainLoop::run()
             music_manager->update(dt);
             PROFILER_POP_CPU_MARKER();
 
+            PROFILER_PUSH_CPU_MARKER("SFX manager update", 0x7F, 0x00, 0x7F);
+            sfx_manager->update(dt);
+            PROFILER_POP_CPU_MARKER();
+
             PROFILER_PUSH_CPU_MARKER("Input manager update", 0x00, 0x7F, 0x00);
             input_manager->update(dt);
             PROFILER_POP_CPU_MARKER();
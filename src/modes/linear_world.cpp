@@ -17,6 +17,7 @@
 
 #include "modes/linear_world.hpp"
 
+#include <algorithm>
 #include <iostream>
 
 #include "audio/music_manager.hpp"
@@ -25,6 +26,7 @@
 #include "karts/abstract_kart.hpp"
 #include "karts/controller/controller.hpp"
 #include "karts/kart_properties.hpp"
+#include "karts/kart_spatial_index.hpp"
 #include "network/network_manager.hpp"
 #include "physics/physics.hpp"
 #include "race/history.hpp"
@@ -34,6 +36,7 @@
 #include "utils/constants.hpp"
 #include "utils/string_utils.hpp"
 #include "utils/translation.hpp"
+#include "utils/worker_pool.hpp"
 
 //-----------------------------------------------------------------------------
 /** Constructs the linear world. Note that here no functions can be called
@@ -163,20 +166,19 @@ void LinearWorld::update(float dt)
 
     // Do stuff specific to this subtype of race.
     // ------------------------------------------
-    for(unsigned int n=0; n<kart_amount; n++)
+    // ========================================================================
+    /** Updates the track sectors of all karts in parallel. */
+    class TrackSectorJob : public WorkerPool::Job
     {
-        KartInfo& kart_info = m_kart_info[n];
-        AbstractKart* kart = m_karts[n];
-
-        // Nothing to do for karts that are currently being
-        // rescued or eliminated
-        if(kart->getKartAnimation()) continue;
-
-        kart_info.getTrackSector()->update(kart->getXYZ());
-        kart_info.m_overall_distance = kart_info.m_race_lap
-                                     * m_track->getTrackLength()
-                        + getDistanceDownTrackForKart(kart->getWorldKartId());
-    }   // for n
+    private:
+        LinearWorld *m_world;
+    public:
+        TrackSectorJob(LinearWorld *world) : m_world(world) {}
+        virtual void run(unsigned int n) { m_world->updateTrackSector(n); }
+    };   // TrackSectorJob
+    // ========================================================================
+    TrackSectorJob job(this);
+    WorkerPool::execute(&job, kart_amount);
 
     // Update all positions. This must be done after _all_ karts have
     // updated their position and laps etc, otherwise inconsistencies
@@ -227,6 +229,26 @@ void LinearWorld::update(float dt)
 #endif
 }   // update
 
+//-----------------------------------------------------------------------------
+/** Updates the track sector and overall distance of a kart. This is called
+ *  for all karts in parallel, so it must only modify data of this kart.
+ *  \param n Index of the kart.
+ */
+void LinearWorld::updateTrackSector(unsigned int n)
+{
+    KartInfo& kart_info = m_kart_info[n];
+    AbstractKart* kart = m_karts[n];
+
+    // Nothing to do for karts that are currently being
+    // rescued or eliminated
+    if(kart->getKartAnimation()) return;
+
+    kart_info.getTrackSector()->update(kart->getXYZ());
+    kart_info.m_overall_distance = kart_info.m_race_lap
+                                 * m_track->getTrackLength()
+                    + getDistanceDownTrackForKart(kart->getWorldKartId());
+}   // updateTrackSector
+
 //-----------------------------------------------------------------------------
 /** Is called by check structures if a kart starts a new lap.
  *  \param kart_index Index of the kart.
@@ -638,9 +660,10 @@ btTransform LinearWorld::getRescueTransform(unsigned int index) const
 }   // getRescueTransform
 
 //-----------------------------------------------------------------------------
-/** Find the position (rank) of every kart. ATM it uses a stable O(n^2)
- *  algorithm by counting for each kart how many other karts are ahead of
- *  it.
+/** Find the position (rank) of every kart. The karts that are still racing
+ *  are sorted by overall distance (and start position for equal distances),
+ *  which gives the same result as counting for each kart how many other
+ *  karts are ahead of it, but only needs O(n log n) time.
  */
 void LinearWorld::updateRacePosition()
 {
@@ -652,9 +675,42 @@ void LinearWorld::updateRacePosition()
     bool rank_changed = false;
 #endif
 
-    // NOTE: if you do any changes to this loop, the next loop (see
-    // DEBUG_KART_RANK below) needs to have the same changes applied
-    // so that debug output is still correct!!!!!!!!!!!
+    // A kart that has neither finished nor is eliminated is behind all
+    // karts that have finished the race (and are not eliminated), and
+    // behind all other racing karts that have covered a larger overall
+    // distance, or the same distance (very unlikely) but started earlier.
+    // So sort all racing karts by distance and start position, then
+    // the position is the number of finished karts plus the index in
+    // the sorted list plus 1.
+    std::vector<RankInfo> racing;
+    racing.reserve(kart_amount);
+    unsigned int num_finished = 0;
+    for (unsigned int i=0; i<kart_amount; i++)
+    {
+        const AbstractKart *kart = m_karts[i];
+        if(kart->isEliminated()) continue;
+        if(kart->hasFinishedRace())
+        {
+            num_finished++;
+            continue;
+        }
+        RankInfo info;
+        info.m_distance         = m_kart_info[i].m_overall_distance;
+        info.m_initial_position = kart->getInitialPosition();
+        info.m_kart_id          = i;
+        racing.push_back(info);
+    }
+    std::sort(racing.begin(), racing.end());
+
+    std::vector<int> new_position(kart_amount, 0);
+    std::vector<AbstractKart*> driveline_karts(racing.size());
+    for (unsigned int i=0; i<racing.size(); i++)
+    {
+        new_position[racing[i].m_kart_id] = num_finished + i + 1;
+        driveline_karts[i] = m_karts[racing[i].m_kart_id];
+    }
+    m_kart_index->setDrivelineOrder(driveline_karts, kart_amount);
+
     for (unsigned int i=0; i<kart_amount; i++)
     {
         AbstractKart* kart = m_karts[i];
@@ -672,33 +728,7 @@ void LinearWorld::updateRacePosition()
         }
         KartInfo& kart_info = m_kart_info[i];
 
-        int p = 1 ;
-
-        const unsigned int my_id = kart->getWorldKartId();
-        const float my_distance  = m_kart_info[my_id].m_overall_distance;
-
-        // Count karts ahead of the current kart, i.e. kart that are
-        // already finished or have covered a larger overall distance.
-        for (unsigned int j = 0 ; j < kart_amount ; j++)
-        {
-            // don't compare a kart with itself and ignore eliminated karts
-            if(j == my_id || m_karts[j]->isEliminated())
-                continue;
-
-            // If the other kart has:
-            // - finished the race (but this kart hasn't)
-            // - or is ahead
-            // - or has the same distance (very unlikely) but started earlier
-            // it is ahead --> increase position
-            if((!kart->hasFinishedRace() && m_karts[j]->hasFinishedRace()) ||
-                m_kart_info[j].m_overall_distance > my_distance            ||
-               (m_kart_info[j].m_overall_distance == my_distance &&
-                m_karts[j]->getInitialPosition()<kart->getInitialPosition() ) )
-            {
-                p++;
-            }
-
-        } //next kart
+        const int p = new_position[i];
 
 #ifndef DEBUG
         setKartPosition(i, p);
@@ -750,7 +780,8 @@ void LinearWorld::updateRacePosition()
     }   // for i<kart_amount
 
     // Define this to get a detailled analyses each time a race position
-    // changes.
+    // changes. It also compares the positions with the result of counting
+    // the karts ahead of each kart.
 #ifdef DEBUG
 #undef DEBUG_KART_RANK
 #ifdef DEBUG_KART_RANK
@@ -760,57 +791,30 @@ void LinearWorld::updateRacePosition()
         for (unsigned int i=0; i<kart_amount; i++)
         {
             AbstractKart* kart = m_karts[i];
-            std::cout << "counting karts ahead of " << kart->getIdent()
+            std::cout << "position " << kart->getPosition()
+                << " " << kart->getIdent()
                 << " (laps "           << m_kart_info[i].m_race_lap
                 << ", progress "       << m_kart_info[i].m_overall_distance
                 << " finished "        << kart->hasFinishedRace()
                 << " eliminated "      << kart->isEliminated()
                 << " initial position "<< kart->getInitialPosition()
                 << ").\n";
-            // Karts that are either eliminated or have finished the
-            // race already have their (final) position assigned. If
-            // these karts would get their rank updated, it could happen
-            // that a kart that finished first will be overtaken after
-            // crossing the finishing line and become second!
             if(kart->isEliminated() || kart->hasFinishedRace()) continue;
-            KartInfo& kart_info = m_kart_info[i];
-            int p = 1 ;
-            const int my_id         = kart->getWorldKartId();
-            const float my_distance = m_kart_info[my_id].m_overall_distance;
-
+            int p = 1;
+            const float my_distance = m_kart_info[i].m_overall_distance;
             for (unsigned int j = 0 ; j < kart_amount ; j++)
             {
-                if(j == my_id) continue;
-                if(m_karts[j]->isEliminated())
-                {
-                    std::cout << "    " << p << " : " << m_karts[j]->getIdent()
-                              << " because it is eliminated.\n";
-                    continue;
-                }
-                if(!kart->hasFinishedRace() && m_karts[j]->hasFinishedRace())
-                {
-                    p++;
-                    std::cout << "    " << p << " : " << m_karts[j]->getIdent()
-                              << " because it has finished the race.\n";
-                    continue;
-                }
-                if(m_kart_info[j].m_overall_distance > my_distance)
-                {
+                if(j == i || m_karts[j]->isEliminated()) continue;
+                if(m_karts[j]->hasFinishedRace()                      ||
+                   m_kart_info[j].m_overall_distance > my_distance    ||
+                   (m_kart_info[j].m_overall_distance == my_distance &&
+                    m_karts[j]->getInitialPosition()
+                                       < kart->getInitialPosition()  )  )
                     p++;
-                    std::cout << "    " << p << " : " << m_karts[j]->getIdent()
-                        << " because it is ahead "
-                        << m_kart_info[j].m_overall_distance <<".\n";
-                    continue;
-                }
-                if(m_kart_info[j].m_overall_distance == my_distance &&
-                   m_karts[j]->getInitialPosition()<kart->getInitialPosition())
-                {
-                    p++;
-                    std::cout << "    " << p << " : " << m_karts[j]->getIdent()
-                        << " has same distance, but started ahead "
-                        << m_karts[j]->getInitialPosition()<<".\n";
-                }
             }   // next kart j
+            if(p!=kart->getPosition())
+                std::cout << "    --> counting karts ahead gives position "
+                          << p << "!\n";
         }   // for i<kart_amount
         std::cout << "-------------------------------------------\n";
     }   // if rank_changed
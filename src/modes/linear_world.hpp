@@ -102,6 +102,23 @@ private:
         const TrackSector *getTrackSector() const {return &m_track_sector; }
     };
     // ------------------------------------------------------------------------
+    /** The data used to sort the karts that are still racing in
+     *  updateRacePosition. */
+    struct RankInfo
+    {
+        float        m_distance;
+        int          m_initial_position;
+        unsigned int m_kart_id;
+        /** A kart is ahead (i.e. sorted first) if it has covered a larger
+         *  overall distance, or the same distance but started earlier. */
+        bool operator<(const RankInfo &other) const
+        {
+            if(m_distance != other.m_distance)
+                return m_distance > other.m_distance;
+            return m_initial_position < other.m_initial_position;
+        }   // operator<
+    };   // RankInfo
+    // ------------------------------------------------------------------------
 
 protected:
 
@@ -112,7 +129,8 @@ protected:
     AlignedArray<KartInfo> m_kart_info;
 
     virtual void  checkForWrongDirection(unsigned int i);
-    void          updateRacePosition();
+    void          updateTrackSector(unsigned int n);
+    virtual void  updateRacePosition();
     virtual float estimateFinishTimeForKart(AbstractKart* kart) OVERRIDE;
 
 public:
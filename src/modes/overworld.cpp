@@ -66,7 +66,7 @@ void OverWorld::enterOverWorld()
     StateManager::get()->createActivePlayer(unlock_manager->getCurrentPlayer(),
                                             device);
 
-    if (!kart_properties_manager->getKart(UserConfigParams::m_default_kart))
+    if (!kart_properties_manager->getKartMetadata(UserConfigParams::m_default_kart))
     {
         Log::warn("overworld", "cannot find kart '%s', "
                   "will revert to default\n",
@@ -0,0 +1,311 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2013 Joerg Henrichs
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#include "modes/profile_batch.hpp"
+
+#include "main_loop.hpp"
+#include "graphics/irr_driver.hpp"
+#include "io/file_manager.hpp"
+#include "io/xml_node.hpp"
+#include "modes/profile_world.hpp"
+#include "network/network_manager.hpp"
+#include "tracks/track_manager.hpp"
+#include "utils/log.hpp"
+#include "utils/string_utils.hpp"
+
+#include <exception>
+#include <map>
+#include <sstream>
+#include <stdio.h>
+#include <stdlib.h>
+
+#ifndef WIN32
+#  include <sys/types.h>
+#  include <sys/wait.h>
+#  include <unistd.h>
+#endif
+
+std::string                    ProfileBatch::m_manifest_file;
+std::string                    ProfileBatch::m_report_file;
+int                            ProfileBatch::m_max_processes = 0;
+std::vector<ProfileBatch::Job> ProfileBatch::m_jobs;
+
+//-----------------------------------------------------------------------------
+/** Reads the list of races to run from the manifest file. Invalid entries
+ *  (e.g. unknown tracks) are reported and skipped.
+ *  \param filename Name of the manifest file.
+ *  \return True if at least one race was found.
+ */
+bool ProfileBatch::loadManifest(const std::string &filename)
+{
+    const XMLNode *root = file_manager->createXMLTree(filename);
+    if(!root || root->getName()!="profile-batch")
+    {
+        Log::error("ProfileBatch", "Can't read manifest '%s'.",
+                   filename.c_str());
+        if(root) delete root;
+        return false;
+    }
+
+    m_jobs.clear();
+    for(unsigned int i=0; i<root->getNumNodes(); i++)
+    {
+        const XMLNode *node = root->getNode(i);
+        if(node->getName()!="race")
+        {
+            Log::warn("ProfileBatch", "Unknown node '%s' in manifest - "
+                      "ignored.", node->getName().c_str());
+            continue;
+        }
+        Job job;
+        job.m_num_karts = 4;
+        job.m_laps      = 1;
+        job.m_seed      = 0;
+        job.m_reverse   = false;
+        int difficulty  = RaceManager::DIFFICULTY_HARD;
+        node->get("track",      &job.m_track     );
+        node->get("karts",      &job.m_karts     );
+        node->get("num-karts",  &job.m_num_karts );
+        node->get("laps",       &job.m_laps      );
+        node->get("difficulty", &difficulty      );
+        node->get("seed",       &job.m_seed      );
+        node->get("reverse",    &job.m_reverse   );
+
+        if(!track_manager->getTrack(job.m_track))
+        {
+            Log::error("ProfileBatch", "Race %d: unknown track '%s' - "
+                       "ignored.", i, job.m_track.c_str());
+            continue;
+        }
+        if(difficulty<RaceManager::DIFFICULTY_FIRST ||
+           difficulty>RaceManager::DIFFICULTY_LAST     )
+        {
+            Log::warn("ProfileBatch", "Race %d: invalid difficulty %d, "
+                      "using hard.", i, difficulty);
+            difficulty = RaceManager::DIFFICULTY_HARD;
+        }
+        job.m_difficulty = (RaceManager::Difficulty)difficulty;
+        if(job.m_num_karts < (int)job.m_karts.size())
+            job.m_num_karts = job.m_karts.size();
+        if(job.m_laps<1) job.m_laps = 1;
+        m_jobs.push_back(job);
+    }   // for i < getNumNodes
+    delete root;
+
+    if(m_jobs.size()==0)
+    {
+        Log::error("ProfileBatch", "No races found in '%s'.",
+                   filename.c_str());
+        return false;
+    }
+    m_manifest_file = filename;
+    if(m_report_file=="")
+        m_report_file = file_manager->getConfigDir()+"/profile-batch.csv";
+    return true;
+}   // loadManifest
+
+//-----------------------------------------------------------------------------
+/** Returns the name of the temporary report file for one race.
+ *  \param n Index of the race.
+ */
+std::string ProfileBatch::getJobReportFile(unsigned int n)
+{
+    return m_report_file+"."+StringUtils::toString(n);
+}   // getJobReportFile
+
+//-----------------------------------------------------------------------------
+/** Runs the race with the given index. This is called in the worker
+ *  process, and it will terminate the process once the race is finished.
+ *  \param n Index of the race to run.
+ */
+void ProfileBatch::runJob(unsigned int n)
+{
+    const Job &job = m_jobs[n];
+    FILE *report   = fopen(getJobReportFile(n).c_str(), "w");
+    if(!report)
+    {
+        Log::error("ProfileBatch", "Can't write '%s'.",
+                   getJobReportFile(n).c_str());
+        fflush(stdout);
+        _exit(1);
+    }
+
+    // Note that the threads of the worker pool are not copied by fork(),
+    // so all parallel parts of a race are executed in this process' main
+    // thread, which is what is wanted when several races run at the same
+    // time. The results are the same either way.
+
+    // All random numbers (including the random kart list) are based on
+    // rand(), so this makes a race reproducible.
+    srand(job.m_seed);
+
+    ProfileWorld::setProfileModeLaps(job.m_laps);
+    race_manager->setMajorMode (RaceManager::MAJOR_MODE_SINGLE);
+    race_manager->setMinorMode (RaceManager::MINOR_MODE_NORMAL_RACE);
+    race_manager->setDifficulty(job.m_difficulty);
+    race_manager->setTrack(job.m_track);
+    race_manager->setReverseTrack(job.m_reverse);
+    race_manager->setNumLaps(job.m_laps);
+    race_manager->setDefaultAIKartList(job.m_karts);
+    race_manager->setNumKarts(job.m_num_karts);
+
+    std::ostringstream prefix;
+    prefix << n << "," << job.m_track << "," << job.m_laps << ","
+           << job.m_difficulty << "," << job.m_seed << ",";
+    ProfileWorld::setReport(report, prefix.str());
+
+    // An exception must not unwind into main(), which would then execute
+    // the cleanup of the parent process in this process.
+    try
+    {
+        network_manager->setupPlayerKartInfo();
+        race_manager->startNew(false);
+        main_loop->run();
+    }
+    catch(std::exception &e)
+    {
+        Log::error("ProfileBatch", "Race %d aborted: %s", n, e.what());
+        fflush(stdout);
+        fflush(stderr);
+        _exit(1);
+    }
+    catch(...)
+    {
+        Log::error("ProfileBatch", "Race %d aborted: unknown exception.", n);
+        fflush(stdout);
+        fflush(stderr);
+        _exit(1);
+    }
+
+    fclose(report);
+    fflush(stdout);
+    fflush(stderr);
+    // Don't run any destructors or atexit handlers, they belong to the
+    // parent process.
+    _exit(0);
+}   // runJob
+
+//-----------------------------------------------------------------------------
+/** Concatenates the report files of all races into the final report, and
+ *  removes the temporary files.
+ *  \param success For each race if its worker process finished correctly.
+ */
+void ProfileBatch::mergeReports(const std::vector<bool> &success)
+{
+    FILE *report = fopen(m_report_file.c_str(), "w");
+    if(!report)
+    {
+        Log::error("ProfileBatch", "Can't write report '%s'.",
+                   m_report_file.c_str());
+        return;
+    }
+    fprintf(report, "job,track,laps,difficulty,seed,");
+    ProfileWorld::writeReportHeader(report);
+
+    char buffer[4096];
+    for(unsigned int i=0; i<m_jobs.size(); i++)
+    {
+        const std::string name = getJobReportFile(i);
+        FILE *f = fopen(name.c_str(), "r");
+        if(f)
+        {
+            size_t n;
+            while((n=fread(buffer, 1, sizeof(buffer), f))>0)
+                fwrite(buffer, 1, n, report);
+            fclose(f);
+            remove(name.c_str());
+        }
+        if(!success[i])
+            Log::error("ProfileBatch", "Race %d on '%s' did not finish "
+                       "correctly.", i, m_jobs[i].m_track.c_str());
+    }
+    fclose(report);
+    Log::info("ProfileBatch", "Report written to '%s'.",
+              m_report_file.c_str());
+}   // mergeReports
+
+//-----------------------------------------------------------------------------
+/** Runs all races from the manifest. A worker process is forked for each
+ *  race, so that the (copy-on-write) shared data does not need to be loaded
+ *  again, and each race starts from the same state. At most m_max_processes
+ *  races are run at the same time.
+ */
+void ProfileBatch::run()
+{
+#ifdef WIN32
+    Log::error("ProfileBatch", "Batch profiling is not supported on this "
+               "platform.");
+#else
+    unsigned int max_processes = m_max_processes;
+    if(max_processes==0)
+    {
+        long n = sysconf(_SC_NPROCESSORS_ONLN);
+        max_processes = n>0 ? (unsigned int)n : 1;
+    }
+    Log::info("ProfileBatch", "Running %d races with %d processes.",
+              (int)m_jobs.size(), max_processes);
+
+    // Make sure the workers don't inherit (and then flush) buffered output.
+    fflush(stdout);
+    fflush(stderr);
+
+    const unsigned int start_time = irr_driver->getRealTime();
+    std::vector<bool>          success(m_jobs.size(), false);
+    std::map<pid_t, unsigned int> running;
+    std::vector<unsigned int>  job_start(m_jobs.size(), 0);
+    unsigned int next_job = 0;
+    while(next_job<m_jobs.size() || running.size()>0)
+    {
+        while(next_job<m_jobs.size() && running.size()<max_processes)
+        {
+            pid_t pid = fork();
+            if(pid==0)
+                runJob(next_job);   // does not return
+            if(pid<0)
+            {
+                Log::error("ProfileBatch", "Can't fork worker for race %d.",
+                           next_job);
+            }
+            else
+            {
+                running[pid]        = next_job;
+                job_start[next_job] = irr_driver->getRealTime();
+            }
+            next_job++;
+        }   // while a worker can be started
+
+        if(running.size()==0) break;
+        int status;
+        pid_t pid = wait(&status);
+        if(pid<0) break;
+        std::map<pid_t, unsigned int>::iterator it = running.find(pid);
+        if(it==running.end()) continue;
+        const unsigned int job = it->second;
+        running.erase(it);
+        success[job] = WIFEXITED(status) && WEXITSTATUS(status)==0;
+        Log::verbose("ProfileBatch", "Race %d on '%s' took %f seconds.",
+                     job, m_jobs[job].m_track.c_str(),
+                     (irr_driver->getRealTime()-job_start[job])*0.001f);
+    }   // while jobs to do
+
+    float runtime = (irr_driver->getRealTime()-start_time)*0.001f;
+    Log::info("ProfileBatch", "%d races done in %f seconds.",
+              (int)m_jobs.size(), runtime);
+    mergeReports(success);
+#endif
+}   // run
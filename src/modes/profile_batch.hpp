@@ -0,0 +1,89 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2013 Joerg Henrichs
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#ifndef HEADER_PROFILE_BATCH_HPP
+#define HEADER_PROFILE_BATCH_HPP
+
+#include "race/race_manager.hpp"
+
+#include <string>
+#include <vector>
+
+/**
+ * \brief Runs a list of AI-only profile races in parallel.
+ *  The races are read from a manifest file of the form:
+ *  \code
+ *  <profile-batch>
+ *    <race track="lighthouse" karts="tux gnu" num-karts="8" laps="2"
+ *          difficulty="2" seed="1234" reverse="N"/>
+ *  </profile-batch>
+ *  \endcode
+ *  All shared data (tracks list, karts, materials, items) is loaded once
+ *  by the main process, which then forks one worker process per race
+ *  (up to a maximum number of concurrent workers). Each worker runs a
+ *  ProfileWorld with the fixed 1/60 time step and writes its statistics
+ *  to a temporary file, which are then merged (in manifest order) into
+ *  a single CSV report.
+ * \ingroup modes
+ */
+class ProfileBatch
+{
+private:
+    /** Description of one race to run. */
+    struct Job
+    {
+        std::string              m_track;
+        std::vector<std::string> m_karts;
+        int                      m_num_karts;
+        int                      m_laps;
+        RaceManager::Difficulty  m_difficulty;
+        int                      m_seed;
+        bool                     m_reverse;
+    };   // Job
+
+    /** Name of the manifest file, empty if batch mode is not used. */
+    static std::string      m_manifest_file;
+
+    /** Name of the report file to write. */
+    static std::string      m_report_file;
+
+    /** Maximum number of worker processes to run at the same time,
+     *  0 means number of cores. */
+    static int              m_max_processes;
+
+    /** List of all races read from the manifest. */
+    static std::vector<Job> m_jobs;
+
+    static std::string getJobReportFile(unsigned int n);
+    static void        runJob(unsigned int n);
+    static void        mergeReports(const std::vector<bool> &success);
+public:
+    static bool loadManifest(const std::string &filename);
+    static void run();
+    // ------------------------------------------------------------------------
+    /** Sets the name of the report file to create. */
+    static void setReportFile(const std::string &f) { m_report_file = f; }
+    // ------------------------------------------------------------------------
+    /** Sets the maximum number of races to run concurrently. */
+    static void setMaxProcesses(int n) { m_max_processes = n; }
+    // ------------------------------------------------------------------------
+    /** Returns true if a batch of races is to be run. */
+    static bool isBatchMode() { return m_manifest_file.size()>0; }
+};   // ProfileBatch
+
+#endif
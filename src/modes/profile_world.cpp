@@ -24,6 +24,7 @@
 #include "karts/kart_with_stats.hpp"
 #include "karts/controller/controller.hpp"
 #include "tracks/track.hpp"
+#include "utils/time.hpp"
 
 #include <ISceneManager.h>
 
@@ -31,6 +32,8 @@ ProfileWorld::ProfileType ProfileWorld::m_profile_mode=PROFILE_NONE;
 int   ProfileWorld::m_num_laps    = 0;
 float ProfileWorld::m_time        = 0.0f;
 bool  ProfileWorld::m_no_graphics = false;
+FILE *ProfileWorld::m_report      = NULL;
+std::string ProfileWorld::m_report_prefix;
 
 //-----------------------------------------------------------------------------
 /** The constructor sets the number of (local) players to 0, since only AI
@@ -53,6 +56,8 @@ ProfileWorld::ProfileWorld()
     m_num_transparent  = 0;
     m_num_trans_effect = 0;
     m_num_calls        = 0;
+    m_num_position_updates = 0;
+    m_position_update_time = 0;
 }   // ProfileWorld
 
 //-----------------------------------------------------------------------------
@@ -89,6 +94,20 @@ void ProfileWorld::setProfileModeLaps(int laps)
     m_num_laps     = laps;
 }   // setProfileModeLaps
 
+//-----------------------------------------------------------------------------
+/** Writes the column names of the statistics written to the report file.
+ *  \param f The file to write to.
+ */
+void ProfileWorld::writeReportHeader(FILE *f)
+{
+    fprintf(f, "frames,real_time,race_time,name,controller,start_position,"
+               "end_position,time,average_speed,top_speed,skid_time,"
+               "rescue_time,rescue_count,brake_count,explosion_time,"
+               "explosion_count,bonus_count,banana_count,small_nitro_count,"
+               "large_nitro_count,bubblegum_count,off_track_count,"
+               "num_karts,position_updates,position_update_us\n");
+}   // writeReportHeader
+
 //-----------------------------------------------------------------------------
 /** Creates a kart, having a certain position, starting location, and local
  *  and global player id (if applicable).
@@ -163,6 +182,18 @@ void ProfileWorld::update(float dt)
 
 }   // update
 
+//-----------------------------------------------------------------------------
+/** Measures the time used to compute the race positions, which depends on
+ *  the number of karts (e.g. run a profile batch with 8, 32 and 128 karts).
+ */
+void ProfileWorld::updateRacePosition()
+{
+    const double start = StkTime::getPreciseTimeMs();
+    StandardRace::updateRacePosition();
+    m_position_update_time += StkTime::getPreciseTimeMs() - start;
+    m_num_position_updates++;
+}   // updateRacePosition
+
 //-----------------------------------------------------------------------------
 /** This function is called when the race is finished, but end-of-race
  *  animations have still to be played. In the case of profiling,
@@ -200,6 +231,12 @@ void ProfileWorld::enterRaceOverState()
     printf("Number of frames: %d time %f, Average FPS: %f\n",
            m_frame_count, runtime, (float)m_frame_count/runtime);
 
+    // Average time to compute the race positions in microseconds
+    const double position_update_us = m_num_position_updates>0
+        ? m_position_update_time*1000.0/m_num_position_updates : 0;
+    printf("Race positions of %d karts: %d updates, average %f us\n",
+           (int)m_karts.size(), m_num_position_updates, position_update_us);
+
     // Print geometry statistics if we're not in no-graphics mode
     if(!m_no_graphics)
     {
@@ -246,6 +283,25 @@ void ProfileWorld::enterRaceOverState()
                kart->getBonusCount(), kart->getBananaCount(),
                kart->getSmallNitroCount(), kart->getLargeNitroCount(),
                kart->getBubblegumCount(), kart->getOffTrackCount() );
+        if(m_report)
+        {
+            fprintf(m_report, "%s%d,%f,%f,%s,%s,", m_report_prefix.c_str(),
+                    m_frame_count, runtime, getTime(),
+                    kart->getIdent().c_str(),
+                    kart->getController()->getControllerName().c_str());
+            fprintf(m_report, "%d,%d,%4.2f,%4.2f,%3.2f,%4.2f,%4.2f,%d,%d,"
+                    "%4.2f,%d,%d,%d,%d,%d,%d,%d,",
+                    1 + (int)i, kart->getPosition(), kart->getFinishTime(),
+                    distance/kart->getFinishTime(), kart->getTopSpeed(),
+                    kart->getSkiddingTime(), kart->getRescueTime(),
+                    kart->getRescueCount(), kart->getBrakeCount(),
+                    kart->getExplosionTime(), kart->getExplosionCount(),
+                    kart->getBonusCount(), kart->getBananaCount(),
+                    kart->getSmallNitroCount(), kart->getLargeNitroCount(),
+                    kart->getBubblegumCount(), kart->getOffTrackCount() );
+            fprintf(m_report, "%d,%d,%f\n", (int)m_karts.size(),
+                    m_num_position_updates, position_update_us);
+        }
     }
 
     // Print group statistics of all karts
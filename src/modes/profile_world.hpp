@@ -21,6 +21,9 @@
 
 #include "modes/standard_race.hpp"
 
+#include <stdio.h>
+#include <string>
+
 class Kart;
 
 /**
@@ -43,6 +46,13 @@ private:
     /** In time based profiling only: time to run. */
     static float m_time;
 
+    /** If not NULL, machine readable statistics for each kart are written
+     *  to this file at the end of the race. */
+    static FILE *m_report;
+
+    /** A string written at the start of each line of the report. */
+    static std::string m_report_prefix;
+
     /** Return value of real time at start of race. */
     unsigned int m_start_time;
 
@@ -67,6 +77,12 @@ private:
     /** Number of calls to draw. */
     long long    m_num_calls;
 
+    /** Number of times the race positions were computed. */
+    int          m_num_position_updates;
+
+    /** Total time (in ms) used to compute the race positions. */
+    double       m_position_update_time;
+
 protected:
     /** In laps based profiling: number of laps to run. Also
      *  used by DemoWorld. */
@@ -75,6 +91,7 @@ protected:
     virtual AbstractKart *createKart(const std::string &kart_ident, int index,
                                      int local_player_id, int global_player_id,
                                      RaceManager::KartType type);
+    virtual void          updateRacePosition();
 
 public:
                           ProfileWorld();
@@ -87,6 +104,17 @@ public:
 
     static   void setProfileModeTime(float time);
     static   void setProfileModeLaps(int laps);
+    static   void writeReportHeader(FILE *f);
+    // ------------------------------------------------------------------------
+    /** Sets a file to which the kart statistics are written (as comma
+     *  separated values) at the end of the race.
+     *  \param f The file to write to.
+     *  \param prefix String to print at the start of each line. */
+    static   void setReport(FILE *f, const std::string &prefix)
+    {
+        m_report        = f;
+        m_report_prefix = prefix;
+    }   // setReport
     // ------------------------------------------------------------------------
     /** Returns true if profile mode was selected. */
     static   bool isProfileMode() {return m_profile_mode!=PROFILE_NONE; }
@@ -28,6 +28,7 @@
 #include "karts/kart.hpp"
 #include "karts/kart_model.hpp"
 #include "karts/kart_properties.hpp"
+#include "karts/kart_spatial_index.hpp"
 #include "karts/rescue_animation.hpp"
 #include "karts/controller/player_controller.hpp"
 #include "physics/physics.hpp"
@@ -300,6 +301,9 @@ void SoccerWorld::moveKartAfterRescue(AbstractKart* kart)
         fprintf(stderr, "WARNING: invalid position after rescue for kart %s on track %s.\n",
                 (kart->getIdent().c_str()), m_track->getIdent().c_str());
     }
+
+    // The index only allows for karts moving a small distance
+    m_kart_index->update(m_karts);
 }   // moveKartAfterRescue
 
 //-----------------------------------------------------------------------------/** Set position and team for the karts */
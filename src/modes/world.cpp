@@ -40,6 +40,7 @@
 #include "karts/controller/skidding_ai.hpp"
 #include "karts/kart.hpp"
 #include "karts/kart_properties_manager.hpp"
+#include "karts/kart_spatial_index.hpp"
 #include "modes/overworld.hpp"
 #include "modes/profile_world.hpp"
 #include "network/network_manager.hpp"
@@ -62,6 +63,7 @@
 #include "tracks/track_manager.hpp"
 #include "utils/constants.hpp"
 #include "utils/profiler.hpp"
+#include "utils/worker_pool.hpp"
 #include "utils/translation.hpp"
 #include "utils/string_utils.hpp"
 
@@ -109,6 +111,7 @@ World::World() : WorldStatus(), m_clear_color(255,100,101,140)
 #endif
 
     m_physics            = NULL;
+    m_kart_index         = NULL;
     m_race_gui           = NULL;
     m_saved_race_gui     = NULL;
     m_use_highscores     = true;
@@ -159,7 +162,8 @@ void World::init()
     }
 
     // Create the physics
-    m_physics = new Physics();
+    m_physics    = new Physics();
+    m_kart_index = new KartSpatialIndex();
 
     unsigned int num_karts = race_manager->getNumberOfKarts();
     //assert(num_karts > 0);
@@ -182,10 +186,16 @@ void World::init()
         m_track->adjustForFog(newkart->getNode());
 
     }  // for i
+    m_kart_index->update(m_karts);
 
     // Must be called after all karts are created
     m_race_gui->init();
 
+    // Sound effects are loaded when they are used for the first time. Load
+    // the sounds marked for preloading in the sfx config (e.g. of the items)
+    // now, so that their first use in the race does not have to wait.
+    sfx_manager->preloadRaceSfx();
+
     if(ReplayPlay::get())
         ReplayPlay::get()->Load();
 
@@ -233,6 +243,7 @@ void World::reset()
         ReplayPlay::get()->reset();
 
     resetAllKarts();
+    m_kart_index->update(m_karts);
     // Note: track reset must be called after all karts exist, since check
     // objects need to allocate data structures depending on the number
     // of karts.
@@ -387,6 +398,8 @@ World::~World()
     // In case that the track is not found, m_physics is still undefined.
     if(m_physics)
         delete m_physics;
+    if(m_kart_index)
+        delete m_kart_index;
 
     music_manager->stopMusic();
     m_world = NULL;
@@ -653,6 +666,8 @@ void World::moveKartTo(AbstractKart* kart, const btTransform &transform)
     // This will set the physics transform 
     m_track->findGround(kart);
 
+    // The index only allows for karts moving a small distance
+    m_kart_index->update(m_karts);
 }   // moveKartTo
 
 // ----------------------------------------------------------------------------
@@ -753,7 +768,7 @@ void World::updateWorld(float dt)
                     ->createActivePlayer(unlock_manager->getCurrentPlayer(),
                                          device);
 
-                if (!kart_properties_manager->getKart(UserConfigParams::m_default_kart))
+                if (!kart_properties_manager->getKartMetadata(UserConfigParams::m_default_kart))
                 {
                     Log::warn("World", 
                               "Cannot find kart '%s', will revert to default.",
@@ -831,12 +846,43 @@ void World::update(float dt)
         m_physics->update(dt);
     }
 
+    // ========================================================================
+    /** Casts the terrain rays of all karts in parallel. */
+    class TerrainPredictionJob : public WorkerPool::Job
+    {
+    private:
+        const KartList &m_karts;
+    public:
+        TerrainPredictionJob(const KartList &karts) : m_karts(karts) {}
+        // --------------------------------------------------------------------
+        virtual void run(unsigned int i)
+        {
+            if(!m_karts[i]->isEliminated())
+                m_karts[i]->predictTerrainInfo();
+        }   // run
+    };   // TerrainPredictionJob
+    // ========================================================================
+
+    // The karts are updated one after another, since a kart update changes
+    // shared state (items, projectiles, other karts, scene nodes, ...) and
+    // the AI depends on the karts updated before it. Only the terrain
+    // raycast of each kart, which only reads the physics state of the kart
+    // and the track mesh, is done in advance in parallel. A kart only uses
+    // this result if it is still at the predicted position, so the result
+    // is the same as without prediction.
+    PROFILER_PUSH_CPU_MARKER("World::update terrain", 0x00, 0x7F, 0x7F);
+    TerrainPredictionJob terrain_job(m_karts);
+    WorkerPool::execute(&terrain_job, m_karts.size());
+    PROFILER_POP_CPU_MARKER();
+
     const int kart_amount = m_karts.size();
     for (int i = 0 ; i < kart_amount; ++i)
     {
         // Update all karts that are not eliminated
         if(!m_karts[i]->isEliminated()) m_karts[i]->update(dt) ;
     }
+    // All proximity queries (items, slipstream, ...) use this index
+    m_kart_index->update(m_karts);
 
     for(unsigned int i=0; i<Camera::getNumCameras(); i++)
     {
@@ -38,6 +38,7 @@
 class AbstractKart;
 class btRigidBody;
 class Controller;
+class KartSpatialIndex;
 class PhysicalObject;
 class Physics;
 class Track;
@@ -84,6 +85,9 @@ protected:
     RandomGenerator           m_random;
 
     Physics*      m_physics;
+
+    /** Spatial index of all karts, rebuilt once per update. */
+    KartSpatialIndex *m_kart_index;
     AbstractKart* m_fastest_kart;
     /** Number of eliminated karts. */
     int         m_eliminated_karts;
@@ -293,6 +297,10 @@ public:
     /** Returns a pointer to the physics. */
     Physics        *getPhysics() const { return m_physics; }
     // ------------------------------------------------------------------------
+    /** Returns the spatial index of all karts, used to quickly find close
+     *  karts or the karts ahead and behind a kart along the driveline. */
+    const KartSpatialIndex *getKartIndex() const { return m_kart_index; }
+    // ------------------------------------------------------------------------
     /** Returns a pointer to the track. */
     Track          *getTrack() const { return m_track; }
     // ------------------------------------------------------------------------
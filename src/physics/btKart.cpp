@@ -36,7 +36,7 @@ btRigidBody& btKart::getFixedBody()
 }
 
 // ============================================================================
-btKart::btKart(btRigidBody* chassis, btVehicleRaycaster* raycaster,
+btKart::btKart(btRigidBody* chassis, btKartRaycaster* raycaster,
                Kart *kart)
       : m_vehicleRaycaster(raycaster)
 {
@@ -209,12 +209,35 @@ void btKart::updateWheelTransformsWS(btWheelInfo& wheel,
 }   // updateWheelTransformsWS
 
 // ----------------------------------------------------------------------------
-btScalar btKart::rayCast(btWheelInfo& wheel)
+/** Computes the world space ray for the suspension of a wheel.
+ *  \param wheel The wheel.
+ *  \param from On return the start point of the ray.
+ *  \param to On return the end point of the ray.
+ */
+void btKart::getWheelRay(btWheelInfo &wheel, btVector3 *from, btVector3 *to)
+{
+    updateWheelTransformsWS( wheel,false);
+
+    btScalar raylen = wheel.getSuspensionRestLength()+wheel.m_wheelsRadius
+                    + wheel.m_maxSuspensionTravelCm*0.01f;
+
+    btVector3 rayvector = wheel.m_raycastInfo.m_wheelDirectionWS * (raylen);
+    const btVector3& source = wheel.m_raycastInfo.m_hardPointWS;
+    wheel.m_raycastInfo.m_contactPointWS = source + rayvector;
+    *from = source;
+    *to   = wheel.m_raycastInfo.m_contactPointWS;
+}   // getWheelRay
+
+// ----------------------------------------------------------------------------
+/** Work around a bullet problem: when using a convex hull the raycast
+ *  would sometimes hit the chassis (which does not happen when using a
+ *  box shape). Therefore set the collision mask in the chassis body so
+ *  that it is not hit anymore.
+ *  \return The old collision filter group, which must be restored
+ *          by calling restoreChassisFilter.
+ */
+short int btKart::disableChassisFilter()
 {
-    // Work around a bullet problem: when using a convex hull the raycast
-    // would sometimes hit the chassis (which does not happen when using a
-    // box shape). Therefore set the collision mask in the chassis body so
-    // that it is not hit anymore.
     short int old_group=0;
     if(m_chassisBody->getBroadphaseHandle())
     {
@@ -222,27 +245,91 @@ btScalar btKart::rayCast(btWheelInfo& wheel)
                                  ->m_collisionFilterGroup;
         m_chassisBody->getBroadphaseHandle()->m_collisionFilterGroup = 0;
     }
+    return old_group;
+}   // disableChassisFilter
 
-    updateWheelTransformsWS( wheel,false);
+// ----------------------------------------------------------------------------
+/** Restores the collision filter group of the chassis.
+ *  \param old_group The value returned from disableChassisFilter.
+ */
+void btKart::restoreChassisFilter(short int old_group)
+{
+    if(m_chassisBody->getBroadphaseHandle())
+    {
+        m_chassisBody->getBroadphaseHandle()->m_collisionFilterGroup
+            = old_group;
+    }
+}   // restoreChassisFilter
 
+// ----------------------------------------------------------------------------
+btScalar btKart::rayCast(btWheelInfo& wheel)
+{
+    short int old_group = disableChassisFilter();
 
-    btScalar depth = -1;
+    btVector3 source, target;
+    getWheelRay(wheel, &source, &target);
 
-    btScalar raylen = wheel.getSuspensionRestLength()+wheel.m_wheelsRadius
-                    + wheel.m_maxSuspensionTravelCm*0.01f;
+    btVehicleRaycaster::btVehicleRaycasterResult rayResults;
 
-    btVector3 rayvector = wheel.m_raycastInfo.m_wheelDirectionWS * (raylen);
-    const btVector3& source = wheel.m_raycastInfo.m_hardPointWS;
-    wheel.m_raycastInfo.m_contactPointWS = source + rayvector;
-    const btVector3& target = wheel.m_raycastInfo.m_contactPointWS;
+    btAssert(m_vehicleRaycaster);
 
-    btScalar param = btScalar(0.);
+    void* object = m_vehicleRaycaster->castRay(source,target,rayResults);
+    btScalar depth = updateWheelContact(wheel, object, rayResults);
 
-    btVehicleRaycaster::btVehicleRaycasterResult rayResults;
+    restoreChassisFilter(old_group);
+    return depth;
+}   // rayCast
+
+// ----------------------------------------------------------------------------
+/** Casts the suspension rays of all wheels at the same time (which allows
+ *  the raycaster to traverse the track mesh only once for all wheels),
+ *  and updates the contact information of all wheels.
+ */
+void btKart::rayCastAllWheels()
+{
+    const int num_wheels = m_wheelInfo.size();
+    if(num_wheels > MAX_WHEELS)
+    {
+        for(int i=0; i<num_wheels; i++)
+            rayCast(m_wheelInfo[i]);
+        return;
+    }
+
+    short int old_group = disableChassisFilter();
+
+    btVector3 from[MAX_WHEELS], to[MAX_WHEELS];
+    for(int i=0; i<num_wheels; i++)
+        getWheelRay(m_wheelInfo[i], &from[i], &to[i]);
+
+    btVehicleRaycaster::btVehicleRaycasterResult results[MAX_WHEELS];
+    void *objects[MAX_WHEELS];
 
     btAssert(m_vehicleRaycaster);
+    m_vehicleRaycaster->castRays(num_wheels, from, to, results, objects);
 
-    void* object = m_vehicleRaycaster->castRay(source,target,rayResults);
+    for(int i=0; i<num_wheels; i++)
+        updateWheelContact(m_wheelInfo[i], objects[i], results[i]);
+
+    restoreChassisFilter(old_group);
+}   // rayCastAllWheels
+
+// ----------------------------------------------------------------------------
+/** Updates the suspension and contact information of a wheel after its
+ *  suspension ray was cast (see getWheelRay).
+ *  \param wheel The wheel.
+ *  \param object The object hit by the ray, or NULL if nothing was hit.
+ *  \param rayResults The result of the raycast.
+ *  \return The distance to the hit point, or -1 if nothing was hit.
+ */
+btScalar btKart::updateWheelContact(btWheelInfo &wheel, void *object,
+                  const btVehicleRaycaster::btVehicleRaycasterResult &rayResults)
+{
+    btScalar depth = -1;
+
+    btScalar raylen = wheel.getSuspensionRestLength()+wheel.m_wheelsRadius
+                    + wheel.m_maxSuspensionTravelCm*0.01f;
+
+    btScalar param = btScalar(0.);
 
     wheel.m_raycastInfo.m_groundObject = 0;
 
@@ -311,13 +398,8 @@ btScalar btKart::rayCast(btWheelInfo& wheel)
         wheel.m_clippedInvContactDotSuspension = btScalar(1.0);
     }
 
-    if(m_chassisBody->getBroadphaseHandle())
-    {
-        m_chassisBody->getBroadphaseHandle()->m_collisionFilterGroup
-            = old_group;
-    }
     return depth;
-}   // rayCast
+}   // updateWheelContact
 
 // ----------------------------------------------------------------------------
 const btTransform& btKart::getChassisWorldTransform() const
@@ -343,10 +425,9 @@ void btKart::updateVehicle( btScalar step )
     // -------------------
 
     m_num_wheels_on_ground = 0;
+    rayCastAllWheels();
     for (int i=0;i<m_wheelInfo.size();i++)
     {
-        btScalar depth;
-        depth = rayCast( m_wheelInfo[i]);
         if(m_wheelInfo[i].m_raycastInfo.m_isInContact)
             m_num_wheels_on_ground++;
     }
@@ -67,7 +67,7 @@ private:
     btScalar calcRollingFriction(btWheelContactPoint& contactPoint);
 
     btScalar            m_damping;
-    btVehicleRaycaster *m_vehicleRaycaster;
+    btKartRaycaster    *m_vehicleRaycaster;
 
     /** True if a zipper is active for that kart. */
     bool                m_zipper_active;
@@ -124,8 +124,17 @@ private:
 
     btAlignedObjectArray<btWheelInfo> m_wheelInfo;
 
+    /** Maximum number of wheels whose rays are cast together. */
+    static const int    MAX_WHEELS = 4;
+
     void     defaultInit();
     btScalar rayCast(btWheelInfo& wheel, const btVector3& ray);
+    void     getWheelRay(btWheelInfo &wheel, btVector3 *from, btVector3 *to);
+    short int disableChassisFilter();
+    void     restoreChassisFilter(short int old_group);
+    void     rayCastAllWheels();
+    btScalar updateWheelContact(btWheelInfo &wheel, void *object,
+                  const btVehicleRaycaster::btVehicleRaycasterResult &result);
 
 public:
 
@@ -136,7 +145,7 @@ public:
      *         (this is used to get access to the kart properties).
      */
                        btKart(btRigidBody* chassis,
-                              btVehicleRaycaster* raycaster,
+                              btKartRaycaster* raycaster,
                               Kart *kart);
      virtual          ~btKart();
     void               reset();
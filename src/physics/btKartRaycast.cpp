@@ -19,78 +19,181 @@
 #include "physics/triangle_mesh.hpp"
 #include "tracks/track.hpp"
 
-void* btKartRaycaster::castRay(const btVector3& from, const btVector3& to,
-                               btVehicleRaycasterResult& result)
+// ============================================================================
+/** A closest hit raycast callback that also stores the index of the triangle
+ *  hit. Optionally one object (the track) can be ignored, which is used
+ *  in castRays, where the track is tested separately.
+ */
+class ClosestWithNormal : public btCollisionWorld::ClosestRayResultCallback
 {
-    // ========================================================================
-    class ClosestWithNormal : public btCollisionWorld::ClosestRayResultCallback
+private:
+    int m_triangle_index;
+
+    /** An object that is not tested, or NULL. */
+    const btCollisionObject *m_ignore;
+public:
+    /** Constructor, initialises the triangle index. */
+    ClosestWithNormal(const btVector3 &from,
+                      const btVector3 &to,
+                      const btCollisionObject *ignore=NULL)
+                      : btCollisionWorld::ClosestRayResultCallback(from,to)
     {
-    private:
-        int m_triangle_index;
-    public:
-        /** Constructor, initialises the triangle index. */
-        ClosestWithNormal(const btVector3 &from,
-                          const btVector3 &to)
-                          : btCollisionWorld::ClosestRayResultCallback(from,to)
-        {
-            m_triangle_index = -1;
-        }   // CloestWithNormal
-        // --------------------------------------------------------------------
-        /** Stores the index of the triangle hit. */
-		virtual	btScalar addSingleResult(btCollisionWorld::LocalRayResult& rayResult,
-                                         bool normalInWorldSpace)
-		{
-            // We don't always get a triangle index, sometimes (e.g. ray hits
-            // other kart) we get shapePart=-1, or no localShapeInfo at all
-            if(rayResult.m_localShapeInfo &&
-                rayResult.m_localShapeInfo->m_shapePart>-1)
-                m_triangle_index = rayResult.m_localShapeInfo->m_triangleIndex;
-            return
-                btCollisionWorld::ClosestRayResultCallback::addSingleResult(rayResult,
-                normalInWorldSpace);
-		}
-        // --------------------------------------------------------------------
-        /** Returns the index of the triangle which was hit, or -1 if
-         *  no triangle was hit. */
-        int getTriangleIndex() const { return m_triangle_index; }
-
-    };   // CloestWithNormal
-    // ========================================================================
-
-	ClosestWithNormal rayCallback(from,to);
-
-	m_dynamicsWorld->rayTest(from, to, rayCallback);
-
-	if (rayCallback.hasHit())
-	{
-		btRigidBody* body = btRigidBody::upcast(rayCallback.m_collisionObject);
-        if (body && body->hasContactResponse())
-		{
-			result.m_hitPointInWorld = rayCallback.m_hitPointWorld;
-			result.m_hitNormalInWorld = rayCallback.m_hitNormalWorld;
-			result.m_hitNormalInWorld.normalize();
-			result.m_distFraction = rayCallback.m_closestHitFraction;
-            const TriangleMesh &tm =
-                World::getWorld()->getTrack()->getTriangleMesh();
-            if(m_smooth_normals &&
-                rayCallback.getTriangleIndex()>-1)
-            {
-                btVector3 n=result.m_hitNormalInWorld;
-                result.m_hitNormalInWorld =
-                    tm.getInterpolatedNormal(rayCallback.getTriangleIndex(),
-                                             result.m_hitPointInWorld);
+        m_triangle_index = -1;
+        m_ignore         = ignore;
+    }   // CloestWithNormal
+    // ------------------------------------------------------------------------
+    /** Stores the index of the triangle hit. */
+    virtual btScalar addSingleResult(btCollisionWorld::LocalRayResult& rayResult,
+                                     bool normalInWorldSpace)
+    {
+        // We don't always get a triangle index, sometimes (e.g. ray hits
+        // other kart) we get shapePart=-1, or no localShapeInfo at all
+        if(rayResult.m_localShapeInfo &&
+            rayResult.m_localShapeInfo->m_shapePart>-1)
+            m_triangle_index = rayResult.m_localShapeInfo->m_triangleIndex;
+        return
+            btCollisionWorld::ClosestRayResultCallback::addSingleResult(rayResult,
+            normalInWorldSpace);
+    }
+    // ------------------------------------------------------------------------
+    /** Skips the ignored object before any (expensive) narrow phase test
+     *  is done. */
+    virtual bool needsCollision(btBroadphaseProxy* proxy0) const
+    {
+        if(m_ignore && proxy0->m_clientObject==m_ignore)
+            return false;
+        return btCollisionWorld::ClosestRayResultCallback::needsCollision(proxy0);
+    }
+    // ------------------------------------------------------------------------
+    /** Returns the index of the triangle which was hit, or -1 if
+     *  no triangle was hit. */
+    int getTriangleIndex() const { return m_triangle_index; }
+
+};   // CloestWithNormal
+
+// ============================================================================
+/** Stores the result of a raycast, and smoothes the normal if required.
+ *  \param object The object hit.
+ *  \param hit_point Where the object was hit.
+ *  \param normal The (not necessarily normalised) normal at the hit point.
+ *  \param fraction Fraction of the ray at which the object was hit.
+ *  \param triangle_index Index of the triangle hit, or -1.
+ *  \param result The raycast result to fill in.
+ *  \return The rigid body hit, or NULL if the object hit should not be
+ *          considered.
+ */
+void* btKartRaycaster::setResult(const btCollisionObject *object,
+                                 const btVector3 &hit_point,
+                                 const btVector3 &normal,
+                                 btScalar fraction, int triangle_index,
+                                 btVehicleRaycasterResult &result)
+{
+    const btRigidBody* body = btRigidBody::upcast(object);
+    if (!body || !body->hasContactResponse())
+        return 0;
+
+    result.m_hitPointInWorld = hit_point;
+    result.m_hitNormalInWorld = normal;
+    result.m_hitNormalInWorld.normalize();
+    result.m_distFraction = fraction;
+    const TriangleMesh &tm =
+        World::getWorld()->getTrack()->getTriangleMesh();
+    if(m_smooth_normals && triangle_index>-1)
+    {
+        btVector3 n=result.m_hitNormalInWorld;
+        result.m_hitNormalInWorld =
+            tm.getInterpolatedNormal(triangle_index,
+                                     result.m_hitPointInWorld);
 #undef DEBUG_NORMALS
 #ifdef DEBUG_NORMALS
-                printf("old %f %f %f new %f %f %f\n",
-                    n.getX(), n.getY(), n.getZ(),
-                    result.m_hitNormalInWorld.getX(),
-                    result.m_hitNormalInWorld.getY(),
-                    result.m_hitNormalInWorld.getZ());
+        printf("old %f %f %f new %f %f %f\n",
+            n.getX(), n.getY(), n.getZ(),
+            result.m_hitNormalInWorld.getX(),
+            result.m_hitNormalInWorld.getY(),
+            result.m_hitNormalInWorld.getZ());
 #endif
-            }
-            return body;
-		}
-	}
-	return 0;
-}
+    }
+    return (void*)body;
+}   // setResult
+
+// ----------------------------------------------------------------------------
+void* btKartRaycaster::castRay(const btVector3& from, const btVector3& to,
+                               btVehicleRaycasterResult& result)
+{
+    ClosestWithNormal rayCallback(from,to);
+
+    m_dynamicsWorld->rayTest(from, to, rayCallback);
+
+    if (!rayCallback.hasHit())
+        return 0;
+    return setResult(rayCallback.m_collisionObject,
+                     rayCallback.m_hitPointWorld,
+                     rayCallback.m_hitNormalWorld,
+                     rayCallback.m_closestHitFraction,
+                     rayCallback.getTriangleIndex(), result);
+}   // castRay
+
+// ----------------------------------------------------------------------------
+/** Casts several rays at once, e.g. the suspension rays of all wheels of a
+ *  kart. The rays are tested together against the track mesh (which needs
+ *  only one traversal of the track's bvh for all rays), and then each ray
+ *  is tested against all other objects in the world. The result is the
+ *  same as calling castRay for each ray.
+ *  \param num_rays Number of rays.
+ *  \param from, to Start and end points of all rays.
+ *  \param results On return the result for each ray.
+ *  \param objects On return the object hit by each ray (or NULL).
+ */
+void btKartRaycaster::castRays(unsigned int num_rays, const btVector3 *from,
+                               const btVector3 *to,
+                               btVehicleRaycasterResult *results,
+                               void **objects)
+{
+    const unsigned int MAX_RAYS = 8;
+    const TriangleMesh &tm = World::getWorld()->getTrack()->getTriangleMesh();
+    const btCollisionObject *track = tm.getCollisionObject();
+
+    TriangleMesh::Ray rays[MAX_RAYS];
+    bool use_packet = track && num_rays<=MAX_RAYS;
+    if(use_packet)
+    {
+        for(unsigned int i=0; i<num_rays; i++)
+        {
+            rays[i].m_from = from[i];
+            rays[i].m_to   = to[i];
+        }
+        use_packet = tm.castRays(rays, num_rays);
+    }
+
+    if(!use_packet)
+    {
+        for(unsigned int i=0; i<num_rays; i++)
+            objects[i] = castRay(from[i], to[i], results[i]);
+        return;
+    }
+
+    for(unsigned int i=0; i<num_rays; i++)
+    {
+        ClosestWithNormal rayCallback(from[i], to[i], track);
+        // Only hits closer than the track hit are reported, so if the
+        // track and another object are hit at the same distance, the
+        // track is used.
+        if(rays[i].m_triangle_index>-1)
+            rayCallback.m_closestHitFraction = rays[i].m_fraction;
+        m_dynamicsWorld->rayTest(from[i], to[i], rayCallback);
 
+        if(rayCallback.hasHit())
+            objects[i] = setResult(rayCallback.m_collisionObject,
+                                   rayCallback.m_hitPointWorld,
+                                   rayCallback.m_hitNormalWorld,
+                                   rayCallback.m_closestHitFraction,
+                                   rayCallback.getTriangleIndex(),
+                                   results[i]);
+        else if(rays[i].m_triangle_index>-1)
+            objects[i] = setResult(track, rays[i].m_hit_point,
+                                   rays[i].m_normal, rays[i].m_fraction,
+                                   rays[i].m_triangle_index, results[i]);
+        else
+            objects[i] = 0;
+    }   // for i < num_rays
+}   // castRays
@@ -14,6 +14,7 @@
 #include "BulletDynamics/Dynamics/btRigidBody.h"
 #include "BulletDynamics/ConstraintSolver/btTypedConstraint.h"
 #include "BulletDynamics/Vehicle/btVehicleRaycaster.h"
+class btCollisionObject;
 class btDynamicsWorld;
 #include "LinearMath/btAlignedObjectArray.h"
 #include "BulletDynamics/Vehicle/btWheelInfo.h"
@@ -27,6 +28,11 @@ private:
     /** True if the normals should be smoothed. Not all tracks support this,
     *  so this flag is set depending on track when constructing this object. */
     bool                m_smooth_normals;
+
+    void* setResult(const btCollisionObject *object,
+                    const btVector3 &hit_point, const btVector3 &normal,
+                    btScalar fraction, int triangle_index,
+                    btVehicleRaycasterResult &result);
 public:
 	btKartRaycaster(btDynamicsWorld* world, bool smooth_normals=false)
 		:m_dynamicsWorld(world), m_smooth_normals(smooth_normals)
@@ -35,6 +41,9 @@ public:
 
 	virtual void* castRay(const btVector3& from,const btVector3& to,
                           btVehicleRaycasterResult& result);
+    void castRays(unsigned int num_rays, const btVector3 *from,
+                  const btVector3 *to, btVehicleRaycasterResult *results,
+                  void **objects);
 
 };
 
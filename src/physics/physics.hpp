@@ -24,6 +24,7 @@
   * Contains various physics utilities.
   */
 
+#include <algorithm>
 #include <set>
 #include <vector>
 
@@ -48,11 +49,11 @@ private:
      *  substep might be taken, resulting in potentially even more
      *  duplicates. To handle this, all collisions (i.e. pair of objects)
      *  are stored in a vector, but only one entry per collision pair
-     *  of objects.
-     *  While this is a natural application of std::set, the set has some
-     *  overhead (since it will likely use a tree to sort the entries).
-     *  Considering that the number of collisions is usually rather small
-     *  a simple list and linear search is faster is is being used here. */
+     *  of objects. The vector keeps the order in which the collisions
+     *  were reported, and a small open addressing hash table of indices
+     *  into the vector is used to detect duplicates, since the number of
+     *  collisions can be large (e.g. at the start or in battle arenas
+     *  with many karts and flyables). */
     class CollisionPair {
     private:
         /** The user pointer of the objects involved in this collision. */
@@ -85,6 +86,16 @@ private:
             return (p.m_up[0]==m_up[0] && p.m_up[1]==m_up[1]);
         }   // operator==
         // --------------------------------------------------------------------
+        /** Returns a hash value for the (ordered) pair of user pointers. */
+        size_t getHash() const
+        {
+            size_t a = (size_t)m_up[0], b = (size_t)m_up[1];
+            // The pointers are aligned, so the lowest bits carry no
+            // information.
+            size_t h = (a>>3)*2654435761u ^ (b>>3)*40503u;
+            return h ^ (h>>15);
+        }   // getHash
+        // --------------------------------------------------------------------
         const UserPointer *getUserPointer(unsigned int n) const
         {
             assert(n>=0 && n<=1);
@@ -106,12 +117,41 @@ private:
     class CollisionList : public std::vector<CollisionPair>
     {
     private:
+        /** Hash table with the index+1 of each pair in the vector, 0
+         *  indicates an empty slot. The size is always a power of 2. */
+        std::vector<unsigned int> m_hash;
+
+        // --------------------------------------------------------------------
+        /** Returns the slot in m_hash that either contains p, or the empty
+         *  slot at which p must be inserted. */
+        unsigned int findSlot(const CollisionPair &p)
+        {
+            const unsigned int mask = m_hash.size()-1;
+            unsigned int slot = (unsigned int)p.getHash() & mask;
+            while(m_hash[slot]!=0 && !((*this)[m_hash[slot]-1]==p))
+                slot = (slot+1) & mask;
+            return slot;
+        }   // findSlot
+        // --------------------------------------------------------------------
+        /** Increases the size of the hash table and re-inserts all pairs. */
+        void rehash()
+        {
+            unsigned int n = m_hash.size()==0 ? 64 : 2*m_hash.size();
+            m_hash.clear();
+            m_hash.resize(n, 0);
+            for(unsigned int i=0; i<size(); i++)
+                m_hash[findSlot((*this)[i])] = i+1;
+        }   // rehash
+        // --------------------------------------------------------------------
         void push_back(CollisionPair p) {
+            // Keep the load factor of the hash table below 1/2
+            if(2*(size()+1) > m_hash.size())
+                rehash();
             // only add a pair if it's not already in there
-            for(iterator i=begin(); i!=end(); i++) {
-                if((*i)==p) return;
-            }
+            const unsigned int slot = findSlot(p);
+            if(m_hash[slot]!=0) return;
             std::vector<CollisionPair>::push_back(p);
+            m_hash[slot] = size();
         };  // push_back
     public:
         /** Adds information about a collision to this vector. */
@@ -120,6 +160,13 @@ private:
         {
             push_back(CollisionPair(a, contact_point_a, b, contact_point_b));
         }
+        // --------------------------------------------------------------------
+        /** Removes all collisions. */
+        void clear()
+        {
+            std::vector<CollisionPair>::clear();
+            std::fill(m_hash.begin(), m_hash.end(), 0);
+        }   // clear
     };  // CollisionList
     // ========================================================================
 
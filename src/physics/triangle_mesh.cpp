@@ -20,18 +20,84 @@
 
 #include "btBulletDynamicsCommon.h"
 
+#include "io/cache_file.hpp"
+#include "io/file_manager.hpp"
 #include "modes/world.hpp"
 #include "physics/physics.hpp"
 #include "utils/constants.hpp"
+#include "utils/log.hpp"
+#include "utils/string_utils.hpp"
 #include "utils/time.hpp"
 
-#include <fstream>
+#include <set>
+#include <stdio.h>
+#include <string.h>
+
+/** Identifies a bvh cache file. */
+static const char         BVH_CACHE_MAGIC[4]   = {'S', 'T', 'K', 'B'};
+
+/** Version of the bvh cache files. This must be increased whenever the
+ *  file format or the bvh data in bullet changes. */
+static const unsigned int BVH_CACHE_VERSION    = 1;
+
+/** Written in native byte order, to detect cache files from a system with
+ *  a different byte order. */
+static const unsigned int BVH_CACHE_BYTE_ORDER = 0x01020304;
+
+/** Header of a bvh cache file, followed by the serialised bvh. */
+struct BvhCacheHeader
+{
+    char         m_magic[4];
+    unsigned int m_version;
+    unsigned int m_byte_order;
+    unsigned int m_pointer_size;
+    unsigned int m_scalar_size;
+    unsigned int m_mesh_hash;
+    unsigned int m_num_triangles;
+    unsigned int m_quantized;
+    unsigned int m_bvh_size;
+    unsigned int m_bvh_checksum;
+};   // BvhCacheHeader
+
+// -----------------------------------------------------------------------------
+/** Removes all bvh cache files of a mesh, i.e. all files whose name is the
+ *  cache name followed by "-<hash>.bvh". This is done before a new cache
+ *  file is written, otherwise each change of a track would leave another
+ *  file in the cache directory.
+ *  \param bvh_cache Full path of the cache files without the hash.
+ */
+static void removeBvhCacheFiles(const std::string &bvh_cache)
+{
+    const std::string dir    = StringUtils::getPath(bvh_cache);
+    const std::string prefix = StringUtils::getBasename(bvh_cache) + "-";
+    std::set<std::string> files;
+    file_manager->listFiles(files, dir, /*is_full_path*/true);
+    for(std::set<std::string>::const_iterator i=files.begin();
+        i!=files.end(); i++)
+    {
+        // Only remove the files of this mesh, not e.g. of a track whose
+        // identifier starts with the identifier of this track.
+        if(i->size()<=prefix.size()+4              ||
+           i->compare(0, prefix.size(), prefix)!=0 ||
+           !StringUtils::hasSuffix(*i, ".bvh")        )
+            continue;
+        const std::string hash = i->substr(prefix.size(),
+                                           i->size()-prefix.size()-4);
+        if(hash.find_first_not_of("0123456789")!=std::string::npos)
+            continue;
+        remove((dir+"/"+*i).c_str());
+    }
+}   // removeBvhCacheFiles
 
 // -----------------------------------------------------------------------------
 /** Constructor: Initialises all data structures with zero.
+ *  \param quantized If the bvh should use quantized (16 bit) aabb
+ *         compression. This saves memory for big meshes (e.g. the track),
+ *         the quantization uses the aabb of the whole mesh.
  */
-TriangleMesh::TriangleMesh() : m_mesh()
+TriangleMesh::TriangleMesh(bool quantized) : m_mesh()
 {
+    m_quantized        = quantized;
     m_body             = NULL;
     m_motion_state     = NULL;
     // FIXME: on VS in release mode this statement actually overwrites
@@ -41,6 +107,7 @@ TriangleMesh::TriangleMesh() : m_mesh()
     // (and m_mesh->m_weldingThreshold at m_normals
     m_collision_shape  = NULL;
     m_collision_object = NULL;
+    m_bvh_buffer       = NULL;
     m_user_pointer.set(this);
 }   // TriangleMesh
 
@@ -81,10 +148,15 @@ void TriangleMesh::addTriangle(const btVector3 &t1, const btVector3 &t2,
 // -----------------------------------------------------------------------------
 /** Creates a collision body only, which can be used for raycasting, but
  *  has no physical properties.
- *  @param serialized_bhv if non-null, load the serialized bhv from file instead
- *                        of builing it on the fly
+ *  \param create_collision_object If a collision object should be created.
+ *  \param bvh_cache If not empty, the bvh is loaded from a cache file
+ *         whose name starts with this string (followed by a hash of the
+ *         mesh). If no valid cache file exists, the bvh is built and saved
+ *         in this file, and the cache files of older versions of this
+ *         mesh are removed.
  */
-void TriangleMesh::createCollisionShape(bool create_collision_object, const char* serialized_bhv)
+void TriangleMesh::createCollisionShape(bool create_collision_object,
+                                        const std::string &bvh_cache)
 {
     if(m_triangleIndex2Material.size()==0)
     {
@@ -96,55 +168,40 @@ void TriangleMesh::createCollisionShape(bool create_collision_object, const char
     }
     // Now convert the triangle mesh into a static rigid body
     btBvhTriangleMeshShape* bhv_triangle_mesh;
+    const bool quantized = m_quantized;
 
-    if (serialized_bhv != NULL)
+    if (bvh_cache != "")
     {
-        FILE *f = fopen(serialized_bhv, "rb");
-        fseek(f, 0, SEEK_END);
-        long pos = ftell(f);
-        fseek(f, 0, SEEK_SET);
-
-        void* bytes = btAlignedAlloc(pos, 16);
-        fread(bytes, pos, 1, f);
-        fclose(f);
-
-        btOptimizedBvh* bhv = btOptimizedBvh::deSerializeInPlace(bytes, pos, !IS_LITTLE_ENDIAN);
+        const unsigned int hash = getMeshHash(quantized);
+        const std::string filename = bvh_cache + "-"
+                                   + StringUtils::toString(hash) + ".bvh";
+        btOptimizedBvh* bhv = loadBvh(filename, hash, quantized);
         if (bhv == NULL)
         {
-            fprintf(stderr, "[TriangleMesh] WARNING, failed to load serialized BHV\n");
-            bhv_triangle_mesh = new btBvhTriangleMeshShape(&m_mesh, false /* useQuantizedAabbCompression */);
+            bhv_triangle_mesh = new btBvhTriangleMeshShape(&m_mesh, quantized);
+            removeBvhCacheFiles(bvh_cache);
+            saveBvh(filename, hash, quantized,
+                    bhv_triangle_mesh->getOptimizedBvh());
         }
         else
         {
-            bhv_triangle_mesh = new btBvhTriangleMeshShape(&m_mesh, false /* useQuantizedAabbCompression */,
+            bhv_triangle_mesh = new btBvhTriangleMeshShape(&m_mesh, quantized,
                                                            false /* buildBvh */);
             bhv_triangle_mesh->setOptimizedBvh( bhv );
         }
-        // Do *NOT* free the bytes, 'deSerializeInPlace' makes the btOptimizedBvh object
-        // directly at this memory location
-        //free(bytes);
-
     }
     else
     {
-        bhv_triangle_mesh = new btBvhTriangleMeshShape(&m_mesh, false /* useQuantizedAabbCompression */);
-
-        /*
-         // code to serialize triangle mesh
-        btOptimizedBvh* bvh = bhv_triangle_mesh->getOptimizedBvh();
-        unsigned int ssize = bvh->calculateSerializeBufferSize();
-        char* buffer = (char*)btAlignedAlloc(ssize, 16);
-        bool success = bvh->serialize(buffer, ssize, !IS_LITTLE_ENDIAN);
-        printf("serialization success = %i\n", success);
-
-        std::ofstream fileout("/tmp/btOptimizedBvh");
-        fileout.write(buffer, ssize);
-        fileout.close();
-
-        btAlignedFree(buffer);
-         */
+        bhv_triangle_mesh = new btBvhTriangleMeshShape(&m_mesh, quantized);
     }
 
+    if(bhv_triangle_mesh->getOptimizedBvh())
+        Log::verbose("TriangleMesh", "Bvh for %d triangles uses %d bytes%s.",
+                     (int)m_triangleIndex2Material.size(),
+                     bhv_triangle_mesh->getOptimizedBvh()
+                                      ->calculateSerializeBufferSize(),
+                     quantized ? " (quantized)" : "");
+
     m_collision_shape = bhv_triangle_mesh;
     m_collision_shape->setUserPointer(&m_user_pointer);
     if(create_collision_object)
@@ -158,6 +215,133 @@ void TriangleMesh::createCollisionShape(bool create_collision_object, const char
 
 }   // createCollisionShape
 
+// -----------------------------------------------------------------------------
+/** Computes a hash value of all triangles of this mesh, which is used to
+ *  detect if a cached bvh still belongs to this mesh.
+ *  \param quantized If the bvh uses quantized aabb compression.
+ */
+unsigned int TriangleMesh::getMeshHash(bool quantized) const
+{
+    unsigned int hash = CacheFile::fnvHash(&quantized, sizeof(quantized));
+    for(unsigned int i=0; i<m_triangleIndex2Material.size(); i++)
+    {
+        btVector3 p[3];
+        getTriangle(i, &p[0], &p[1], &p[2]);
+        for(unsigned int j=0; j<3; j++)
+        {
+            // Only hash x, y, z (the 4th component is not initialised)
+            float f[3] = { p[j].getX(), p[j].getY(), p[j].getZ() };
+            hash = CacheFile::fnvHash(f, sizeof(f), hash);
+        }
+    }
+    return hash;
+}   // getMeshHash
+
+// -----------------------------------------------------------------------------
+/** Tries to load a bvh from a cache file. The file is only used if it was
+ *  written by the same version on a system with the same byte order and
+ *  pointer size, for the same mesh, and its checksum is correct.
+ *  \param filename Name of the cache file.
+ *  \param hash Hash value of this mesh.
+ *  \param quantized If the bvh must use quantized aabb compression.
+ *  \return The bvh, or NULL if the cache file could not be used.
+ */
+btOptimizedBvh *TriangleMesh::loadBvh(const std::string &filename,
+                                      unsigned int hash, bool quantized)
+{
+    FILE *f = fopen(filename.c_str(), "rb");
+    if(!f) return NULL;
+
+    BvhCacheHeader header;
+    if(fread(&header, sizeof(header), 1, f)!=1               ||
+       memcmp(header.m_magic, BVH_CACHE_MAGIC, 4)!=0          ||
+       header.m_version       != BVH_CACHE_VERSION            ||
+       header.m_byte_order    != BVH_CACHE_BYTE_ORDER         ||
+       header.m_pointer_size  != sizeof(void*)                ||
+       header.m_scalar_size   != sizeof(btScalar)             ||
+       header.m_mesh_hash     != hash                         ||
+       header.m_num_triangles != m_triangleIndex2Material.size() ||
+       header.m_quantized     != (quantized ? 1u : 0u)           )
+    {
+        fclose(f);
+        return NULL;
+    }
+
+    void *buffer = btAlignedAlloc(header.m_bvh_size, 16);
+    bool ok = fread(buffer, header.m_bvh_size, 1, f)==1 &&
+              CacheFile::fnvHash(buffer, header.m_bvh_size)
+                                         == header.m_bvh_checksum;
+    fclose(f);
+
+    // The btOptimizedBvh object is created directly in the buffer, so the
+    // buffer must only be freed after the collision shape is deleted.
+    btOptimizedBvh *bvh = ok ? btOptimizedBvh::deSerializeInPlace(buffer,
+                                                       header.m_bvh_size,
+                                                       /*swap*/false)
+                             : NULL;
+    if(!bvh)
+    {
+        Log::warn("TriangleMesh", "Invalid bvh cache file '%s' - ignored.",
+                  filename.c_str());
+        btAlignedFree(buffer);
+        return NULL;
+    }
+    m_bvh_buffer = buffer;
+    Log::verbose("TriangleMesh", "Loaded bvh from '%s'.", filename.c_str());
+    return bvh;
+}   // loadBvh
+
+// -----------------------------------------------------------------------------
+/** Saves a bvh in a cache file.
+ *  \param filename Name of the cache file.
+ *  \param hash Hash value of this mesh.
+ *  \param quantized If the bvh uses quantized aabb compression.
+ *  \param bvh The bvh to save.
+ */
+void TriangleMesh::saveBvh(const std::string &filename, unsigned int hash,
+                           bool quantized, btOptimizedBvh *bvh) const
+{
+    if(!bvh) return;
+
+    BvhCacheHeader header;
+    memcpy(header.m_magic, BVH_CACHE_MAGIC, 4);
+    header.m_version       = BVH_CACHE_VERSION;
+    header.m_byte_order    = BVH_CACHE_BYTE_ORDER;
+    header.m_pointer_size  = sizeof(void*);
+    header.m_scalar_size   = sizeof(btScalar);
+    header.m_mesh_hash     = hash;
+    header.m_num_triangles = m_triangleIndex2Material.size();
+    header.m_quantized     = quantized ? 1 : 0;
+    header.m_bvh_size      = bvh->calculateSerializeBufferSize();
+
+    void *buffer = btAlignedAlloc(header.m_bvh_size, 16);
+    if(!bvh->serialize(buffer, header.m_bvh_size, /*swap*/false))
+    {
+        btAlignedFree(buffer);
+        return;
+    }
+    header.m_bvh_checksum = CacheFile::fnvHash(buffer, header.m_bvh_size);
+
+    FILE *f = fopen(filename.c_str(), "wb");
+    if(!f)
+    {
+        Log::warn("TriangleMesh", "Can't write bvh cache file '%s'.",
+                  filename.c_str());
+        btAlignedFree(buffer);
+        return;
+    }
+    bool ok = fwrite(&header, sizeof(header), 1, f)==1 &&
+              fwrite(buffer, header.m_bvh_size, 1, f)==1;
+    fclose(f);
+    btAlignedFree(buffer);
+    if(!ok)
+    {
+        Log::warn("TriangleMesh", "Can't write bvh cache file '%s'.",
+                  filename.c_str());
+        remove(filename.c_str());
+    }
+}   // saveBvh
+
 // -----------------------------------------------------------------------------
 /** Creates the physics body for this triangle mesh. If the body already
  *  exists (because it was created by a previous call to createBody)
@@ -167,15 +351,27 @@ void TriangleMesh::createCollisionShape(bool create_collision_object, const char
  *  removed and all objects together with the track is converted again into
  *  a single rigid body. This avoids using irrlicht (or the graphics engine)
  *  for height of terrain detection).
- *  @param serializedBhv if non-NULL, the bhv is deserialized instead of
- *                       being calculated on the fly
+ *  \param bvh_cache If not empty, the bvh is loaded from (or saved to)
+ *         a cache file, see createCollisionShape.
  */
 void TriangleMesh::createPhysicalBody(btCollisionObject::CollisionFlags flags,
-                                      const char* serializedBhv)
+                                      const std::string &bvh_cache)
 {
     // We need the collision shape, but not the collision object (since
     // this will be created when the dynamics body is anyway).
-    createCollisionShape(/*create_collision_object*/false, serializedBhv);
+    createCollisionShape(/*create_collision_object*/false, bvh_cache);
+    createRigidBody(flags);
+}   // createPhysicalBody
+
+// -----------------------------------------------------------------------------
+/** Creates the rigid body for the collision shape created by
+ *  createCollisionShape, and adds it to the physics world. Building the
+ *  collision shape (i.e. the bvh) does not access the physics world, so it
+ *  can be done in a job of the worker pool, while this function must be
+ *  called from the main thread.
+ */
+void TriangleMesh::createRigidBody(btCollisionObject::CollisionFlags flags)
+{
     btTransform startTransform;
     startTransform.setIdentity();
     m_motion_state = new btDefaultMotionState(startTransform);
@@ -188,7 +384,7 @@ void TriangleMesh::createPhysicalBody(btCollisionObject::CollisionFlags flags,
     m_body->setCollisionFlags(m_body->getCollisionFlags()  |
                               flags                        |
                               btCollisionObject::CF_CUSTOM_MATERIAL_CALLBACK);
-}   // createPhysicalBody
+}   // createRigidBody
 
 // ----------------------------------------------------------------------------
 /** Removes the created body and/or collision object from the physics world.
@@ -214,6 +410,11 @@ void TriangleMesh::removeAll()
     }
     delete m_collision_shape;
     m_collision_shape = NULL;
+    if(m_bvh_buffer)
+    {
+        btAlignedFree(m_bvh_buffer);
+        m_bvh_buffer = NULL;
+    }
 }   // removeAll
 
 // -----------------------------------------------------------------------------
@@ -286,6 +487,29 @@ bool TriangleMesh::castRay(const btVector3 &from, const btVector3 &to,
         return false;
     }
 
+    // Use the faster bvh traversal in castRays if possible
+    Ray ray;
+    ray.m_from = from;
+    ray.m_to   = to;
+    if(castRays(&ray, 1))
+    {
+        if(ray.m_triangle_index<0)
+        {
+            *material = NULL;
+            if(normal)
+                normal->setValue(0, 1, 0);
+            return false;
+        }
+        *xyz      = ray.m_hit_point;
+        *material = getMaterial(ray.m_triangle_index);
+        if(normal)
+        {
+            *normal = ray.m_normal;
+            normal->normalize();
+        }
+        return true;
+    }
+
     btTransform trans_from;
     trans_from.setIdentity();
     trans_from.setOrigin(from);
@@ -353,3 +577,128 @@ bool TriangleMesh::castRay(const btVector3 &from, const btVector3 &to,
     return ray_callback.hasHit();
 
 }   // castRay
+
+// ----------------------------------------------------------------------------
+/** Casts several rays against this mesh in one traversal of the bvh: each
+ *  bvh node is tested against all rays (so the node data is only loaded
+ *  once), and each triangle is only tested against the rays that overlap
+ *  the triangle's node. This gives exactly the same results as casting each
+ *  ray with bullet's raycast (same triangle test and order of triangles).
+ *  Only a quantized bvh is supported.
+ *  \param rays The rays to cast (see Ray), on return the hit information
+ *         is set.
+ *  \param num_rays Number of rays.
+ *  \return False if the rays could not be cast (e.g. no quantized bvh is
+ *          used), in which case no ray information is set.
+ */
+bool TriangleMesh::castRays(Ray *rays, unsigned int num_rays) const
+{
+    if(!m_collision_shape) return false;
+    const btBvhTriangleMeshShape *shape =
+        static_cast<const btBvhTriangleMeshShape*>(m_collision_shape);
+    btOptimizedBvh *bvh =
+        const_cast<btBvhTriangleMeshShape*>(shape)->getOptimizedBvh();
+    if(!bvh || !bvh->isQuantized())
+        return false;
+
+    /** The maximum number of rays that can be cast in one traversal. */
+    const unsigned int MAX_RAYS = 8;
+    if(num_rays > MAX_RAYS)
+    {
+        return castRays(rays, MAX_RAYS) &&
+               castRays(rays+MAX_RAYS, num_rays-MAX_RAYS);
+    }
+
+    // Compute the quantized aabb of each ray
+    unsigned short ray_min[MAX_RAYS][3], ray_max[MAX_RAYS][3];
+    for(unsigned int i=0; i<num_rays; i++)
+    {
+        btVector3 aabb_min = rays[i].m_from;
+        btVector3 aabb_max = rays[i].m_from;
+        aabb_min.setMin(rays[i].m_to);
+        aabb_max.setMax(rays[i].m_to);
+        bvh->quantizeWithClamp(ray_min[i], aabb_min, 0);
+        bvh->quantizeWithClamp(ray_max[i], aabb_max, 1);
+        rays[i].m_fraction       = 1.0f;
+        rays[i].m_triangle_index = -1;
+    }
+
+    const QuantizedNodeArray &nodes = bvh->getQuantizedNodeArray();
+    // The root node's escape index is the number of nodes in the tree.
+    const int num_nodes = nodes[0].isLeafNode() ? 1
+                                                : nodes[0].getEscapeIndex();
+    int current = 0;
+    while(current < num_nodes)
+    {
+        const btQuantizedBvhNode &node = nodes[current];
+        unsigned int overlap = 0;
+        for(unsigned int i=0; i<num_rays; i++)
+        {
+            if(testQuantizedAabbAgainstQuantizedAabb(ray_min[i], ray_max[i],
+                                                     node.m_quantizedAabbMin,
+                                                     node.m_quantizedAabbMax))
+                overlap |= 1<<i;
+        }
+
+        const bool is_leaf = node.isLeafNode();
+        if(is_leaf && overlap)
+        {
+            const int index = node.getTriangleIndex();
+            btVector3 vert0, vert1, vert2;
+            getTriangle(index, &vert0, &vert1, &vert2);
+            const btVector3 v10 = vert1 - vert0;
+            const btVector3 v20 = vert2 - vert0;
+            const btVector3 triangle_normal = v10.cross(v20);
+            const btScalar dist = vert0.dot(triangle_normal);
+
+            // Same test as btTriangleRaycastCallback::processTriangle
+            for(unsigned int i=0; i<num_rays; i++)
+            {
+                if(!(overlap & (1<<i))) continue;
+                Ray &ray = rays[i];
+                const btScalar dist_a = triangle_normal.dot(ray.m_from)-dist;
+                const btScalar dist_b = triangle_normal.dot(ray.m_to  )-dist;
+                if(dist_a * dist_b >= btScalar(0.0))
+                    continue;   // same sign
+
+                const btScalar distance = dist_a / (dist_a-dist_b);
+                if(!(distance < ray.m_fraction)) continue;
+
+                // Add an epsilon as a tolerance in case that the ray hits
+                // exactly on the edge of the triangle.
+                const btScalar edge_tolerance =
+                    triangle_normal.length2() * btScalar(-0.0001);
+                btVector3 point;
+                point.setInterpolate3(ray.m_from, ray.m_to, distance);
+                const btVector3 v0p = vert0 - point;
+                const btVector3 v1p = vert1 - point;
+                if(!(v0p.cross(v1p).dot(triangle_normal) >= edge_tolerance))
+                    continue;
+                const btVector3 v2p = vert2 - point;
+                if(!(v1p.cross(v2p).dot(triangle_normal) >= edge_tolerance))
+                    continue;
+                if(!(v2p.cross(v0p).dot(triangle_normal) >= edge_tolerance))
+                    continue;
+
+                ray.m_fraction       = distance;
+                ray.m_triangle_index = index;
+                ray.m_normal         = triangle_normal.normalized();
+                if(dist_a <= btScalar(0.0))
+                    ray.m_normal = -ray.m_normal;
+            }   // for i < num_rays
+        }   // if is_leaf && overlap
+
+        if(overlap || is_leaf)
+            current++;
+        else
+            current += node.getEscapeIndex();
+    }   // while current < num_nodes
+
+    for(unsigned int i=0; i<num_rays; i++)
+    {
+        if(rays[i].m_triangle_index>=0)
+            rays[i].m_hit_point.setInterpolate3(rays[i].m_from, rays[i].m_to,
+                                                rays[i].m_fraction);
+    }
+    return true;
+}   // castRays
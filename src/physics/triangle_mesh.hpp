@@ -19,6 +19,7 @@
 #ifndef HEADER_TRIANGLE_MESH_HPP
 #define HEADER_TRIANGLE_MESH_HPP
 
+#include <string>
 #include <vector>
 #include "btBulletDynamicsCommon.h"
 
@@ -33,6 +34,23 @@ class Material;
  */
 class TriangleMesh
 {
+public:
+    /** A ray used in castRays. The start and end point must be set before
+     *  calling castRays, all other values are set by castRays. */
+    struct Ray
+    {
+        /** Start and end point of the ray. */
+        btVector3 m_from, m_to;
+        /** Position at which the ray hit the mesh. */
+        btVector3 m_hit_point;
+        /** Normal of the triangle hit (facing towards m_from). */
+        btVector3 m_normal;
+        /** Hit position as fraction between m_from (0) and m_to (1). */
+        btScalar  m_fraction;
+        /** Index of the triangle that was hit, or -1 if nothing was hit. */
+        int       m_triangle_index;
+    };   // Ray
+
 private:
     UserPointer                  m_user_pointer;
     std::vector<const Material*> m_triangleIndex2Material;
@@ -44,17 +62,32 @@ private:
     btCollisionShape            *m_collision_shape;
     /** The three normals for each triangle. */
     AlignedArray<btVector3>      m_normals;
+    /** If the bvh was loaded from the cache, this is the memory in which
+     *  the bvh was deserialised (it must be kept as long as the collision
+     *  shape exists). */
+    void                        *m_bvh_buffer;
+    /** True if the bvh should use quantized aabb compression, which
+     *  roughly halves the memory used by the bvh. */
+    bool                         m_quantized;
+
+    unsigned int    getMeshHash(bool quantized) const;
+    btOptimizedBvh *loadBvh(const std::string &filename, unsigned int hash,
+                            bool quantized);
+    void            saveBvh(const std::string &filename, unsigned int hash,
+                            bool quantized, btOptimizedBvh *bvh) const;
 public:
-         TriangleMesh();
+         TriangleMesh(bool quantized=false);
         ~TriangleMesh();
     void addTriangle(const btVector3 &t1, const btVector3 &t2,
                      const btVector3 &t3, const btVector3 &n1,
                      const btVector3 &n2, const btVector3 &n3,
                      const Material* m);
-    void createCollisionShape(bool create_collision_object=true, const char* serialized_bhv=NULL);
+    void createCollisionShape(bool create_collision_object=true,
+                              const std::string &bvh_cache="");
     void createPhysicalBody(btCollisionObject::CollisionFlags flags=
                                (btCollisionObject::CollisionFlags)0,
-                            const char* serializedBhv = NULL);
+                            const std::string &bvh_cache="");
+    void createRigidBody(btCollisionObject::CollisionFlags flags);
     void removeAll();
     void removeCollisionObject();
     btVector3 getInterpolatedNormal(unsigned int index,
@@ -71,6 +104,15 @@ public:
     bool castRay(const btVector3 &from, const btVector3 &to,
                  btVector3 *xyz, const Material **material,
                  btVector3 *normal=NULL) const;
+    bool castRays(Ray *rays, unsigned int num_rays) const;
+    // ------------------------------------------------------------------------
+    /** Returns the bullet object of this mesh (either the rigid body or
+     *  the collision object), or NULL if it was not created. */
+    const btCollisionObject *getCollisionObject() const
+    {
+        if(m_collision_object) return m_collision_object;
+        return m_body;
+    }   // getCollisionObject
     // ------------------------------------------------------------------------
     /** Returns the points of the 'indx' triangle.
      *  \param indx Index of the triangle to get.
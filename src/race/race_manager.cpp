@@ -110,7 +110,7 @@ void RaceManager::setDefaultAIKartList(const std::vector<std::string>& ai_list)
     for(unsigned int i=0; i<ai_list.size(); i++)
     {
         const std::string &name=ai_list[i];
-        const KartProperties *kp = kart_properties_manager->getKart(name);
+        const KartProperties *kp = kart_properties_manager->getKartMetadata(name);
         if(!kp)
         {
             Log::warn("RaceManager", "Kart '%s' is unknown and therefore ignored.",
@@ -141,7 +141,7 @@ void RaceManager::setLocalKartInfo(unsigned int player_id,
 {
     assert(kart.size() > 0);
     assert(0<=player_id && player_id <m_local_player_karts.size());
-    assert(kart_properties_manager->getKart(kart) != NULL);
+    assert(kart_properties_manager->getKartMetadata(kart) != NULL);
 
     m_local_player_karts[player_id] = RemoteKartInfo(player_id, kart,
                                                   StateManager::get()->getActivePlayerProfile(player_id)->getName(),
@@ -409,6 +409,27 @@ void RaceManager::startNextRace()
         }
     }   // not first race
 
+    // Karts created from the metadata index must be loaded before the
+    // track, since the track's temporary materials would otherwise
+    // become permanent. A kart that can't be loaded is replaced by the
+    // default kart.
+    for(unsigned int i=0; i<m_kart_status.size(); i++)
+    {
+        if(kart_properties_manager->loadKartData(m_kart_status[i].m_ident))
+            continue;
+        if(!kart_properties_manager->loadKartData(
+                                                UserConfigParams::m_default_kart))
+        {
+            UserConfigParams::m_default_kart.revertToDefaults();
+            kart_properties_manager->loadKartData(
+                                                UserConfigParams::m_default_kart);
+        }
+        Log::warn("RaceManager", "Can't load kart '%s', using '%s' instead.",
+                  m_kart_status[i].m_ident.c_str(),
+                  std::string(UserConfigParams::m_default_kart).c_str());
+        m_kart_status[i].m_ident = UserConfigParams::m_default_kart;
+    }
+
     // the constructor assigns this object to the global
     // variable world. Admittedly a bit ugly, but simplifies
     // handling of objects which get created in the constructor
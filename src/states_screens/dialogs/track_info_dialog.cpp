@@ -211,7 +211,8 @@ void TrackInfoDialog::updateHighScores()
 
             std::string time_string = StringUtils::timeToString(time);
 
-            const KartProperties* prop = kart_properties_manager->getKart(kart_name);
+            const KartProperties* prop =
+                kart_properties_manager->getKartMetadata(kart_name);
             if (prop != NULL)
             {
                 const std::string &icon_path = prop->getAbsoluteIconFile();
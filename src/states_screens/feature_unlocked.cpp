@@ -722,8 +722,10 @@ void FeatureUnlockedCutScene::addUnlockedThings(const std::vector<const Challeng
                 }
                 case ChallengeData::UNLOCK_KART:
                 {
+                    const std::string &ident = unlockedFeatures[i].m_name;
                     const KartProperties* kart =
-                        kart_properties_manager->getKart(unlockedFeatures[i].m_name);
+                        kart_properties_manager->loadKartData(ident)
+                        ? kart_properties_manager->getKart(ident) : NULL;
 
                     if (kart == NULL)
                     {
@@ -325,7 +325,9 @@ void GrandPrixLose::setKarts(std::vector<std::string> ident_arg)
     const int count = ident_arg.size();
     for (int n=0; n<count; n++)
     {
-        const KartProperties* kart = kart_properties_manager->getKart(ident_arg[n]);
+        const KartProperties* kart =
+            kart_properties_manager->loadKartData(ident_arg[n])
+            ? kart_properties_manager->getKart(ident_arg[n]) : NULL;
         if (kart != NULL)
         {
             KartModel* kart_model = kart->getKartModelCopy();
@@ -433,7 +433,9 @@ void GrandPrixWin::setKarts(const std::string idents_arg[3])
 
         scene::ISceneNode* kart_main_node = NULL;
 
-        const KartProperties* kp = kart_properties_manager->getKart(idents[n]);
+        const KartProperties* kp =
+            kart_properties_manager->loadKartData(idents[n])
+            ? kart_properties_manager->getKart(idents[n]) : NULL;
         if (kp != NULL)
         {
             KartModel *kart_model = kp->getKartModelCopy();
@@ -68,7 +68,7 @@ void HelpScreen1::eventCallback(Widget* widget, const std::string& name, const i
         StateManager::get()->createActivePlayer(unlock_manager->getCurrentPlayer(),
                                                 device);
 
-        if (kart_properties_manager->getKart(UserConfigParams::m_default_kart) == NULL)
+        if (kart_properties_manager->getKartMetadata(UserConfigParams::m_default_kart) == NULL)
         {
             fprintf(stderr, "[MainMenuScreen] WARNING: cannot find kart '%s', will revert to default\n",
                     UserConfigParams::m_default_kart.c_str());
@@ -350,7 +350,8 @@ public:
         // Init kart model
         const std::string default_kart = UserConfigParams::m_default_kart;
         const KartProperties* props =
-            kart_properties_manager->getKart(default_kart);
+            kart_properties_manager->loadKartData(default_kart)
+            ? kart_properties_manager->getKart(default_kart) : NULL;
 
         if(!props)
         {
@@ -359,14 +360,11 @@ public:
             // first kart as a default. This way we don't have to hardcode
             // any kart names.
             int id = kart_properties_manager->getKartByGroup(kartGroup, 0);
-            if (id == -1)
-            {
-                props = kart_properties_manager->getKartById(0);
-            }
-            else
-            {
-                props = kart_properties_manager->getKartById(id);
-            }
+            if (id == -1) id = 0;
+            props = kart_properties_manager->getKartMetadataById(id);
+            if (props &&
+                !kart_properties_manager->loadKartData(props->getIdent()))
+                props = NULL;
 
             if(!props)
             {
@@ -937,7 +935,8 @@ public:
         else
         {
             const KartProperties *kp =
-                kart_properties_manager->getKart(selectionID);
+                kart_properties_manager->loadKartData(selectionID)
+                ? kart_properties_manager->getKart(selectionID) : NULL;
             if (kp != NULL)
             {
                 const KartModel &kart_model = kp->getMasterKartModel();
@@ -2047,7 +2046,7 @@ void KartSelectionScreen::setKartsFromCurrentGroup()
         for (int n=0; n<kart_amount; n++)
         {
             const KartProperties* prop =
-                kart_properties_manager->getKartById(n);
+                kart_properties_manager->getKartMetadataById(n);
             if (unlock_manager->getCurrentSlot()->isLocked(prop->getIdent()))
             {
                 w->addItem(
@@ -2077,7 +2076,7 @@ void KartSelectionScreen::setKartsFromCurrentGroup()
         for (int n=0; n<kart_amount; n++)
         {
             const KartProperties* prop =
-                kart_properties_manager->getKartById(group[n]);
+                kart_properties_manager->getKartMetadataById(group[n]);
             const std::string &icon_path = prop->getAbsoluteIconFile();
 
             if (unlock_manager->getCurrentSlot()->isLocked(prop->getIdent()))
@@ -218,6 +218,7 @@ void MainMenuScreen::eventCallback(Widget* widget, const std::string& name,
 
         if (i % 4 == 0)
         {
+            kart_properties_manager->loadKartData("tux");
             // the passed kart will not be modified, that's why I allow myself
             // to use const_cast
             scene->addUnlockedKart(
@@ -317,7 +318,7 @@ void MainMenuScreen::eventCallback(Widget* widget, const std::string& name,
         StateManager::get()->createActivePlayer(unlock_manager->getCurrentPlayer(),
                                                 device);
 
-        if (kart_properties_manager->getKart(UserConfigParams::m_default_kart) == NULL)
+        if (kart_properties_manager->getKartMetadata(UserConfigParams::m_default_kart) == NULL)
         {
             fprintf(stderr, "[MainMenuScreen] WARNING: cannot find kart '%s', will revert to default\n",
                     UserConfigParams::m_default_kart.c_str());
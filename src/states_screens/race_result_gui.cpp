@@ -1034,7 +1034,8 @@ void RaceResultGUI::displayHighScores()
             int current_x = x;
             int current_y = y+(i+1)*50;
 
-            const KartProperties* prop = kart_properties_manager->getKart(kart_name);
+            const KartProperties* prop =
+                kart_properties_manager->getKartMetadata(kart_name);
             if (prop != NULL)
             {
                 const std::string &icon_path = prop->getAbsoluteIconFile();
@@ -17,6 +17,7 @@
 
 #include "states_screens/soccer_setup_screen.hpp"
 
+#include "config/user_config.hpp"
 #include "input/device_manager.hpp"
 #include "input/input_manager.hpp"
 #include "states_screens/state_manager.hpp"
@@ -89,8 +90,15 @@ void SoccerSetupScreen::beforeAddingWidget()
     for(int i=0 ; i < nb_players ; i++)
     {
         const RemoteKartInfo&   kart_info   = race_manager->getLocalKartInfo(i);
-        const std::string&      kart_name   = kart_info.getKartName();
+        std::string             kart_name   = kart_info.getKartName();
 
+        if(!kart_properties_manager->loadKartData(kart_name))
+        {
+            // The race will use the default kart instead, see
+            // RaceManager::startNextRace
+            kart_name = UserConfigParams::m_default_kart;
+            kart_properties_manager->loadKartData(kart_name);
+        }
         const KartProperties*   props       = kart_properties_manager->getKart(kart_name);
         const KartModel&        kart_model  = props->getMasterKartModel();
 
@@ -105,63 +105,57 @@ void GraphNode::addSuccessor(unsigned int to)
 void GraphNode::setupPathsToNode()
 {
     if(m_successor_nodes.size()<2) return;
+    assert(m_successor_nodes.size()<NO_PATH);
 
     const unsigned int num_nodes = QuadGraph::get()->getNumNodes();
-    m_path_to_node.resize(num_nodes);
 
-    // Initialise each graph node with -1, indicating that
+    // Initialise each graph node with NO_PATH, indicating that
     // it hasn't been reached yet.
-    for(unsigned int i=0; i<num_nodes; i++)
-        m_path_to_node[i] = -1;
+    m_path_to_node.clear();
+    m_path_to_node.resize(num_nodes, NO_PATH);
 
     // Indicate that this node can be reached from this node by following
-    // successor 0 - just a dummy value that might only be used during the
-    // recursion below.
+    // successor 0 - just a dummy value that is only used to stop the
+    // search below.
     m_path_to_node[m_node_index] = 0;
 
-    // A simple depth first search is used to determine which successor to
-    // use to reach a certain graph node. Using Dijkstra's algorithm  would
-    // give the shortest way to reach a certain node, but the shortest way
-    // might involve some shortcuts which are hidden, and should therefore
-    // not be used.
+    // A simple search is used to determine which successor to use to
+    // reach a certain graph node: each successor marks all nodes it can
+    // reach that were not reached by a previous successor. Using Dijkstra's
+    // algorithm  would give the shortest way to reach a certain node, but
+    // the shortest way might involve some shortcuts which are hidden, and
+    // should therefore not be used. The order in which the nodes reachable
+    // from one successor are visited does not matter, so an explicit stack
+    // is used instead of recursion (which could get very deep on big
+    // tracks).
+    std::vector<unsigned int> to_visit;
     for(unsigned int i=0; i<getNumberOfSuccessors(); i++)
     {
-        GraphNode &gn = QuadGraph::get()->getNode(getSuccessor(i));
-        gn.markAllSuccessorsToUse(i, &m_path_to_node);
-    }
+        to_visit.push_back(getSuccessor(i));
+        while(to_visit.size()>0)
+        {
+            const unsigned int n = to_visit.back();
+            to_visit.pop_back();
+            if(m_path_to_node[n]!=NO_PATH) continue;
+            m_path_to_node[n] = i;
+            const GraphNode &gn = QuadGraph::get()->getNode(n);
+            for(unsigned int j=0; j<gn.getNumberOfSuccessors(); j++)
+            {
+                if(m_path_to_node[gn.getSuccessor(j)]==NO_PATH)
+                    to_visit.push_back(gn.getSuccessor(j));
+            }
+        }   // while to_visit.size()>0
+    }   // for i<getNumberOfSuccessors
 #ifdef DEBUG
     for(unsigned int i=0; i<m_path_to_node.size(); i++)
     {
-        if(m_path_to_node[i]==-1)
+        if(m_path_to_node[i]==NO_PATH)
             printf("[WARNING] No path to node %d found on graph node %d.\n",
                    i, m_node_index);
     }
 #endif
 }   // setupPathsToNode
 
-// ----------------------------------------------------------------------------
-/** This function marks that the successor n should be used to reach this
- *  node. It then recursively (depth first) does the same for all its
- *  successors. Depth-first
- *  \param n The successor which should be used in m_path_node to reach
- *         this node.
- *  \param path_to_node The path-to-node data structure of the node for
- *         which the paths are currently determined.
- */
-void GraphNode::markAllSuccessorsToUse(unsigned int n,
-                                       PathToNodeVector *path_to_node)
-{
-    // End recursion if the path to this node has already been found.
-    if( (*path_to_node)[m_node_index] >-1) return;
-
-    (*path_to_node)[m_node_index] = n;
-    for(unsigned int i=0; i<getNumberOfSuccessors(); i++)
-    {
-        GraphNode &gn = QuadGraph::get()->getNode(getSuccessor(i));
-        gn.markAllSuccessorsToUse(n, path_to_node);
-    }
-}   // markAllSuccesorsToUse
-
 // ----------------------------------------------------------------------------
 void GraphNode::setDirectionData(unsigned int successor, DirectionType dir,
                                  unsigned int last_node_index)
@@ -97,11 +97,15 @@ private:
       *  from the center of the drivelines anyway. */
      core::line2df  m_line;
 
-     typedef std::vector<int> PathToNodeVector;
+     /** Value in m_path_to_node for a graph node that can't be reached. */
+     enum {NO_PATH = 255};
+
+     typedef std::vector<unsigned char> PathToNodeVector;
      /** This vector is only used if the graph node has more than one
       *  successor. In this case m_path_to_node[X] will contain the index
       *  of the successor to use in order to reach graph node X for this
-      *  graph nodes.  */
+      *  graph nodes (or NO_PATH). One byte per entry keeps this small
+      *  on tracks with many branches.  */
      PathToNodeVector  m_path_to_node;
 
      /** The direction for each of the successors. */
@@ -124,9 +128,6 @@ private:
       */
     std::vector< int > m_checkline_requirements;
 
-    void markAllSuccessorsToUse(unsigned int n,
-                                PathToNodeVector *m_path_to_node);
-
 public:
                  GraphNode(unsigned int quad_index, unsigned int node_index);
     void         addSuccessor (unsigned int to);
@@ -209,14 +210,15 @@ public:
     };
     // ------------------------------------------------------------------------
     /** Returns which successor node to use in order to be able to reach the
-     *  given node n.
+     *  given node n, or -1 if n can't be reached.
      *  \param n Index of the graph node to reach.
      */
     int getSuccessorToReach(unsigned int n)
     {
         // If we have a path to node vector, use its information, otherwise
         // (i.e. there is only one successor anyway) use this one successor.
-        return m_path_to_node.size()>0 ? m_path_to_node[n] : 0;
+        if(m_path_to_node.size()==0) return 0;
+        return m_path_to_node[n]==NO_PATH ? -1 : m_path_to_node[n];
     }   // getSuccesorToReach
     // ------------------------------------------------------------------------
     /** Returns the checkline requirements of this graph node. */
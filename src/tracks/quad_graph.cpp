@@ -31,6 +31,7 @@
 #include "tracks/check_lap.hpp"
 #include "tracks/check_line.hpp"
 #include "tracks/check_manager.hpp"
+#include "tracks/quad_grid.hpp"
 #include "tracks/quad_set.hpp"
 #include "tracks/track.hpp"
 
@@ -49,12 +50,15 @@ QuadGraph::QuadGraph(const std::string &quad_file_name,
     m_node                 = NULL;
     m_mesh                 = NULL;
     m_mesh_buffer          = NULL;
+    m_grid                 = NULL;
     m_lap_length           = 0;
     QuadSet::create();
     QuadSet::get()->init(quad_file_name);
     m_quad_filename        = quad_file_name;
     m_quad_graph           = this;
     load(graph_file_name);
+    createGrid();
+    computeNeighbourhoods();
 }   // QuadGraph
 
 // -----------------------------------------------------------------------------
@@ -65,6 +69,7 @@ QuadGraph::~QuadGraph()
     for(unsigned int i=0; i<m_all_nodes.size(); i++) {
         delete m_all_nodes[i];
     }
+    delete m_grid;
     if(UserConfigParams::m_track_debug)
         cleanupDebugMesh();
 }   // ~QuadGraph
@@ -199,6 +204,93 @@ void QuadGraph::load(const std::string &filename)
     }
 }   // load
 
+// ----------------------------------------------------------------------------
+/** Creates the 2d grid used to quickly find the graph nodes close to a
+ *  point. The bounding box of each node contains its quad and the line
+ *  used in getDistance2FromPoint, so the grid can be used by both
+ *  findRoadSector and findOutOfRoadSector.
+ */
+void QuadGraph::createGrid()
+{
+    std::vector<core::rectf> boxes;
+    boxes.reserve(m_all_nodes.size());
+    for(unsigned int i=0; i<m_all_nodes.size(); i++)
+    {
+        const Quad &q = getQuadOfNode(i);
+        core::rectf box(q[0].getX(), q[0].getZ(), q[0].getX(), q[0].getZ());
+        for(unsigned int j=1; j<4; j++)
+            box.addInternalPoint(q[j].getX(), q[j].getZ());
+        const GraphNode *node = m_all_nodes[i];
+        box.addInternalPoint(node->getLowerCenter().getX(),
+                             node->getLowerCenter().getZ());
+        box.addInternalPoint(node->getUpperCenter().getX(),
+                             node->getUpperCenter().getZ());
+        boxes.push_back(box);
+    }
+    m_grid = new QuadGrid(boxes);
+}   // createGrid
+
+// ----------------------------------------------------------------------------
+/** Determines for each graph node the nodes that can be reached within
+ *  NEIGHBOURHOOD_STEPS steps using successors or predecessors. This is
+ *  used by findOutOfRoadSector: a kart is very likely still close (in
+ *  the graph) to the node it was on in the previous frame, so only these
+ *  nodes need to be tested. Since the neighbourhood follows the actual
+ *  graph edges (and not the node indices), shortcuts and the crossing of
+ *  the lap line are handled correctly.
+ */
+void QuadGraph::computeNeighbourhoods()
+{
+    const unsigned int NEIGHBOURHOOD_STEPS = 10;
+    const unsigned int n = m_all_nodes.size();
+
+    m_neighbour_start.resize(n+1);
+    m_neighbour_nodes.clear();
+    m_neighbour_is_border.clear();
+
+    // Number of steps needed to reach a node, n+1 if not yet reached.
+    std::vector<unsigned int> steps(n, n+1);
+    std::vector<int> queue;
+    for(unsigned int i=0; i<n; i++)
+    {
+        m_neighbour_start[i] = m_neighbour_nodes.size();
+        queue.clear();
+        queue.push_back(i);
+        steps[i] = 0;
+        // Breadth first search, the queue contains all nodes found.
+        for(unsigned int current=0; current<queue.size(); current++)
+        {
+            const GraphNode *node = m_all_nodes[queue[current]];
+            const unsigned int s  = steps[queue[current]];
+            if(s==NEIGHBOURHOOD_STEPS) continue;
+            for(unsigned int j=0; j<node->getNumberOfSuccessors(); j++)
+            {
+                const int next = node->getSuccessor(j);
+                if(steps[next]<=n) continue;
+                steps[next] = s+1;
+                queue.push_back(next);
+            }
+            for(unsigned int j=0; j<node->getNumberOfPredecessors(); j++)
+            {
+                const int prev = node->getPredecessor(j);
+                if(steps[prev]<=n) continue;
+                steps[prev] = s+1;
+                queue.push_back(prev);
+            }
+        }   // for current<queue.size()
+
+        for(unsigned int j=0; j<queue.size(); j++)
+        {
+            m_neighbour_nodes.push_back(queue[j]);
+            m_neighbour_is_border.push_back(steps[queue[j]]
+                                            ==NEIGHBOURHOOD_STEPS);
+            // Reset for the next node
+            steps[queue[j]] = n+1;
+        }
+    }   // for i<n
+    m_neighbour_start[n] = m_neighbour_nodes.size();
+}   // computeNeighbourhoods
+
 // ----------------------------------------------------------------------------
 /** Returns the index of the first graph node (i.e. the graph node which
  *  will trigger a new lap when a kart first enters it). This is always
@@ -824,6 +916,39 @@ void QuadGraph::findRoadSector(const Vec3& xyz, int *sector,
                             ? all_sectors->size()
                             : m_all_nodes.size();
     *sector = UNKNOWN_SECTOR;
+
+    if(!all_sectors)
+    {
+        // Only the nodes in the grid cell of the point can contain the
+        // point. To get exactly the same result as testing all nodes
+        // starting with indx+1, a tie is resolved in favour of the node
+        // that would have been tested first.
+        int x, z;
+        if(!m_grid->getCell(xyz, &x, &z))
+            return;
+        const int first = indx+1;
+        const int n     = m_all_nodes.size();
+        int min_order   = n;
+        unsigned int count;
+        const unsigned int *content = m_grid->getCellContent(x, z, &count);
+        for(unsigned int i=0; i<count; i++)
+        {
+            const int node  = content[i];
+            const Quad &q   = getQuadOfNode(node);
+            float dist      = xyz.getY() - q.getMinHeight();
+            const int order = (node - first + n) % n;
+            if(dist>-1.0f && (dist<min_dist ||
+                              (dist==min_dist && order<min_order)) &&
+               q.pointInQuad(xyz))
+            {
+                min_dist  = dist;
+                min_order = order;
+                *sector   = node;
+            }
+        }   // for i<count
+        return;
+    }   // !all_sectors
+
     for(unsigned int i=0; i<max_count; i++)
     {
         if(all_sectors)
@@ -876,30 +1001,35 @@ int QuadGraph::findOutOfRoadSector(const Vec3& xyz,
                                    const int curr_sector,
                                    std::vector<int> *all_sectors) const
 {
-    int count = (all_sectors!=NULL) ? all_sectors->size() : getNumNodes();
-    int current_sector = 0;
-    if(curr_sector != UNKNOWN_SECTOR && !all_sectors)
+    if(!all_sectors)
     {
-        // We have to test all nodes here: reason is that on track with
-        // shortcuts the n quads of the main drivelines is followed by
-        // the quads of the shortcuts. So after quad n-1 (the last one
-        // before the lap counting line) quad n will not be 0 (the first
-        // quad after the lap counting line), but one of the quads on a
-        // shortcut. If we only tested a limited number of quads to
-        // improve the performance the crossing of a lap might not be
-        // detected (because quad 0 is not tested, only quads on the
-        // shortcuts are tested). If this should become a performance
-        // bottleneck, we need to set up a graph of 'next' quads for each
-        // quad (similar to what the AI does), and only test the quads
-        // in this graph.
-        const int LIMIT = getNumNodes();
-        count           = LIMIT;
-        // Start 10 quads before the current quad, so the quads closest
-        // to the current position are tested first.
-        current_sector  = curr_sector -10;
-        if(current_sector<0) current_sector += getNumNodes();
-    }
-
+        // On tracks with shortcuts the n quads of the main drivelines are
+        // followed by the quads of the shortcuts, so quad indices close to
+        // the current quad are not necessarily close on the track (e.g.
+        // quad 0 does not follow quad n-1). So first the nodes that are
+        // close in the graph to the previous sector are tested, which will
+        // nearly always contain the right sector (and correctly detects
+        // the crossing of the lap line).
+        int first = 1;
+        if(curr_sector != UNKNOWN_SECTOR)
+        {
+            int sector = findNeighbourSector(xyz, curr_sector);
+            if(sector!=UNKNOWN_SECTOR)
+                return sector;
+            // Test the quads closest to the current position first.
+            first = curr_sector - 9;
+            if(first<0) first += getNumNodes();
+        }
+        // Otherwise use the grid to find the closest node of all nodes.
+        int sector = findClosestSector(xyz, first, /*test_height*/true);
+        if(sector==UNKNOWN_SECTOR)
+            sector = findClosestSector(xyz, first, /*test_height*/false);
+        if(sector==UNKNOWN_SECTOR)
+            Log::info("Quad Grap", "unknown sector found.");
+        return sector;
+    }   // !all_sectors
+
+    const int count  = all_sectors->size();
     int   min_sector = UNKNOWN_SECTOR;
     float min_dist_2 = 999999.0f*999999.0f;
 
@@ -912,13 +1042,7 @@ int QuadGraph::findOutOfRoadSector(const Vec3& xyz,
     {
         for(int j=0; j<count; j++)
         {
-            int next_sector;
-            if(all_sectors)
-                next_sector = (*all_sectors)[j];
-            else
-                next_sector  = current_sector+1 == (int)getNumNodes()
-                ? 0
-                : current_sector+1;
+            const int next_sector = (*all_sectors)[j];
 
             // A first simple test uses the 2d distance to the center of the quad.
             float dist_2 = m_all_nodes[next_sector]->getDistance2FromPoint(xyz);
@@ -936,7 +1060,6 @@ int QuadGraph::findOutOfRoadSector(const Vec3& xyz,
                     min_sector = next_sector;
                 }
             }
-            current_sector = next_sector;
         }   // for j
         // Leave in phase 0 if any sector was found.
         if(min_sector!=UNKNOWN_SECTOR)
@@ -950,6 +1073,108 @@ int QuadGraph::findOutOfRoadSector(const Vec3& xyz,
     return min_sector;
 }   // findOutOfRoadSector
 
+//-----------------------------------------------------------------------------
+/** Finds the closest graph node to the given point, testing only the
+ *  neighbourhood of the given sector (see computeNeighbourhoods). If the
+ *  closest node is on the border of the neighbourhood, the point might
+ *  have moved out of the neighbourhood, and a closer node might exist
+ *  outside of it. In this case, or if no node is found (e.g. because of
+ *  the height test), UNKNOWN_SECTOR is returned, and the caller has to
+ *  test all nodes.
+ *  \param xyz The point.
+ *  \param curr_sector The sector the point was in previously.
+ */
+int QuadGraph::findNeighbourSector(const Vec3 &xyz, int curr_sector) const
+{
+    int   min_sector = UNKNOWN_SECTOR;
+    bool  is_border  = false;
+    float min_dist_2 = 999999.0f*999999.0f;
+    for(unsigned int i =m_neighbour_start[curr_sector];
+                     i<m_neighbour_start[curr_sector+1]; i++)
+    {
+        const int node = m_neighbour_nodes[i];
+        float dist_2   = m_all_nodes[node]->getDistance2FromPoint(xyz);
+        if(dist_2>=min_dist_2) continue;
+        const Quad &q = getQuadOfNode(node);
+        float dist    = xyz.getY() - q.getMinHeight();
+        if(dist>=5.0f || dist<=-1.0f) continue;
+        min_dist_2 = dist_2;
+        min_sector = node;
+        is_border  = m_neighbour_is_border[i];
+    }
+    return is_border ? UNKNOWN_SECTOR : min_sector;
+}   // findNeighbourSector
+
+//-----------------------------------------------------------------------------
+/** Finds the graph node with the closest 2d distance to the given point,
+ *  using the grid. Starting with the grid cell closest to the point, the
+ *  cells are searched in rings of increasing size, until no unsearched
+ *  cell can contain a closer node. If two nodes have the same distance,
+ *  the one coming first when testing all nodes in order starting from
+ *  first_sector is returned.
+ *  \param xyz The point.
+ *  \param first_sector The node which would be tested first.
+ *  \param test_height If true only nodes which are not too far above or
+ *         below the point are considered.
+ */
+int QuadGraph::findClosestSector(const Vec3 &xyz, int first_sector,
+                                 bool test_height) const
+{
+    const int n      = getNumNodes();
+    int   min_sector = UNKNOWN_SECTOR;
+    int   min_order  = n;
+    float min_dist_2 = 999999.0f*999999.0f;
+
+    int cx, cz;
+    m_grid->getClosestCell(xyz, &cx, &cz);
+    const int max_ring = m_grid->getMaxRing(cx, cz);
+    for(int ring=0; ring<=max_ring; ring++)
+    {
+        // All cells in this ring are at least (ring-1) cells away from
+        // the point. A small safety margin is used to allow for rounding
+        // errors in the distance computation.
+        if(min_sector!=UNKNOWN_SECTOR && ring>1)
+        {
+            float d = (ring-1)*m_grid->getCellSize()*0.99f;
+            if(min_dist_2 < d*d) break;
+        }
+        for(int z=cz-ring; z<=cz+ring; z++)
+        {
+            if(z<0 || z>=m_grid->getNumZ()) continue;
+            // Inside the ring only the first and last column are tested
+            const int step = (z==cz-ring || z==cz+ring) ? 1 : 2*ring;
+            for(int x=cx-ring; x<=cx+ring; x+=std::max(step, 1))
+            {
+                if(x<0 || x>=m_grid->getNumX()) continue;
+                unsigned int count;
+                const unsigned int *content =
+                    m_grid->getCellContent(x, z, &count);
+                for(unsigned int i=0; i<count; i++)
+                {
+                    const int node   = content[i];
+                    float     dist_2 =
+                        m_all_nodes[node]->getDistance2FromPoint(xyz);
+                    const int order  = (node - first_sector + n) % n;
+                    if(dist_2>min_dist_2 ||
+                       (dist_2==min_dist_2 && order>=min_order))
+                        continue;
+                    if(test_height)
+                    {
+                        const Quad &q = getQuadOfNode(node);
+                        float dist    = xyz.getY() - q.getMinHeight();
+                        if(dist>=5.0f || dist<=-1.0f) continue;
+                    }
+                    min_dist_2 = dist_2;
+                    min_sector = node;
+                    min_order  = order;
+                }   // for i < count
+            }   // for x
+        }   // for z
+    }   // for ring
+
+    return min_sector;
+}   // findClosestSector
+
 //-----------------------------------------------------------------------------
 /** Takes a snapshot of the driveline quads so they can be used as minimap.
  */
@@ -37,6 +37,7 @@ namespace irr
 using namespace irr;
 
 class CheckLine;
+class QuadGrid;
 
 /**
  *  \brief This class stores a graph of quads. It uses a 'simplified singleton'
@@ -78,6 +79,22 @@ private:
     /** Wether the graph should be reverted or not */
     bool                     m_reverse;
 
+    /** A 2d grid over all graph nodes, used to speed up findRoadSector
+     *  and findOutOfRoadSector. */
+    QuadGrid                *m_grid;
+
+    /** For each graph node the list of nodes that can be reached within
+     *  a few steps following successors or predecessors. The entries for
+     *  node i are m_neighbour_start[i] to m_neighbour_start[i+1]-1 of
+     *  m_neighbour_nodes. */
+    std::vector<unsigned int> m_neighbour_start;
+    std::vector<int>          m_neighbour_nodes;
+
+    /** True for each entry in m_neighbour_nodes if the node is on the
+     *  border of the neighbourhood, i.e. the maximum number of steps
+     *  away. */
+    std::vector<bool>         m_neighbour_is_border;
+
     void setDefaultSuccessors();
     void computeChecklineRequirements(GraphNode* node, int latest_checkline);
     void computeDirectionData();
@@ -85,6 +102,11 @@ private:
     float normalizeAngle(float f);
 
     void addSuccessor(unsigned int from, unsigned int to);
+    void createGrid();
+    void computeNeighbourhoods();
+    int  findNeighbourSector(const Vec3 &xyz, int curr_sector) const;
+    int  findClosestSector(const Vec3 &xyz, int first_sector,
+                           bool test_height) const;
     void load         (const std::string &filename);
     void computeDistanceFromStart(unsigned int start_node, float distance);
     void createMesh(bool show_invisible=true,
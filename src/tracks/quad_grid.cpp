@@ -0,0 +1,152 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2013 Joerg Henrichs
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#include "tracks/quad_grid.hpp"
+
+#include "utils/vec3.hpp"
+
+#include <algorithm>
+#include <math.h>
+
+/** Maximum number of cells in the grid, to limit memory usage for
+ *  large tracks with very small quads. */
+static const int MAX_CELLS = 256*256;
+
+// ----------------------------------------------------------------------------
+/** Creates the grid for the given boxes. The cell size is the average
+ *  size of the boxes, so that each box only overlaps a few cells.
+ *  \param boxes The 2d bounding boxes (X and Z coordinates).
+ */
+QuadGrid::QuadGrid(const std::vector<core::rectf> &boxes)
+{
+    m_min_x = m_min_z = 0;
+    float max_x = 0, max_z = 0;
+    float average_size = 0;
+    for(unsigned int i=0; i<boxes.size(); i++)
+    {
+        const core::rectf &b = boxes[i];
+        if(i==0 || b.UpperLeftCorner.X  < m_min_x)
+            m_min_x = b.UpperLeftCorner.X;
+        if(i==0 || b.UpperLeftCorner.Y  < m_min_z)
+            m_min_z = b.UpperLeftCorner.Y;
+        if(i==0 || b.LowerRightCorner.X > max_x)
+            max_x = b.LowerRightCorner.X;
+        if(i==0 || b.LowerRightCorner.Y > max_z)
+            max_z = b.LowerRightCorner.Y;
+        average_size += std::max(b.getWidth(), b.getHeight());
+    }
+    if(boxes.size()>0)
+        average_size /= boxes.size();
+
+    m_cell_size = std::max(average_size, 1.0f);
+    float cells = (max_x-m_min_x) * (max_z-m_min_z)
+                / (m_cell_size*m_cell_size);
+    if(cells > MAX_CELLS)
+        m_cell_size *= sqrtf(cells/MAX_CELLS);
+    m_inv_cell_size = 1.0f/m_cell_size;
+    m_num_x = std::max(1, (int)((max_x-m_min_x)*m_inv_cell_size)+1);
+    m_num_z = std::max(1, (int)((max_z-m_min_z)*m_inv_cell_size)+1);
+
+    // First count the number of entries for each cell, then store
+    // the actual indices.
+    std::vector<unsigned int> count(m_num_x*m_num_z, 0);
+    for(unsigned int i=0; i<boxes.size(); i++)
+    {
+        const core::rectf &b = boxes[i];
+        for(int z=getCellZ(b.UpperLeftCorner.Y);
+                z<=getCellZ(b.LowerRightCorner.Y); z++)
+            for(int x=getCellX(b.UpperLeftCorner.X);
+                    x<=getCellX(b.LowerRightCorner.X); x++)
+                count[z*m_num_x+x]++;
+    }
+
+    m_cell_start.resize(m_num_x*m_num_z+1);
+    m_cell_start[0] = 0;
+    for(unsigned int i=0; i<count.size(); i++)
+    {
+        m_cell_start[i+1] = m_cell_start[i]+count[i];
+        count[i] = m_cell_start[i];
+    }
+    m_cell_content.resize(m_cell_start.back());
+
+    for(unsigned int i=0; i<boxes.size(); i++)
+    {
+        const core::rectf &b = boxes[i];
+        for(int z=getCellZ(b.UpperLeftCorner.Y);
+                z<=getCellZ(b.LowerRightCorner.Y); z++)
+            for(int x=getCellX(b.UpperLeftCorner.X);
+                    x<=getCellX(b.LowerRightCorner.X); x++)
+                m_cell_content[count[z*m_num_x+x]++] = i;
+    }
+}   // QuadGrid
+
+// ----------------------------------------------------------------------------
+/** Returns the (clamped) cell index in X direction of a coordinate. */
+int QuadGrid::getCellX(float x) const
+{
+    int n = (int)floorf((x-m_min_x)*m_inv_cell_size);
+    return n<0 ? 0 : (n>=m_num_x ? m_num_x-1 : n);
+}   // getCellX
+
+// ----------------------------------------------------------------------------
+/** Returns the (clamped) cell index in Z direction of a coordinate. */
+int QuadGrid::getCellZ(float z) const
+{
+    int n = (int)floorf((z-m_min_z)*m_inv_cell_size);
+    return n<0 ? 0 : (n>=m_num_z ? m_num_z-1 : n);
+}   // getCellZ
+
+// ----------------------------------------------------------------------------
+/** Determines the cell a point is in.
+ *  \param xyz The point.
+ *  \param x, z On return the coordinates of the cell.
+ *  \return False if the point is outside of the grid (in which case it
+ *          can not be inside of any box).
+ */
+bool QuadGrid::getCell(const Vec3 &xyz, int *x, int *z) const
+{
+    float fx = floorf((xyz.getX()-m_min_x)*m_inv_cell_size);
+    float fz = floorf((xyz.getZ()-m_min_z)*m_inv_cell_size);
+    if(fx<0 || fz<0 || fx>=m_num_x || fz>=m_num_z)
+        return false;
+    *x = (int)fx;
+    *z = (int)fz;
+    return true;
+}   // getCell
+
+// ----------------------------------------------------------------------------
+/** Determines the cell closest to a point, i.e. the cell the point is in,
+ *  or the closest border cell if the point is outside of the grid.
+ *  \param xyz The point.
+ *  \param x, z On return the coordinates of the cell.
+ */
+void QuadGrid::getClosestCell(const Vec3 &xyz, int *x, int *z) const
+{
+    *x = getCellX(xyz.getX());
+    *z = getCellZ(xyz.getZ());
+}   // getClosestCell
+
+// ----------------------------------------------------------------------------
+/** Returns the number of rings around the given cell that are needed to
+ *  cover the whole grid.
+ *  \param x, z Coordinates of the cell.
+ */
+int QuadGrid::getMaxRing(int x, int z) const
+{
+    return std::max(std::max(x, m_num_x-1-x), std::max(z, m_num_z-1-z));
+}   // getMaxRing
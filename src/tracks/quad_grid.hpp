@@ -0,0 +1,87 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2013 Joerg Henrichs
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#ifndef HEADER_QUAD_GRID_HPP
+#define HEADER_QUAD_GRID_HPP
+
+#include "utils/no_copy.hpp"
+
+#include <rect.h>
+using namespace irr;
+
+#include <vector>
+
+class Vec3;
+
+/**
+ *  \brief A uniform 2d grid (in the XZ plane) over a set of axis aligned
+ *  boxes, used to quickly find the graph nodes that are close to a point.
+ *  Each box is added to all cells it overlaps. The content of all cells
+ *  is stored in one contiguous array to keep lookups cache friendly.
+ * \ingroup tracks
+ */
+class QuadGrid : public NoCopy
+{
+private:
+    /** Minimum X and Z coordinate covered by the grid. */
+    float m_min_x, m_min_z;
+
+    /** Size of a (square) cell, and its inverse. */
+    float m_cell_size, m_inv_cell_size;
+
+    /** Number of cells in X and Z direction. */
+    int   m_num_x, m_num_z;
+
+    /** Index of the first entry in m_cell_content for each cell. The
+     *  entries for cell i are m_cell_start[i] to m_cell_start[i+1]-1. */
+    std::vector<unsigned int> m_cell_start;
+
+    /** The indices of the boxes that overlap each cell. */
+    std::vector<unsigned int> m_cell_content;
+
+    int getCellX(float x) const;
+    int getCellZ(float z) const;
+
+public:
+         QuadGrid(const std::vector<core::rectf> &boxes);
+    bool getCell(const Vec3 &xyz, int *x, int *z) const;
+    void getClosestCell(const Vec3 &xyz, int *x, int *z) const;
+    int  getMaxRing(int x, int z) const;
+    // ------------------------------------------------------------------------
+    /** Returns the number of cells in X direction. */
+    int  getNumX() const { return m_num_x; }
+    // ------------------------------------------------------------------------
+    /** Returns the number of cells in Z direction. */
+    int  getNumZ() const { return m_num_z; }
+    // ------------------------------------------------------------------------
+    /** Returns the size of a cell. */
+    float getCellSize() const { return m_cell_size; }
+    // ------------------------------------------------------------------------
+    /** Returns the indices of all boxes overlapping a cell.
+     *  \param x, z Coordinates of the cell.
+     *  \param count On return the number of entries. */
+    const unsigned int *getCellContent(int x, int z,
+                                       unsigned int *count) const
+    {
+        const int n = z*m_num_x + x;
+        *count = m_cell_start[n+1] - m_cell_start[n];
+        return *count>0 ? &m_cell_content[m_cell_start[n]] : NULL;
+    }   // getCellContent
+};   // QuadGrid
+
+#endif
@@ -30,8 +30,9 @@
  */
 TerrainInfo::TerrainInfo()
 {
-    m_last_material = NULL;
-    m_material      = NULL;
+    m_last_material  = NULL;
+    m_material       = NULL;
+    m_has_prediction = false;
 }   // TerrainInfo
 
 //-----------------------------------------------------------------------------
@@ -40,6 +41,7 @@ TerrainInfo::TerrainInfo()
  */
 TerrainInfo::TerrainInfo(const Vec3 &pos)
 {
+    m_has_prediction = false;
     // initialise HoT
     update(pos);
 }   // TerrainInfo
@@ -50,6 +52,22 @@ TerrainInfo::TerrainInfo(const Vec3 &pos)
 void TerrainInfo::update(const Vec3& pos)
 {
     m_last_material = m_material;
+
+    // Use the result of predict() if it was cast from exactly the same
+    // position. A miss is cast again, since castRay then leaves the hit
+    // point unchanged.
+    if(m_has_prediction && pos.getX()==m_predicted_pos.getX() &&
+       pos.getY()==m_predicted_pos.getY() &&
+       pos.getZ()==m_predicted_pos.getZ()                         )
+    {
+        m_has_prediction = false;
+        m_hit_point      = m_predicted_hit_point;
+        m_material       = m_predicted_material;
+        m_normal         = m_predicted_normal;
+        return;
+    }
+    m_has_prediction = false;
+
     btVector3 to(pos);
     to.setY(-100000.f);
 
@@ -57,6 +75,24 @@ void TerrainInfo::update(const Vec3& pos)
     tm.castRay(pos, to, &m_hit_point, &m_material, &m_normal);
 }   // update
 
+//-----------------------------------------------------------------------------
+/** Casts the ray of a following update() in advance. update() uses this
+ *  result if it is called with the same position, otherwise it casts its
+ *  own ray. This only reads the track mesh and only modifies the
+ *  prediction, so it can be called for several objects in parallel.
+ *  \param pos Position from which update() is expected to cast its ray.
+ */
+void TerrainInfo::predict(const Vec3& pos)
+{
+    btVector3 to(pos);
+    to.setY(-100000.f);
+
+    const TriangleMesh &tm = World::getWorld()->getTrack()->getTriangleMesh();
+    m_predicted_pos  = pos;
+    m_has_prediction = tm.castRay(pos, to, &m_predicted_hit_point,
+                                  &m_predicted_material, &m_predicted_normal);
+}   // predict
+
 // -----------------------------------------------------------------------------
 /** Does a raycast upwards from the given position
 If the raycast indicated that the kart is 'under something' (i.e. a
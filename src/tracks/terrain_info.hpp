@@ -39,12 +39,23 @@ private:
     /** The point that was hit. */
     Vec3              m_hit_point;
 
+    /** True if predict() hit the terrain from m_predicted_pos, and
+     *  the following m_predicted_* values can be used by update(). */
+    bool              m_has_prediction;
+    /** The position from which predict() cast its ray. */
+    Vec3              m_predicted_pos;
+    /** Normal, material and hit point found by predict(). */
+    Vec3              m_predicted_normal;
+    const Material   *m_predicted_material;
+    Vec3              m_predicted_hit_point;
+
 public:
              TerrainInfo();
              TerrainInfo(const Vec3 &pos);
     virtual ~TerrainInfo() {};
 
     virtual void update(const Vec3 &pos);
+    void     predict(const Vec3 &pos);
     bool     getSurfaceInfo(const Vec3 &from, Vec3 *position,
                             const Material **m);
 
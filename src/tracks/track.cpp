@@ -42,8 +42,10 @@ using namespace irr;
 #include "graphics/particle_emitter.hpp"
 #include "graphics/particle_kind.hpp"
 #include "graphics/particle_kind_manager.hpp"
+#include "guiengine/engine.hpp"
 #include "guiengine/scalable_font.hpp"
 #include "io/file_manager.hpp"
+#include "io/file_prefetcher.hpp"
 #include "io/xml_node.hpp"
 #include "items/item.hpp"
 #include "items/item_manager.hpp"
@@ -67,6 +69,7 @@ using namespace irr;
 #include "utils/log.hpp"
 #include "utils/string_utils.hpp"
 #include "utils/translation.hpp"
+#include "utils/worker_pool.hpp"
 
 #include <ISceneManager.h>
 #include <IMeshSceneNode.h>
@@ -77,13 +80,22 @@ using namespace irr;
 const float Track::NOHIT           = -99999.9f;
 
 // ----------------------------------------------------------------------------
-Track::Track(const std::string &filename)
+/** Creates a track. Normally the track.xml file is loaded immediately, but
+ *  if the metadata index contains the fields of this track (see
+ *  getMetadata), only these are set, and the track.xml file is loaded
+ *  when the track model is loaded.
+ *  \param filename Full path of the track.xml file.
+ *  \param metadata The cached fields of this track, or NULL.
+ */
+Track::Track(const std::string &filename,
+             const MetadataIndex::Fields *metadata)
 {
 #ifdef DEBUG
     m_magic_number          = 0x17AC3802;
 #endif
 
     m_materials_loaded      = false;
+    m_info_loaded           = false;
     m_filename              = filename;
     m_root                  =
         StringUtils::getPath(StringUtils::removeExtension(m_filename));
@@ -102,6 +114,7 @@ Track::Track(const std::string &filename)
     m_version               = 0;
     m_track_mesh            = NULL;
     m_gfx_effect_mesh       = NULL;
+    m_height_map_mode       = 0;
     m_internal              = false;
     m_enable_auto_rescue    = true;  // Below set to false in arenas
     m_enable_push_back      = true;
@@ -123,7 +136,25 @@ Track::Track(const std::string &filename)
     m_all_nodes.clear();
     m_all_physics_only_nodes.clear();
     m_all_cached_meshes.clear();
-    loadTrackInfo();
+    if(!metadata)
+    {
+        loadTrackInfo();
+        return;
+    }
+
+    // Only set the values needed in the menus (see getMetadata)
+    MetadataIndex::Fields fields = *metadata;
+    m_name              = fields["name"];
+    m_designer          = StringUtils::decodeFromHtmlEntities(
+                                                        fields["designer"]);
+    m_version           = atoi(fields["version"].c_str());
+    m_screenshot        = fields["screenshot"];
+    m_groups            = StringUtils::split(fields["groups"], ' ');
+    m_is_arena          = fields["arena"]=="1";
+    m_is_soccer         = fields["soccer"]=="1";
+    m_internal          = fields["internal"]=="1";
+    m_reverse_available = fields["reverse"]=="1";
+    m_has_easter_eggs   = file_manager->fileExists(m_root+"easter_eggs.xml");
 }   // Track
 
 //-----------------------------------------------------------------------------
@@ -139,6 +170,39 @@ Track::~Track()
 #endif
 }   // ~Track
 
+//-----------------------------------------------------------------------------
+/** Returns the fields of this track which are needed in the menus, so that
+ *  they can be stored in the metadata index, and the track can later be
+ *  created without loading the track.xml file.
+ *  \param metadata On return contains the fields of this track.
+ */
+void Track::getMetadata(MetadataIndex::Fields *metadata) const
+{
+    // Non ASCII characters and '&' are encoded like in track.xml
+    std::ostringstream designer;
+    for(unsigned int i=0; i<m_designer.size(); i++)
+    {
+        if(m_designer[i]<128 && m_designer[i]!='&')
+            designer << (char)m_designer[i];
+        else
+            designer << "&#x" << std::hex << std::uppercase
+                     << (unsigned int)m_designer[i] << ";" << std::dec;
+    }
+
+    (*metadata)["name"      ] = m_name;
+    (*metadata)["designer"  ] = designer.str();
+    (*metadata)["version"   ] = StringUtils::toString(m_version);
+    (*metadata)["screenshot"] = m_screenshot;
+    std::string groups;
+    for(unsigned int i=0; i<m_groups.size(); i++)
+        groups += (i==0 ? "" : " ") + m_groups[i];
+    (*metadata)["groups"    ] = groups;
+    (*metadata)["arena"     ] = m_is_arena          ? "1" : "0";
+    (*metadata)["soccer"    ] = m_is_soccer         ? "1" : "0";
+    (*metadata)["internal"  ] = m_internal          ? "1" : "0";
+    (*metadata)["reverse"   ] = m_reverse_available ? "1" : "0";
+}   // getMetadata
+
 //-----------------------------------------------------------------------------
 /** Removes all cached data structures. This is called before the resolution
  *  is changed.
@@ -257,6 +321,7 @@ void Track::cleanup()
         // remove temporary materials loaded by the material manager
         material_manager->popTempMaterial();
     }
+    irr_driver->releasePreloadedTextures(&m_preloaded_textures);
 
     if(UserConfigParams::logMemory())
     {
@@ -328,6 +393,7 @@ void Track::loadTrackInfo()
         o<<"Can't load track '"<<m_filename<<"', no track element.";
         throw std::runtime_error(o.str());
     }
+    m_info_loaded = true;
     root->get("name",                  &m_name);
 
     std::string designer;
@@ -506,6 +572,82 @@ void Track::loadQuadGraph(unsigned int mode_id, const bool reverse)
         }
     }
 }   // loadQuadGraph
+
+// ----------------------------------------------------------------------------
+/** Collects the models and textures referenced by a node of the scene file
+ *  and all its children (in the order in which they are loaded).
+ *  \param node The node of the scene file.
+ *  \param dir The track directory.
+ *  \param models The models are appended to this vector.
+ *  \param textures The textures are appended to this vector.
+ */
+static void collectSceneFiles(const XMLNode &node, const std::string &dir,
+                              std::vector<std::string> *models,
+                              std::vector<std::string> *textures)
+{
+    std::string model;
+    if(node.get("model", &model))
+        models->push_back(dir+model);
+    // E.g. the six textures of a sky box
+    std::vector<std::string> names;
+    node.get("texture", &names);
+    for(unsigned int i=0; i<names.size(); i++)
+        textures->push_back(dir+names[i]);
+
+    for(unsigned int i=0; i<node.getNumNodes(); i++)
+        collectSceneFiles(*node.getNode(i), dir, models, textures);
+}   // collectSceneFiles
+
+// ----------------------------------------------------------------------------
+/** Collects the files of this track which are loaded with the track model:
+ *  the models referenced by the scene file (in the order they are loaded,
+ *  starting with the main track), and the textures referenced by the scene
+ *  file and the track's materials.xml file. Other files in the track
+ *  directory (e.g. music) are not included. Textures which are not in the
+ *  track directory don't exist with the resulting name.
+ *  \param root The root node of the scene file.
+ *  \param materials The root node of the materials.xml file of the track,
+ *         or NULL if the track has none.
+ *  \param models The models are appended to this vector.
+ *  \param textures The textures are appended to this vector.
+ */
+void Track::collectFiles(const XMLNode &root, const XMLNode *materials,
+                         std::vector<std::string> *models,
+                         std::vector<std::string> *textures) const
+{
+    const XMLNode *track_node = root.getNode("track");
+    if(track_node)
+        collectSceneFiles(*track_node, m_root, models, textures);
+    for(unsigned int i=0; i<root.getNumNodes(); i++)
+    {
+        const XMLNode *node = root.getNode(i);
+        if(node!=track_node)
+            collectSceneFiles(*node, m_root, models, textures);
+    }
+
+    // The attributes of a material which name a texture
+    static const char *texture_attributes[] =
+    {
+        "name", "mask", "normal-map", "normal-light-map", "normal-heightmap",
+        "parallax-map", "parallax-heightmap", "splatting-texture-1",
+        "splatting-texture-2", "splatting-texture-3", "splatting-texture-4",
+        "splatting-lightmap"
+    };
+    if(materials)
+    {
+        for(unsigned int i=0; i<materials->getNumNodes(); i++)
+        {
+            const XMLNode *material = materials->getNode(i);
+            for(unsigned int j=0; j<sizeof(texture_attributes)/sizeof(char*);
+                j++)
+            {
+                std::string texture;
+                if(material->get(texture_attributes[j], &texture))
+                    textures->push_back(m_root+texture);
+            }
+        }
+    }
+}   // collectFiles
 // -----------------------------------------------------------------------------
 void Track::mapPoint2MiniMap(const Vec3 &xyz, Vec3 *draw_at) const
 {
@@ -542,8 +684,36 @@ void Track::createPhysicsModel(unsigned int main_track_count)
     {
         convertTrackToBullet(m_all_nodes[i]);
     }
-    m_track_mesh->createPhysicalBody();
-    m_gfx_effect_mesh->createCollisionShape();
+
+    /** Builds (or loads from the cache) the bvh of one of the two meshes. */
+    class BvhJob : public WorkerPool::Job
+    {
+    public:
+        TriangleMesh *m_meshes[2];
+        std::string   m_bvh_caches[2];
+        // --------------------------------------------------------------------
+        virtual void run(unsigned int i)
+        {
+            // The track mesh gets a rigid body below instead of a
+            // collision object
+            m_meshes[i]->createCollisionShape(
+                                      /*create_collision_object*/i==1,
+                                      m_bvh_caches[i]);
+        }   // run
+    };   // BvhJob
+
+    // The bvh of the track meshes is expensive to build for big tracks,
+    // so it is cached between runs. The two meshes are independent, so
+    // their bvhs are built in parallel, only the rigid body must be added
+    // to the physics world in this thread.
+    const std::string cache = file_manager->getCachedDataDir()+"bvh-"+m_ident;
+    BvhJob job;
+    job.m_meshes[0]     = m_track_mesh;
+    job.m_meshes[1]     = m_gfx_effect_mesh;
+    job.m_bvh_caches[0] = cache+"-track";
+    job.m_bvh_caches[1] = cache+"-gfx";
+    WorkerPool::execute(&job, 2);
+    m_track_mesh->createRigidBody((btCollisionObject::CollisionFlags)0);
 }   // createPhysicsModel
 
 // -----------------------------------------------------------------------------
@@ -742,8 +912,9 @@ bool Track::loadMainTrack(const XMLNode &root)
     m_challenges.clear();
     m_force_fields.clear();
 
-    m_track_mesh      = new TriangleMesh();
-    m_gfx_effect_mesh = new TriangleMesh();
+    // The track meshes are big, so use quantized aabb compression
+    m_track_mesh      = new TriangleMesh(/*quantized*/true);
+    m_gfx_effect_mesh = new TriangleMesh(/*quantized*/true);
 
     const XMLNode *track_node= root.getNode("track");
     std::string model_name;
@@ -1167,7 +1338,8 @@ bool Track::loadMainTrack(const XMLNode &root)
         Log::fatal("track", "m_track_mesh == NULL, cannot loadMainTrack\n");
     }
 
-    m_gfx_effect_mesh->createCollisionShape();
+    // Note that the collision shapes are only created in createPhysicsModel,
+    // once all objects are converted.
     scene_node->setMaterialFlag(video::EMF_LIGHTING, true);
     scene_node->setMaterialFlag(video::EMF_GOURAUD_SHADING, true);
 
@@ -1338,12 +1510,24 @@ void Track::createWater(const XMLNode &node)
  */
 void Track::loadTrackModel(bool reverse_track, unsigned int mode_id)
 {
+    // A track created from the metadata index has not loaded its
+    // track.xml file yet.
+    if(!m_info_loaded)
+        loadTrackInfo();
+
     if(!m_reverse_available)
     {
         reverse_track = false;
     }
     CheckManager::create();
     assert(m_all_cached_meshes.size()==0);
+    // A different mode might use a different scene, so the cached height
+    // map can't be used anymore.
+    if(mode_id!=m_height_map_mode)
+    {
+        m_height_map.clear();
+        m_height_map_mode = mode_id;
+    }
     if(UserConfigParams::logMemory())
     {
         Log::debug("[memory] Before loading '%s': mesh cache %d "
@@ -1378,38 +1562,93 @@ void Track::loadTrackModel(bool reverse_track, unsigned int mode_id)
     // Add the track directory to the texture search path
     file_manager->pushTextureSearchPath(m_root);
     file_manager->pushModelSearchPath  (m_root);
+
+    /** Parses one xml file of the track. */
+    class ParseJob : public WorkerPool::Job
+    {
+    public:
+        std::string m_files[2];
+        XMLNode    *m_roots[2];
+        // --------------------------------------------------------------------
+        virtual void run(unsigned int i)
+        {
+            m_roots[i] = file_manager->fileExists(m_files[i])
+                       ? file_manager->createXMLTree(m_files[i])
+                       : NULL;
+        }   // run
+    };   // ParseJob
+
+    // Start building the scene graph. The scene file and the materials
+    // of the track are parsed in parallel.
+    std::string path = m_root+m_all_modes[mode_id].m_scene;
+    const std::string materials_file = m_root+"materials.xml";
+    ParseJob parse_job;
+    parse_job.m_files[0] = path;
+    parse_job.m_files[1] = materials_file;
+    WorkerPool::execute(&parse_job, 2);
+    XMLNode *root      = parse_job.m_roots[0];
+    XMLNode *materials = parse_job.m_roots[1];
+
+    // Make sure that we have a track (which is used for raycasts to
+    // place other objects).
+    if(!root || root->getName()!="scene")
+    {
+        delete root;
+        delete materials;
+        std::ostringstream msg;
+        msg<< "No track model defined in '"<<path
+           <<"', aborting.";
+        throw std::runtime_error(msg.str());
+    }
+
+    // Read the models of the track in a separate thread while the textures
+    // are decoded and the main thread loads them (the prefetcher is
+    // stopped when leaving this function).
+    std::vector<std::string> models, textures;
+    collectFiles(*root, materials, &models, &textures);
+    FilePrefetcher prefetcher;
+    for(unsigned int i=0; i<models.size(); i++)
+        prefetcher.add(models[i]);
+
+    // Decode the textures of the track in parallel. The materials and meshes
+    // loaded below then find the textures in irrlicht's texture cache.
+    // Cached tracks keep their materials, so their textures are not
+    // preloaded (they would never be released), only prefetched.
+    if(m_cache_track)
+    {
+        for(unsigned int i=0; i<textures.size(); i++)
+            prefetcher.add(textures[i]);
+    }
+    else
+    {
+        // Textures which are not in the track directory are found in the
+        // texture search path when they are loaded.
+        std::vector<std::string> images;
+        for(unsigned int i=0; i<textures.size(); i++)
+        {
+            if(file_manager->fileExists(textures[i]))
+                images.push_back(textures[i]);
+        }
+        irr_driver->preloadTextures(images, &m_preloaded_textures);
+    }
     // First read the temporary materials.dat file if it exists
     try
     {
-        std::string materials_file = m_root+"materials.xml";
         if(m_cache_track)
         {
             if(!m_materials_loaded)
                 material_manager->addSharedMaterial(materials_file);
             m_materials_loaded = true;
         }
-        else
-            material_manager->pushTempMaterial(materials_file);
+        else if(materials && materials->getName()=="materials")
+            material_manager->pushTempMaterial(materials, materials_file);
     }
     catch (std::exception& e)
     {
         // no temporary materials.dat file, ignore
         (void)e;
     }
-
-    // Start building the scene graph
-    std::string path = m_root+m_all_modes[mode_id].m_scene;
-    XMLNode *root    = file_manager->createXMLTree(path);
-
-    // Make sure that we have a track (which is used for raycasts to
-    // place other objects).
-    if(!root || root->getName()!="scene")
-    {
-        std::ostringstream msg;
-        msg<< "No track model defined in '"<<path
-           <<"', aborting.";
-        throw std::runtime_error(msg.str());
-    }
+    delete materials;
 
     // Load the graph only now: this function is called from world, after
     // the race gui was created. The race gui is needed since it stores
@@ -1460,13 +1699,16 @@ void Track::loadTrackModel(bool reverse_track, unsigned int mode_id)
         node->get("fog-end",       &m_fog_end);
     }
 
+    GUIEngine::setLoadingProgress(0.1f);
     loadMainTrack(*root);
     unsigned int main_track_count = m_all_nodes.size();
+    GUIEngine::setLoadingProgress(0.4f);
 
     LodNodeLoader lod_loader;
 
     for(unsigned int i=0; i<root->getNumNodes(); i++)
     {
+        GUIEngine::setLoadingProgress(0.4f + 0.4f*i/root->getNumNodes());
         const XMLNode *node = root->getNode(i);
         const std::string name = node->getName();
         // The track object was already converted before the loop, and the
@@ -1628,6 +1870,7 @@ void Track::loadTrackModel(bool reverse_track, unsigned int mode_id)
 
     // Init all track objects
     m_track_object_manager->init();
+    GUIEngine::setLoadingProgress(0.85f);
 
 
     // ---- Fog
@@ -1714,6 +1957,7 @@ void Track::loadTrackModel(bool reverse_track, unsigned int mode_id)
 
 
     createPhysicsModel(main_track_count);
+    GUIEngine::setLoadingProgress(0.95f);
 
 
     for(unsigned int i=0; i<root->getNumNodes(); i++)
@@ -2002,42 +2246,65 @@ bool Track::setTerrainHeight(Vec3 *pos) const
 
 // ----------------------------------------------------------------------------
 
-std::vector< std::vector<float> > Track::buildHeightMap()
+/** Returns the height map of the track, which is used to let particles
+ *  (e.g. snow) collide with the track. It contains the height of the track
+ *  on a regular grid of HEIGHT_MAP_RESOLUTION x HEIGHT_MAP_RESOLUTION points
+ *  covering the AABB of the track, stored in one contiguous array: the
+ *  height at (i,j) is at index i*HEIGHT_MAP_RESOLUTION+j, with i the index
+ *  in X and j the index in Z direction. If no track is hit at a point,
+ *  the minimum Y coordinate of the track is used.
+ *  The height map is only built the first time it is needed, and then kept
+ *  across races (the track geometry does not change). Building it casts
+ *  one ray for each point, the rows are done in parallel by the worker
+ *  pool.
+ */
+const std::vector<float>& Track::getHeightMap()
 {
-    std::vector< std::vector<float> > out(HEIGHT_MAP_RESOLUTION);
-
-    float x = m_aabb_min.getX();
-    const float x_len = m_aabb_max.getX() - m_aabb_min.getX();
-    const float z_len = m_aabb_max.getZ() - m_aabb_min.getZ();
-
-    const float x_step = x_len/HEIGHT_MAP_RESOLUTION;
-    const float z_step = z_len/HEIGHT_MAP_RESOLUTION;
-
-    btVector3 hitpoint;
-    const Material* material;
-    btVector3 normal;
-
-    for (int i=0; i<HEIGHT_MAP_RESOLUTION; i++)
-    {
-        out[i].resize(HEIGHT_MAP_RESOLUTION);
-        float z = m_aabb_min.getZ();
-
-        for (int j=0; j<HEIGHT_MAP_RESOLUTION; j++)
+    if(m_height_map.size()>0)
+        return m_height_map;
+
+    /** Casts the rays for one row (constant X) of the height map. */
+    class HeightMapRowJob : public WorkerPool::Job
+    {
+    public:
+        const TriangleMesh *m_mesh;
+        Vec3                m_min;
+        float               m_x_step, m_z_step;
+        float              *m_out;
+        virtual void run(unsigned int i)
         {
-            btVector3 pos(x, 100.0f, z);
-            btVector3 to = pos;
-            to.setY(-100000.f);
-
-            m_track_mesh->castRay(pos, to, &hitpoint, &material, &normal);
-            z += z_step;
-
-            out[i][j] = hitpoint.getY();
-        }   // j<HEIGHT_MAP_RESOLUTION
-        x += x_step;
-    }
-
-    return out;
-}
+            btVector3 hitpoint;
+            const Material *material;
+            btVector3 normal;
+            const float x = m_min.getX() + i*m_x_step;
+            float *row = m_out + i*HEIGHT_MAP_RESOLUTION;
+            for (int j=0; j<HEIGHT_MAP_RESOLUTION; j++)
+            {
+                btVector3 pos(x, 100.0f, m_min.getZ() + j*m_z_step);
+                btVector3 to = pos;
+                to.setY(-100000.f);
+                if(m_mesh->castRay(pos, to, &hitpoint, &material, &normal))
+                    row[j] = hitpoint.getY();
+                else
+                    row[j] = m_min.getY();
+            }   // j<HEIGHT_MAP_RESOLUTION
+        }   // run
+    };   // HeightMapRowJob
+
+    m_height_map.resize(HEIGHT_MAP_RESOLUTION*HEIGHT_MAP_RESOLUTION);
+
+    HeightMapRowJob job;
+    job.m_mesh   = m_track_mesh;
+    job.m_min    = m_aabb_min;
+    job.m_x_step = (m_aabb_max.getX() - m_aabb_min.getX())
+                 / HEIGHT_MAP_RESOLUTION;
+    job.m_z_step = (m_aabb_max.getZ() - m_aabb_min.getZ())
+                 / HEIGHT_MAP_RESOLUTION;
+    job.m_out    = &(m_height_map[0]);
+    WorkerPool::get()->run(&job, HEIGHT_MAP_RESOLUTION);
+
+    return m_height_map;
+}   // getHeightMap
 
 // ----------------------------------------------------------------------------
 /** Returns the rotation of the sun. */
@@ -37,6 +37,7 @@ using namespace irr;
 #include "LinearMath/btTransform.h"
 
 #include "graphics/material.hpp"
+#include "io/metadata_index.hpp"
 #include "items/item.hpp"
 #include "tracks/quad_graph.hpp"
 #include "utils/aligned_array.hpp"
@@ -200,6 +201,10 @@ private:
      * for the overworld to keep its textures loaded. */
     bool m_materials_loaded;
 
+    /** True if the track.xml file was loaded. A track created from the
+     *  metadata index only loads it when the track model is loaded. */
+    bool m_info_loaded;
+
     /** True if this track (textures and track data) should be cached. Used
      *  for the overworld. */
     bool m_cache_track;
@@ -232,6 +237,15 @@ private:
     Vec3                     m_aabb_min;
     /** Maximum coordinates of this track. */
     Vec3                     m_aabb_max;
+    /** The height map of the track (see getHeightMap), cached across
+     *  races. Empty if it was not built yet. */
+    std::vector<float>       m_height_map;
+    /** The mode for which the height map was built (different modes
+     *  can use a different scene, and therefore different heights). */
+    unsigned int             m_height_map_mode;
+    /** Textures of this track loaded by IrrDriver::preloadTextures, which
+     *  are released when the track is cleaned up. */
+    std::vector<video::ITexture*> m_preloaded_textures;
     /** True if this track is an arena. */
     bool                     m_is_arena;
     /** True if this track has easter eggs. */
@@ -377,6 +391,9 @@ private:
                              std::vector<MusicInformation*>& m_music   );
     void loadCurves(const XMLNode &node);
     void handleSky(const XMLNode &root, const std::string &filename);
+    void collectFiles(const XMLNode &root, const XMLNode *materials,
+                      std::vector<std::string> *models,
+                      std::vector<std::string> *textures) const;
 
 public:
 
@@ -385,8 +402,11 @@ public:
 
     static const float NOHIT;
 
-                       Track             (const std::string &filename);
+                       Track             (const std::string &filename,
+                                const MetadataIndex::Fields *metadata=NULL);
                       ~Track             ();
+    void               getMetadata       (MetadataIndex::Fields *metadata)
+                                                                        const;
     void               cleanup           ();
     void               removeCachedData  ();
     void               startMusic        () const;
@@ -410,7 +430,7 @@ public:
                                         unsigned int mode_id=0);
     bool findGround(AbstractKart *kart);
 
-    std::vector< std::vector<float> > buildHeightMap();
+    const std::vector<float>& getHeightMap();
     // ------------------------------------------------------------------------
     /** Returns the texture with the mini map for this track. */
     const video::ITexture*    getMiniMap    () const { return m_mini_map; }
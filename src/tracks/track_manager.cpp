@@ -27,7 +27,9 @@
 #include "audio/music_manager.hpp"
 #include "config/stk_config.hpp"
 #include "io/file_manager.hpp"
+#include "io/metadata_index.hpp"
 #include "tracks/track.hpp"
+#include "utils/log.hpp"
 
 TrackManager* track_manager = 0;
 std::vector<std::string>  TrackManager::m_track_search_path;
@@ -166,18 +168,41 @@ bool TrackManager::loadTrack(const std::string& dirname)
     if(!file_manager->fileExists(config_file))
         return false;
 
+    // Don't parse the track again if it could not be used in a previous
+    // run, and no file in its directory was modified since then. A usable
+    // track is created from the cached fields without parsing track.xml.
+    int version;
+    MetadataIndex::Fields fields;
+    const bool cached = MetadataIndex::get()->get(dirname, &version, &fields);
+    if(cached &&
+       (version==MetadataIndex::LOAD_FAILED                 ||
+        version<stk_config->m_min_track_version             ||
+        version>stk_config->m_max_track_version               ) )
+    {
+        Log::verbose("TrackManager", "Skipping unusable track '%s'.",
+                     dirname.c_str());
+        return false;
+    }
+
     Track *track;
 
     try
     {
-        track = new Track(config_file);
+        track = new Track(config_file, cached ? &fields : NULL);
     }
     catch (std::exception& e)
     {
         fprintf(stderr, "[TrackManager] ERROR: Cannot load track <%s> : %s\n",
                 dirname.c_str(), e.what());
+        MetadataIndex::get()->set(dirname, MetadataIndex::LOAD_FAILED);
         return false;
     }
+    if(!cached)
+    {
+        fields.clear();
+        track->getMetadata(&fields);
+        MetadataIndex::get()->set(dirname, track->getVersion(), fields);
+    }
 
     if (track->getVersion()<stk_config->m_min_track_version ||
         track->getVersion()>stk_config->m_max_track_version)
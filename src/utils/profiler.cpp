@@ -20,6 +20,7 @@
 #include "guiengine/event_handler.hpp"
 #include "guiengine/engine.hpp"
 #include "guiengine/scalable_font.hpp"
+#include "utils/time.hpp"
 #include <assert.h>
 #include <stack>
 #include <sstream>
@@ -35,38 +36,12 @@ Profiler profiler;
 
 #define TIME_DRAWN_MS 30.0f // the width of the profiler corresponds to TIME_DRAWN_MS milliseconds
 
-// --- Begin portable precise timer ---
-#ifdef WIN32
-    #include <windows.h>
-
-    static double _getTimeMilliseconds()
-    {
-        LARGE_INTEGER freq;
-        QueryPerformanceFrequency(&freq);
-        double perFreq = double(freq.QuadPart) / 1000.0;
-
-        LARGE_INTEGER timer;
-        QueryPerformanceCounter(&timer);
-        return double(timer.QuadPart) / perFreq;
-    }
-
-#else
-    #include <sys/time.h>
-    static double _getTimeMilliseconds()
-    {
-        struct timeval tv;
-        gettimeofday(&tv, NULL);
-        return double(tv.tv_sec * 1000) + (double(tv.tv_usec) / 1000.0);
-    }
-#endif
-// --- End portable precise timer ---
-
 //-----------------------------------------------------------------------------
 Profiler::Profiler()
 {
     m_thread_infos.resize(1);	// TODO: monothread now, should support multithreading
     m_write_id = 0;
-    m_time_last_sync = _getTimeMilliseconds();
+    m_time_last_sync = StkTime::getPreciseTimeMs();
     m_time_between_sync = 0.0;
     m_freeze_state = UNFROZEN;
 }
@@ -86,7 +61,7 @@ void Profiler::pushCpuMarker(const char* name, const video::SColor& color)
 
     ThreadInfo& ti = getThreadInfo();
     MarkerStack& markers_stack = ti.markers_stack[m_write_id];
-    double  start = _getTimeMilliseconds() - m_time_last_sync;
+    double  start = StkTime::getPreciseTimeMs() - m_time_last_sync;
     size_t  layer = markers_stack.size();
 
     // Add to the stack of current markers
@@ -109,7 +84,7 @@ void Profiler::popCpuMarker()
 
     // Update the date of end of the marker
     Marker&     marker = markers_stack.top();
-    marker.end = _getTimeMilliseconds() - m_time_last_sync;
+    marker.end = StkTime::getPreciseTimeMs() - m_time_last_sync;
 
     // Remove the marker from the stack and add it to the list of markers done
     markers_done.push_front(marker);
@@ -124,8 +99,8 @@ void Profiler::synchronizeFrame()
     if(m_freeze_state == FROZEN)
         return;
 
-    // Avoid using several times _getTimeMilliseconds(), which would yield different results
-    double now = _getTimeMilliseconds();
+    // Avoid using several times StkTime::getPreciseTimeMs(), which would yield different results
+    double now = StkTime::getPreciseTimeMs();
 
     // Swap buffers
     int old_write_id = m_write_id;
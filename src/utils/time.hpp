@@ -27,6 +27,7 @@
 #else
 #  include <stdint.h>
 #  include <sys/time.h>
+#  include <unistd.h>
 #endif
 
 #include <string>
@@ -77,6 +78,20 @@ public:
 #endif
     };   // getTimeSinceEpoch
 
+    // ------------------------------------------------------------------------
+    /** Suspends the calling thread. Unlike IrrlichtDevice::sleep this can
+     *  be used by any thread, since it does not depend on the device.
+     *  \param msec Number of milliseconds to sleep.
+     */
+    static void sleep(int msec)
+    {
+#ifdef WIN32
+        Sleep(msec);
+#else
+        usleep(msec*1000);
+#endif
+    }   // sleep
+
     // ------------------------------------------------------------------------
     /** Returns a time based on an arbitrary 'epoch' (e.g. could be start
      *  time of the application, 1.1.1970, ...).
@@ -84,6 +99,26 @@ public:
      */
     static double getRealTime(long startAt=0);
 
+    // ------------------------------------------------------------------------
+    /** Returns a time in milliseconds with a higher resolution than
+     *  getRealTime, e.g. to measure the time of short functions. Only the
+     *  difference between two values is meaningful.
+     */
+    static double getPreciseTimeMs()
+    {
+#ifdef WIN32
+        LARGE_INTEGER freq;
+        QueryPerformanceFrequency(&freq);
+        LARGE_INTEGER timer;
+        QueryPerformanceCounter(&timer);
+        return double(timer.QuadPart) / (double(freq.QuadPart) / 1000.0);
+#else
+        struct timeval tv;
+        gettimeofday(&tv, NULL);
+        return double(tv.tv_sec) * 1000.0 + double(tv.tv_usec) / 1000.0;
+#endif
+    }   // getPreciseTimeMs
+
     // ------------------------------------------------------------------------
     /** 
      * \brief Compare two different times.
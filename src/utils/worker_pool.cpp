@@ -0,0 +1,206 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2013 Joerg Henrichs
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#include "utils/worker_pool.hpp"
+
+#include "utils/log.hpp"
+
+#include <assert.h>
+
+#if defined(WIN32) && !defined(__CYGWIN__)
+#  include <windows.h>
+#else
+#  include <unistd.h>
+#endif
+
+/** Maximum number of worker threads. */
+static const unsigned int MAX_THREADS = 16;
+
+WorkerPool *WorkerPool::m_worker_pool = NULL;
+
+// ----------------------------------------------------------------------------
+/** Creates the worker pool singleton.
+ *  \param num_threads Number of worker threads to start. 0 means one thread
+ *         less than the number of available cpus (since the thread calling
+ *         run() will do work as well).
+ */
+void WorkerPool::create(unsigned int num_threads)
+{
+    assert(!m_worker_pool);
+    if(num_threads==0)
+        num_threads = getNumCPUs()-1;
+    if(num_threads>MAX_THREADS)
+        num_threads = MAX_THREADS;
+    m_worker_pool = new WorkerPool(num_threads);
+}   // create
+
+// ----------------------------------------------------------------------------
+/** Stops all worker threads and destroys the worker pool singleton. */
+void WorkerPool::destroy()
+{
+    if(m_worker_pool)
+        delete m_worker_pool;
+    m_worker_pool = NULL;
+}   // destroy
+
+// ----------------------------------------------------------------------------
+/** Returns the number of available cpus (at least 1). */
+unsigned int WorkerPool::getNumCPUs()
+{
+#if defined(WIN32) && !defined(__CYGWIN__)
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwNumberOfProcessors>0 ? info.dwNumberOfProcessors : 1;
+#else
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n>0 ? (unsigned int)n : 1;
+#endif
+}   // getNumCPUs
+
+// ----------------------------------------------------------------------------
+/** Starts the worker threads.
+ *  \param num_threads Number of threads to start.
+ */
+WorkerPool::WorkerPool(unsigned int num_threads)
+{
+    m_job        = NULL;
+    m_num_items  = 0;
+    m_next_item  = 0;
+    m_items_done = 0;
+    m_abort      = false;
+    pthread_mutex_init(&m_mutex,     NULL);
+    pthread_cond_init (&m_cond_work, NULL);
+    pthread_cond_init (&m_cond_done, NULL);
+
+    for(unsigned int i=0; i<num_threads; i++)
+    {
+        pthread_t thread;
+        int error = pthread_create(&thread, NULL, &WorkerPool::mainLoop,
+                                   this);
+        if(error)
+        {
+            Log::warn("WorkerPool", "Could not create thread, error=%d.",
+                      error);
+            break;
+        }
+        m_threads.push_back(thread);
+    }
+    Log::info("WorkerPool", "Started %d worker threads.",
+              (int)m_threads.size());
+}   // WorkerPool
+
+// ----------------------------------------------------------------------------
+/** Terminates and joins all worker threads. */
+WorkerPool::~WorkerPool()
+{
+    pthread_mutex_lock(&m_mutex);
+    m_abort = true;
+    pthread_cond_broadcast(&m_cond_work);
+    pthread_mutex_unlock(&m_mutex);
+
+    for(unsigned int i=0; i<m_threads.size(); i++)
+        pthread_join(m_threads[i], NULL);
+
+    pthread_cond_destroy (&m_cond_done);
+    pthread_cond_destroy (&m_cond_work);
+    pthread_mutex_destroy(&m_mutex);
+}   // ~WorkerPool
+
+// ----------------------------------------------------------------------------
+/** Executes items of the current job until no item is left. The mutex must
+ *  be locked when calling this function, and is locked on return.
+ */
+void WorkerPool::executeItems()
+{
+    while(m_job && m_next_item<m_num_items)
+    {
+        Job *job = m_job;
+        const unsigned int index = m_next_item++;
+        pthread_mutex_unlock(&m_mutex);
+        job->run(index);
+        pthread_mutex_lock(&m_mutex);
+        m_items_done++;
+        if(m_items_done==m_num_items)
+            pthread_cond_signal(&m_cond_done);
+    }
+}   // executeItems
+
+// ----------------------------------------------------------------------------
+/** The main loop of a worker thread: waits for a job and executes items
+ *  of it.
+ *  \param obj Pointer to the worker pool.
+ */
+void *WorkerPool::mainLoop(void *obj)
+{
+    WorkerPool *pool = (WorkerPool*)obj;
+    pthread_mutex_lock(&pool->m_mutex);
+    while(!pool->m_abort)
+    {
+        pool->executeItems();
+        if(!pool->m_abort)
+            pthread_cond_wait(&pool->m_cond_work, &pool->m_mutex);
+    }
+    pthread_mutex_unlock(&pool->m_mutex);
+    return NULL;
+}   // mainLoop
+
+// ----------------------------------------------------------------------------
+/** Executes a job for all items, and returns once all items are done.
+ *  \param job The job to execute.
+ *  \param num_items Number of items.
+ */
+void WorkerPool::run(Job *job, unsigned int num_items)
+{
+    if(m_threads.size()==0 || num_items<2)
+    {
+        for(unsigned int i=0; i<num_items; i++)
+            job->run(i);
+        return;
+    }
+
+    pthread_mutex_lock(&m_mutex);
+    assert(!m_job);
+    m_job        = job;
+    m_num_items  = num_items;
+    m_next_item  = 0;
+    m_items_done = 0;
+    pthread_cond_broadcast(&m_cond_work);
+
+    executeItems();
+    while(m_items_done<m_num_items)
+        pthread_cond_wait(&m_cond_done, &m_mutex);
+    m_job = NULL;
+    pthread_mutex_unlock(&m_mutex);
+}   // run
+
+// ----------------------------------------------------------------------------
+/** Executes a job for all items with the worker pool, or one item after
+ *  another in the calling thread if the worker pool was not created.
+ *  \param job The job to execute.
+ *  \param num_items Number of items.
+ */
+void WorkerPool::execute(Job *job, unsigned int num_items)
+{
+    if(m_worker_pool)
+    {
+        m_worker_pool->run(job, num_items);
+        return;
+    }
+    for(unsigned int i=0; i<num_items; i++)
+        job->run(i);
+}   // execute
@@ -0,0 +1,106 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2013 Joerg Henrichs
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#ifndef HEADER_WORKER_POOL_HPP
+#define HEADER_WORKER_POOL_HPP
+
+#include "utils/no_copy.hpp"
+
+#include <pthread.h>
+#include <vector>
+
+/**
+ *  \brief A pool of worker threads which execute a job for a number of
+ *  independent items in parallel.
+ *  The thread calling run() takes part in the work, and run() only returns
+ *  once all items are done. So a job must only modify data belonging to
+ *  its own item, and the result is then independent of the number of
+ *  threads (and the same as executing the items one after another). If no
+ *  worker threads are available the job is just executed in the calling
+ *  thread.
+ *  Only one job can be executed at a time, and run() must not be called
+ *  from inside a job.
+ * \ingroup utils
+ */
+class WorkerPool : public NoCopy
+{
+public:
+    /** Interface for a job executed by the worker pool. */
+    class Job
+    {
+    public:
+        virtual ~Job() {}
+        /** Executes the job for one item.
+         *  \param index Index of the item (0 to number of items-1). */
+        virtual void run(unsigned int index) = 0;
+    };   // Job
+
+private:
+    /** The singleton. */
+    static WorkerPool *m_worker_pool;
+
+    /** The worker threads. */
+    std::vector<pthread_t>  m_threads;
+
+    /** Protects all following data. */
+    pthread_mutex_t         m_mutex;
+
+    /** Signalled when a new job is available (or the threads should
+     *  terminate). */
+    pthread_cond_t          m_cond_work;
+
+    /** Signalled when all items of the current job are done. */
+    pthread_cond_t          m_cond_done;
+
+    /** The current job, or NULL. */
+    Job                    *m_job;
+
+    /** Number of items of the current job. */
+    unsigned int            m_num_items;
+
+    /** Index of the next item to be executed. */
+    unsigned int            m_next_item;
+
+    /** Number of items that are finished. */
+    unsigned int            m_items_done;
+
+    /** Set to true to terminate the worker threads. */
+    bool                    m_abort;
+
+         WorkerPool(unsigned int num_threads);
+        ~WorkerPool();
+    void executeItems();
+    static void *mainLoop(void *obj);
+
+public:
+    static void create(unsigned int num_threads=0);
+    static void destroy();
+    static unsigned int getNumCPUs();
+    // ------------------------------------------------------------------------
+    /** Returns the worker pool, or NULL if it was not created. */
+    static WorkerPool *get() { return m_worker_pool; }
+    // ------------------------------------------------------------------------
+    void run(Job *job, unsigned int num_items);
+    static void execute(Job *job, unsigned int num_items);
+    // ------------------------------------------------------------------------
+    /** Returns the number of worker threads (not including the thread
+     *  calling run()). */
+    unsigned int getNumThreads() const { return m_threads.size(); }
+};   // WorkerPool
+
+#endif